@@ -0,0 +1,214 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_BENCH_H
+#define IMAPP_BENCH_H
+
+// A minimal benchmark harness shared by the ImApp benchmark programs. Each
+// benchmark is a function which runs a requested number of iterations. The
+// harness calibrates the number of iterations, repeats the measurement, and
+// reports the median, either as a table or as JSON.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/**
+ * @brief Prevents the compiler from optimizing away the computation of a
+ * value which is otherwise unused.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+struct Result {
+  std::string name;
+  std::uint64_t iterations;
+  double ns_per_iter;
+  double items_per_second;
+};
+
+class Suite {
+ public:
+  /**
+   * @brief Adds a benchmark to the suite.
+   * @param name Name of the benchmark, such as "group/case".
+   * @param items Number of items processed by one iteration, used to report
+   * a throughput. Zero if no throughput should be reported.
+   * @param body Function called as body(n), which must run n iterations.
+   */
+  void add(std::string name, std::uint64_t items,
+           std::function<void(std::uint64_t)> body) {
+    benchmarks_.push_back({std::move(name), items, std::move(body)});
+  }
+
+  /**
+   * @brief Parses the command line, runs the selected benchmarks, and
+   * reports the results. Supported options are --filter=<substring>,
+   * --min-time=<seconds>, --repetitions=<n>, and --json[=<file>].
+   * @return Exit code for main.
+   */
+  int run(int argc, char** argv) {
+    std::string filter, json;
+    bool want_json = false;
+    double min_time = 0.1;
+    int repetitions = 5;
+
+    for (int i = 1; i < argc; i++) {
+      const char* arg = argv[i];
+      if (std::strncmp(arg, "--filter=", 9) == 0) {
+        filter = arg + 9;
+      } else if (std::strncmp(arg, "--min-time=", 11) == 0) {
+        min_time = std::atof(arg + 11);
+      } else if (std::strncmp(arg, "--repetitions=", 14) == 0) {
+        repetitions = std::max(1, std::atoi(arg + 14));
+      } else if (std::strcmp(arg, "--json") == 0) {
+        want_json = true;
+      } else if (std::strncmp(arg, "--json=", 7) == 0) {
+        want_json = true;
+        json = arg + 7;
+      } else {
+        std::fprintf(stderr,
+                     "Usage: %s [--filter=<substring>] [--min-time=<s>] "
+                     "[--repetitions=<n>] [--json[=<file>]]\n",
+                     argv[0]);
+        return 1;
+      }
+    }
+
+    std::vector<Result> results;
+    for (auto& b : benchmarks_) {
+      if (!filter.empty() && b.name.find(filter) == std::string::npos)
+        continue;
+
+      results.push_back(measure(b, min_time, repetitions));
+      if (!want_json || !json.empty()) print(results.back());
+    }
+
+    if (want_json) {
+      FILE* file = json.empty() ? stdout : std::fopen(json.c_str(), "w");
+      if (file == nullptr) {
+        std::fprintf(stderr, "Could not open \"%s\".\n", json.c_str());
+        return 1;
+      }
+      write_json(file, results);
+      if (file != stdout) std::fclose(file);
+    }
+
+    return 0;
+  }
+
+ private:
+  struct Benchmark {
+    std::string name;
+    std::uint64_t items;
+    std::function<void(std::uint64_t)> body;
+  };
+
+  std::vector<Benchmark> benchmarks_;
+
+  static double time_ns(const Benchmark& b, std::uint64_t n) {
+    const auto begin = std::chrono::steady_clock::now();
+    b.body(n);
+    const std::chrono::duration<double, std::nano> time =
+        std::chrono::steady_clock::now() - begin;
+    return time.count();
+  }
+
+  static Result measure(const Benchmark& b, double min_time,
+                        int repetitions) {
+    // Grow the iteration count until one repetition takes long enough to be
+    // timed reliably. The first call also serves as a warm up.
+    const double target_ns = 1e9 * min_time;
+    std::uint64_t n = 1;
+    double ns = time_ns(b, n);
+    while (ns < target_ns && n < (std::uint64_t(1) << 40)) {
+      const double scale = ns > 0. ? 1.4 * target_ns / ns : 10.;
+      n = std::max<std::uint64_t>(
+          n + 1, static_cast<std::uint64_t>(static_cast<double>(n) *
+                                            std::min(scale, 10.)));
+      ns = time_ns(b, n);
+    }
+
+    std::vector<double> per_iter;
+    per_iter.push_back(ns / static_cast<double>(n));
+    for (int r = 1; r < repetitions; r++)
+      per_iter.push_back(time_ns(b, n) / static_cast<double>(n));
+
+    std::sort(per_iter.begin(), per_iter.end());
+    const double median = per_iter[per_iter.size() / 2];
+    const double items_per_second =
+        b.items > 0 ? 1e9 * static_cast<double>(b.items) / median : 0.;
+    return {b.name, n, median, items_per_second};
+  }
+
+  static void print(const Result& r) {
+    std::printf("%-40s %14.1f ns", r.name.c_str(), r.ns_per_iter);
+    if (r.items_per_second > 0.)
+      std::printf(" %14.4g items/s", r.items_per_second);
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  static void write_json(FILE* file, const std::vector<Result>& results) {
+    std::fprintf(file, "{\n  \"benchmarks\": [\n");
+    for (std::size_t i = 0; i < results.size(); i++) {
+      const Result& r = results[i];
+      std::fprintf(file,
+                   "    {\"name\": \"%s\", \"iterations\": %llu, "
+                   "\"ns_per_iter\": %.3f, \"items_per_second\": %.6g}%s\n",
+                   r.name.c_str(),
+                   static_cast<unsigned long long>(r.iterations),
+                   r.ns_per_iter, r.items_per_second,
+                   i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+  }
+};
+
+}  // namespace bench
+#endif
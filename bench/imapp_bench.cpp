@@ -0,0 +1,929 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+
+// Usage: imapp_bench [--filter=<substring>] [--min-time=<s>]
+//                    [--repetitions=<n>] [--json[=<file>]]
+//
+// Microbenchmarks for the hot paths of ImApp, ImGui, and ImPlot. Everything
+// runs on a headless ImGui context, so no window or GPU is required. ImPlot
+// benchmarks render a full frame containing a single plot, and the
+// "implot/empty" case gives the fixed cost of such a frame.
+
+#include <ImApp/imapp.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+#include "imgui/imgui_internal.h"
+
+namespace {
+
+const char* lorem =
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+    "tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim "
+    "veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea "
+    "commodo consequat. Duis aute irure dolor in reprehenderit in voluptate "
+    "velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint "
+    "occaecat cupidatat non proident, sunt in culpa qui officia deserunt "
+    "mollit anim id est laborum.";
+
+// ImGui and ImPlot contexts without a window or renderer backend.
+class Headless {
+ public:
+  Headless() {
+    ImGui::CreateContext();
+    ImPlot::CreateContext();
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1920.f, 1080.f);
+    io.DeltaTime = 1.f / 60.f;
+    // Like the OpenGL3 backend, so large plots may exceed 64k vertices.
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+
+    unsigned char* pixels;
+    int w, h;
+    io.Fonts->AddFontDefault();
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &w, &h);
+    io.Fonts->SetTexID(reinterpret_cast<ImTextureID>(std::intptr_t(1)));
+  }
+
+  ~Headless() {
+    ImPlot::DestroyContext();
+    ImGui::DestroyContext();
+  }
+
+  Headless(const Headless&) = delete;
+  Headless& operator=(const Headless&) = delete;
+
+  static void begin_frame() {
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+    ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+    ImGui::Begin("bench", nullptr, ImGuiWindowFlags_NoDecoration);
+  }
+
+  static void end_frame() {
+    ImGui::End();
+    ImGui::Render();
+  }
+
+  // Keeps a frame open, for benchmarks which need the current font.
+  struct Frame {
+    Frame() { begin_frame(); }
+    ~Frame() { end_frame(); }
+  };
+};
+
+// A draw list which is reset before each iteration, as it is every frame.
+class BenchDrawList {
+ public:
+  BenchDrawList() : list_(ImGui::GetDrawListSharedData()) {}
+
+  ImDrawList& reset() {
+    list_._ResetForNewFrame();
+    list_.PushClipRectFullScreen();
+    list_.PushTextureID(ImGui::GetIO().Fonts->TexID);
+    return list_;
+  }
+
+ private:
+  ImDrawList list_;
+};
+
+std::vector<ImVec2> sine_points(std::size_t n) {
+  std::vector<ImVec2> points(n);
+  for (std::size_t i = 0; i < n; i++) {
+    const float x = 1800.f * static_cast<float>(i) / static_cast<float>(n);
+    points[i] = ImVec2(50.f + x, 500.f + 300.f * std::sin(0.01f * x));
+  }
+  return points;
+}
+
+std::vector<double> random_values(std::size_t n, std::uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> dist(0., 1.);
+  std::vector<double> values(n);
+  for (auto& v : values) v = dist(rng);
+  return values;
+}
+
+void add_draw_list_benchmarks(bench::Suite& suite) {
+  for (std::size_t n : {100, 10000}) {
+    for (bool aa : {false, true}) {
+      auto points = std::make_shared<std::vector<ImVec2>>(sine_points(n));
+      std::string name = "drawlist/polyline_" + std::to_string(n);
+      name += aa ? "_aa" : "";
+      suite.add(name, n, [points, aa](std::uint64_t iters) {
+        Headless::Frame frame;
+        BenchDrawList dl;
+        for (std::uint64_t i = 0; i < iters; i++) {
+          ImDrawList& list = dl.reset();
+          list.Flags = aa ? ImDrawListFlags_AntiAliasedLines : 0;
+          list.AddPolyline(points->data(), static_cast<int>(points->size()),
+                           IM_COL32(255, 128, 0, 255), ImDrawFlags_None,
+                           2.f);
+          bench::do_not_optimize(list.VtxBuffer.Size);
+        }
+      });
+    }
+  }
+
+  const std::size_t text_len = std::strlen(lorem);
+  suite.add("drawlist/add_text", text_len, [](std::uint64_t iters) {
+    Headless::Frame frame;
+    BenchDrawList dl;
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImDrawList& list = dl.reset();
+      list.AddText(ImVec2(10.f, 10.f), IM_COL32_WHITE, lorem);
+      bench::do_not_optimize(list.VtxBuffer.Size);
+    }
+  });
+
+  suite.add("font/render_text_wrapped", text_len, [](std::uint64_t iters) {
+    Headless::Frame frame;
+    BenchDrawList dl;
+    ImFont* font = ImGui::GetIO().Fonts->Fonts[0];
+    const ImVec4 clip(0.f, 0.f, 1920.f, 1080.f);
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImDrawList& list = dl.reset();
+      font->RenderText(&list, font->FontSize, ImVec2(10.f, 10.f),
+                       IM_COL32_WHITE, clip, lorem, nullptr, 400.f, false);
+      bench::do_not_optimize(list.VtxBuffer.Size);
+    }
+  });
+
+  suite.add("text/calc_text_size", text_len, [](std::uint64_t iters) {
+    Headless::Frame frame;
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImVec2 size = ImGui::CalcTextSize(lorem);
+      bench::do_not_optimize(size);
+    }
+  });
+
+  suite.add("text/calc_text_size_wrapped", text_len, [](std::uint64_t iters) {
+    Headless::Frame frame;
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImVec2 size = ImGui::CalcTextSize(lorem, nullptr, false, 300.f);
+      bench::do_not_optimize(size);
+    }
+  });
+
+  suite.add("hash/imhashstr_label", 1, [](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImGuiID id = ImHashStr("##plot_settings_button", 0, 0x1234u);
+      bench::do_not_optimize(id);
+    }
+  });
+
+  suite.add("hash/imhashstr_long", text_len, [](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImGuiID id = ImHashStr(lorem, 0, 0);
+      bench::do_not_optimize(id);
+    }
+  });
+}
+
+void add_implot_benchmarks(bench::Suite& suite) {
+  suite.add("implot/empty", 0, [](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      Headless::begin_frame();
+      if (ImPlot::BeginPlot("##bench", ImVec2(-1.f, -1.f))) ImPlot::EndPlot();
+      Headless::end_frame();
+    }
+  });
+
+  for (int n : {1000, 100000}) {
+    auto ys = std::make_shared<std::vector<double>>(random_values(n, 1));
+    auto xs = std::make_shared<std::vector<double>>(random_values(n, 2));
+
+    suite.add("implot/line_" + std::to_string(n), n,
+              [ys, n](std::uint64_t iters) {
+                for (std::uint64_t i = 0; i < iters; i++) {
+                  Headless::begin_frame();
+                  if (ImPlot::BeginPlot("##bench", ImVec2(-1.f, -1.f))) {
+                    ImPlot::PlotLine("line", ys->data(), n);
+                    ImPlot::EndPlot();
+                  }
+                  Headless::end_frame();
+                }
+              });
+
+    suite.add("implot/scatter_" + std::to_string(n), n,
+              [xs, ys, n](std::uint64_t iters) {
+                for (std::uint64_t i = 0; i < iters; i++) {
+                  Headless::begin_frame();
+                  if (ImPlot::BeginPlot("##bench", ImVec2(-1.f, -1.f))) {
+                    ImPlot::PlotScatter("scatter", xs->data(), ys->data(), n);
+                    ImPlot::EndPlot();
+                  }
+                  Headless::end_frame();
+                }
+              });
+
+    suite.add("implot/histogram_" + std::to_string(n), n,
+              [ys, n](std::uint64_t iters) {
+                for (std::uint64_t i = 0; i < iters; i++) {
+                  Headless::begin_frame();
+                  if (ImPlot::BeginPlot("##bench", ImVec2(-1.f, -1.f))) {
+                    ImPlot::PlotHistogram("hist", ys->data(), n, 100);
+                    ImPlot::EndPlot();
+                  }
+                  Headless::end_frame();
+                }
+              });
+  }
+
+  for (int n : {32, 256}) {
+    auto values = std::make_shared<std::vector<double>>(
+        random_values(static_cast<std::size_t>(n * n), 3));
+    // Labels are only drawn for the small map, as they would not fit.
+    const char* fmt = n <= 32 ? "%.1f" : nullptr;
+    suite.add("implot/heatmap_" + std::to_string(n), n * n,
+              [values, n, fmt](std::uint64_t iters) {
+                for (std::uint64_t i = 0; i < iters; i++) {
+                  Headless::begin_frame();
+                  if (ImPlot::BeginPlot("##bench", ImVec2(-1.f, -1.f))) {
+                    ImPlot::PlotHeatmap("heat", values->data(), n, n, -3., 3.,
+                                        fmt);
+                    ImPlot::EndPlot();
+                  }
+                  Headless::end_frame();
+                }
+              });
+  }
+
+  constexpr std::size_t n_samples = 512 * 512;
+  suite.add("colormap/sample_to_image", n_samples, [](std::uint64_t iters) {
+    ImApp::Image image(512, 512);
+    for (std::uint64_t i = 0; i < iters; i++) {
+      for (std::uint32_t p = 0; p < image.size(); p++) {
+        const float t = static_cast<float>(p) / n_samples;
+        const ImVec4 c = ImPlot::SampleColormap(t, ImPlotColormap_Viridis);
+        image[p] = ImApp::Pixel(static_cast<std::uint8_t>(255.f * c.x),
+                                static_cast<std::uint8_t>(255.f * c.y),
+                                static_cast<std::uint8_t>(255.f * c.z));
+      }
+      bench::do_not_optimize(image[0]);
+    }
+  });
+
+  suite.add("colormap/r32f_to_rgba8", n_samples, [](std::uint64_t iters) {
+    ImApp::ImageR32F field(512, 512);
+    for (std::uint32_t p = 0; p < field.size(); p++)
+      field[p].r = static_cast<float>(p) / n_samples;
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImApp::Image image = ImApp::colormap(field, 0.f, 1.f);
+      bench::do_not_optimize(image[0]);
+    }
+  });
+}
+
+void add_image_benchmarks(bench::Suite& suite) {
+  auto dir = std::filesystem::temp_directory_path();
+  auto fname = std::make_shared<std::filesystem::path>(dir / "imapp_bench.png");
+
+  // A smooth gradient with some noise, which compresses like a photograph
+  // rather than like a flat image.
+  auto make_image = []() {
+    ImApp::Image image(512, 512);
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<int> noise(0, 15);
+    for (std::uint32_t h = 0; h < image.height(); h++) {
+      for (std::uint32_t w = 0; w < image.width(); w++) {
+        image(h, w) = ImApp::Pixel(static_cast<std::uint8_t>(h / 2 + noise(rng)),
+                                   static_cast<std::uint8_t>(w / 2 + noise(rng)),
+                                   static_cast<std::uint8_t>(noise(rng) * 8));
+      }
+    }
+    return image;
+  };
+
+  suite.add("image/save_png_512", 512 * 512,
+            [make_image, fname](std::uint64_t iters) {
+              ImApp::Image image = make_image();
+              for (std::uint64_t i = 0; i < iters; i++) {
+                bool ok = image.save_png(*fname);
+                bench::do_not_optimize(ok);
+              }
+            });
+
+  suite.add("image/from_file_png_512", 512 * 512,
+            [make_image, fname](std::uint64_t iters) {
+              make_image().save_png(*fname);
+              for (std::uint64_t i = 0; i < iters; i++) {
+                ImApp::Image image = ImApp::Image::from_file(*fname);
+                bench::do_not_optimize(image[0]);
+              }
+            });
+
+  // Allocating a 1080p frame, as is done for every frame of a video stream.
+  constexpr std::uint32_t frame_h = 1080, frame_w = 1920;
+  auto add_alloc = [&suite](const char* name, ImApp::ImageOptions options) {
+    suite.add(name, frame_h * frame_w, [options](std::uint64_t iters) {
+      for (std::uint64_t i = 0; i < iters; i++) {
+        ImApp::Image frame(frame_h, frame_w, options);
+        frame[0] = ImApp::Pixel(1, 2, 3);
+        bench::do_not_optimize(frame[0]);
+      }
+    });
+  };
+
+  ImApp::ImageOptions uninitialized;
+  uninitialized.initialize = false;
+  ImApp::ImageOptions pooled = uninitialized;
+  pooled.allocator = std::make_shared<ImApp::PoolAllocator>();
+  add_alloc("image/alloc_1080p", ImApp::ImageOptions());
+  add_alloc("image/alloc_1080p_uninitialized", uninitialized);
+  add_alloc("image/alloc_1080p_pool", pooled);
+}
+
+// Lanczos-3 resampling done directly in two dimensions, where every output
+// pixel evaluates the filter for every source pixel under it. This is the
+// reference for the separable passes of ImApp::resample.
+double lanczos3(double x) {
+  constexpr double pi = 3.14159265358979323846;
+  if (x == 0.) return 1.;
+  if (std::abs(x) >= 3.) return 0.;
+  const double px = pi * x;
+  return 3. * std::sin(px) * std::sin(px / 3.) / (px * px);
+}
+
+ImApp::Image naive_lanczos(const ImApp::Image& src, std::uint32_t height,
+                           std::uint32_t width) {
+  using Traits = ImApp::PixelTraits<ImApp::Pixel>;
+  ImApp::Image dst(height, width);
+  const double sy = static_cast<double>(src.height()) / height;
+  const double sx = static_cast<double>(src.width()) / width;
+  const double ry = 3. * std::max(sy, 1.), rx = 3. * std::max(sx, 1.);
+  for (std::uint32_t h = 0; h < height; h++) {
+    const double cy = (h + 0.5) * sy;
+    const auto y0 = static_cast<std::int64_t>(std::max(cy - ry, 0.));
+    const auto y1 = std::min(static_cast<std::int64_t>(cy + ry) + 1,
+                             static_cast<std::int64_t>(src.height()));
+    for (std::uint32_t w = 0; w < width; w++) {
+      const double cx = (w + 0.5) * sx;
+      const auto x0 = static_cast<std::int64_t>(std::max(cx - rx, 0.));
+      const auto x1 = std::min(static_cast<std::int64_t>(cx + rx) + 1,
+                               static_cast<std::int64_t>(src.width()));
+      std::array<double, 4> sum = {0., 0., 0., 0.};
+      double total = 0.;
+      for (std::int64_t y = y0; y < y1; y++) {
+        for (std::int64_t x = x0; x < x1; x++) {
+          const double k = lanczos3((y + 0.5 - cy) / std::max(sy, 1.)) *
+                           lanczos3((x + 0.5 - cx) / std::max(sx, 1.));
+          const auto c = Traits::to_rgba(src(static_cast<std::uint32_t>(y),
+                                             static_cast<std::uint32_t>(x)));
+          for (int i = 0; i < 4; i++) sum[i] += k * c[i];
+          total += k;
+        }
+      }
+      std::array<float, 4> out;
+      for (int i = 0; i < 4; i++) out[i] = static_cast<float>(sum[i] / total);
+      dst(h, w) = Traits::from_rgba(out);
+    }
+  }
+  return dst;
+}
+
+std::vector<unsigned char> read_bytes(const std::filesystem::path& fname) {
+  std::ifstream file(fname, std::ios::binary);
+  return std::vector<unsigned char>(std::istreambuf_iterator<char>(file),
+                                    std::istreambuf_iterator<char>());
+}
+
+void add_codec_benchmarks(bench::Suite& suite) {
+  // A 1080p frame with smooth gradients and some noise, which is encoded
+  // once, and then decoded from memory by every decoder of the format.
+  constexpr std::uint32_t frame_h = 1080, frame_w = 1920;
+  ImApp::Image frame(frame_h, frame_w);
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> noise(0, 7);
+  for (std::uint32_t h = 0; h < frame_h; h++) {
+    for (std::uint32_t w = 0; w < frame_w; w++) {
+      frame(h, w) = ImApp::Pixel(static_cast<std::uint8_t>(h / 5 + noise(rng)),
+                                 static_cast<std::uint8_t>(w / 8 + noise(rng)),
+                                 static_cast<std::uint8_t>((h + w) / 12));
+    }
+  }
+
+  const auto dir = std::filesystem::temp_directory_path();
+  struct Encoded {
+    const char* ext;
+    ImApp::ImageFormat format;
+    std::shared_ptr<std::vector<unsigned char>> data;
+  };
+  std::vector<Encoded> files;
+  for (const char* ext : {"jpg", "png"}) {
+    const auto fname = dir / (std::string("imapp_bench_decode.") + ext);
+    const bool ok =
+        ext[0] == 'j' ? frame.save_jpg(fname) : frame.save_png(fname);
+    if (!ok) continue;
+    auto data = std::make_shared<std::vector<unsigned char>>(read_bytes(fname));
+    std::filesystem::remove(fname);
+    files.push_back({ext, ImApp::detect_format(data->data(), data->size()),
+                     std::move(data)});
+  }
+
+  for (const Encoded& file : files) {
+    // Previews at 1/8 scale are what decode_file shows first, for formats
+    // with a decoder which can make them.
+    auto bytes = std::make_shared<std::string>(file.data->begin(),
+                                               file.data->end());
+    auto preview = [bytes](ImApp::DecodeSink& sink) {
+      std::istringstream stream(*bytes);
+      return ImApp::CodecRegistry::global().preview(stream, sink, 240);
+    };
+    ImApp::ImageDecodeSink<ImApp::PixelRGB8> probe;
+    if (preview(probe)) {
+      std::string name = "decode/" + std::string(file.ext) + "_1080p_preview";
+      suite.add(name, frame_h * frame_w, [preview](std::uint64_t iters) {
+        ImApp::ImageDecodeSink<ImApp::PixelRGB8> sink;
+        for (std::uint64_t i = 0; i < iters; i++) {
+          bool ok = preview(sink);
+          bench::do_not_optimize(ok);
+        }
+      });
+    }
+
+    for (const auto& decoder : ImApp::CodecRegistry::global().decoders()) {
+      if (!decoder->supports(file.format)) continue;
+
+      std::string name = "decode/";
+      name += std::string(file.ext) + "_1080p_" + decoder->name();
+      suite.add(name, frame_h * frame_w,
+                [decoder, data = file.data](std::uint64_t iters) {
+                  ImApp::ImageDecodeSink<ImApp::PixelRGB8> sink;
+                  std::string error;
+                  for (std::uint64_t i = 0; i < iters; i++) {
+                    bool ok = decoder->decode(data->data(), data->size(),
+                                              sink, error);
+                    bench::do_not_optimize(ok);
+                  }
+                });
+    }
+  }
+}
+
+void add_resample_benchmarks(bench::Suite& suite) {
+  // Shrinking a 1080p frame to a 960 x 540 preview, which is the common case
+  // for thumbnails and for drawing images smaller than their size.
+  constexpr std::uint32_t src_h = 1080, src_w = 1920;
+  constexpr std::uint32_t dst_h = 540, dst_w = 960;
+  auto frame = std::make_shared<ImApp::Image>(src_h, src_w);
+  for (std::uint32_t h = 0; h < src_h; h++) {
+    for (std::uint32_t w = 0; w < src_w; w++) {
+      (*frame)(h, w) = ImApp::Pixel(static_cast<std::uint8_t>(h),
+                                    static_cast<std::uint8_t>(w),
+                                    static_cast<std::uint8_t>(h ^ w));
+    }
+  }
+  auto jobs = std::make_shared<ImApp::JobSystem>();
+
+  // The direct reference is too slow for a whole frame, so it is compared
+  // on a quarter of one, to the same reduction by ImApp::resample.
+  auto quarter = std::make_shared<ImApp::Image>(frame->view(0, 0, 270, 480));
+  suite.add("resample/naive_lanczos_270p", 135 * 240,
+            [quarter](std::uint64_t iters) {
+              for (std::uint64_t i = 0; i < iters; i++) {
+                ImApp::Image out = naive_lanczos(*quarter, 135, 240);
+                bench::do_not_optimize(out[0]);
+              }
+            });
+  suite.add("resample/lanczos_270p", 135 * 240, [quarter](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      ImApp::Image out = ImApp::resample(*quarter, 135, 240);
+      bench::do_not_optimize(out[0]);
+    }
+  });
+
+  struct Filter {
+    const char* name;
+    ImApp::ResampleFilter filter;
+  };
+  const Filter filters[] = {{"box", ImApp::ResampleFilter::Box},
+                            {"bilinear", ImApp::ResampleFilter::Bilinear},
+                            {"lanczos", ImApp::ResampleFilter::Lanczos},
+                            {"area", ImApp::ResampleFilter::Area}};
+  for (const Filter& f : filters) {
+    for (bool threaded : {false, true}) {
+      std::string name = std::string("resample/") + f.name + "_1080p";
+      if (threaded) name += "_jobs";
+      ImApp::JobSystem* pool = threaded ? jobs.get() : nullptr;
+      suite.add(name, dst_h * dst_w,
+                [frame, jobs, pool, filter = f.filter](std::uint64_t iters) {
+                  for (std::uint64_t i = 0; i < iters; i++) {
+                    ImApp::Image out =
+                        ImApp::resample(*frame, dst_h, dst_w, filter, pool);
+                    bench::do_not_optimize(out[0]);
+                  }
+                });
+    }
+  }
+
+  suite.add("resample/downscale_2x_1080p", dst_h * dst_w,
+            [frame](std::uint64_t iters) {
+              for (std::uint64_t i = 0; i < iters; i++) {
+                ImApp::Image out = ImApp::downscale(*frame, 2);
+                bench::do_not_optimize(out[0]);
+              }
+            });
+
+  suite.add("resample/pyramid_1080p", src_h * src_w,
+            [frame, jobs](std::uint64_t iters) {
+              for (std::uint64_t i = 0; i < iters; i++) {
+                auto levels = ImApp::build_pyramid(*frame, 0, jobs.get());
+                bench::do_not_optimize(levels.back()[0]);
+              }
+            });
+}
+
+// Images whose textures are tracked, but don't exist, as there is no OpenGL
+// context. The textures are released instead of deleted.
+class FakeResidentImages {
+ public:
+  explicit FakeResidentImages(std::uint32_t n) {
+    for (std::uint32_t i = 0; i < n; i++) {
+      images_.emplace_back(256, 256);
+      images_.back().set_texture(ImApp::Texture(1000 + i, 256, 256));
+    }
+  }
+
+  ~FakeResidentImages() {
+    for (auto& image : images_) image.take_texture().release();
+  }
+
+  FakeResidentImages(const FakeResidentImages&) = delete;
+  FakeResidentImages& operator=(const FakeResidentImages&) = delete;
+
+  ImApp::Image& operator[](std::size_t i) { return images_[i]; }
+
+ private:
+  std::vector<ImApp::Image> images_;
+};
+
+void add_residency_benchmarks(bench::Suite& suite) {
+  // A gallery of 1000 thumbnails, which are drawn in between text, as every
+  // thumbnail is followed by its caption.
+  constexpr std::uint32_t n_images = 1000;
+  auto images = std::make_shared<FakeResidentImages>(n_images);
+  auto list = std::make_shared<BenchDrawList>();
+  auto draw_data = std::make_shared<ImDrawData>();
+  Headless::Frame frame;  // For the font of the captions
+  ImDrawList& dl = list->reset();
+  for (std::uint32_t i = 0; i < n_images; i++) {
+    const ImVec2 p(static_cast<float>(i % 40) * 48.f,
+                   static_cast<float>(i / 40) * 48.f);
+    dl.AddImage((*images)[i].texture_id(), p, ImVec2(p.x + 32.f, p.y + 32.f));
+    dl.AddText(ImVec2(p.x, p.y + 34.f), IM_COL32_WHITE, "caption");
+  }
+  draw_data->AddDrawList(&dl);
+
+  suite.add("residency/mark_used_1k_textures", n_images,
+            [images, list, draw_data](std::uint64_t iters) {
+              ImApp::ResidencyManager& residency =
+                  ImApp::ResidencyManager::global();
+              for (std::uint64_t i = 0; i < iters; i++) {
+                residency.mark_used(*draw_data);
+                bench::do_not_optimize(residency.end_frame());
+              }
+            });
+}
+
+std::vector<ImGuiID> random_keys(std::size_t n) {
+  std::mt19937 rng(7);
+  std::vector<ImGuiID> keys(n);
+  for (auto& key : keys) key = rng();
+  return keys;
+}
+
+void add_storage_benchmarks(bench::Suite& suite) {
+  struct Size {
+    const char* name;
+    std::size_t n;
+  };
+  const Size sizes[] = {{"1k", 1000}, {"100k", 100000}, {"1m", 1000000}};
+
+  for (const Size& size : sizes) {
+    auto keys = std::make_shared<std::vector<ImGuiID>>(random_keys(size.n));
+
+    // Opening every node of a large tree inserts one pair per node. With the
+    // sorted storage every insertion shifts half of the pairs, so the large
+    // sizes are only measured with the hash index.
+#ifndef IMGUI_STORAGE_HASH_INDEX
+    if (size.n > 1000) continue;
+#endif
+    suite.add(std::string("storage/set_int_") + size.name, size.n,
+              [keys](std::uint64_t iters) {
+                for (std::uint64_t i = 0; i < iters; i++) {
+                  ImGuiStorage storage;
+                  for (ImGuiID key : *keys) storage.SetInt(key, 1);
+                  bench::do_not_optimize(storage.Data.Size);
+                }
+              });
+  }
+
+  for (const Size& size : sizes) {
+    // Bulk building is fast with either storage.
+    auto storage = std::make_shared<ImGuiStorage>();
+    auto keys = std::make_shared<std::vector<ImGuiID>>(random_keys(size.n));
+    for (ImGuiID key : *keys)
+      storage->Data.push_back(ImGuiStorage::ImGuiStoragePair(key, 1));
+    storage->BuildSortByKey();
+    std::shuffle(keys->begin(), keys->end(), std::mt19937(11));
+
+    suite.add(std::string("storage/get_int_") + size.name, size.n,
+              [storage, keys](std::uint64_t iters) {
+                for (std::uint64_t i = 0; i < iters; i++) {
+                  int sum = 0;
+                  for (ImGuiID key : *keys) sum += storage->GetInt(key);
+                  bench::do_not_optimize(sum);
+                }
+              });
+  }
+}
+
+// A two level tree, with n_top nodes which each have n_leaf children.
+ImApp::TreeView::Loader wide_tree(std::uint64_t n_top, std::uint64_t n_leaf) {
+  return [n_top, n_leaf](std::uint64_t id) {
+    std::vector<ImApp::TreeItem> items;
+    if (id == 0) {
+      items.reserve(n_top);
+      for (std::uint64_t i = 1; i <= n_top; i++)
+        items.push_back({i, "node " + std::to_string(i), true});
+    } else if (id <= n_top) {
+      items.reserve(n_leaf);
+      for (std::uint64_t i = 0; i < n_leaf; i++)
+        items.push_back({0, "leaf " + std::to_string(i), false});
+    }
+    return items;
+  };
+}
+
+void add_tree_benchmarks(bench::Suite& suite) {
+  // Every node of a tree with a million open nodes, which only costs the
+  // rows that fit in the window.
+  constexpr std::uint64_t n_top = 1000;
+  auto tree = std::make_shared<ImApp::TreeView>(wide_tree(n_top, 1000));
+  for (std::size_t row = tree->row_count(); row-- > 0;) tree->expand(row);
+
+  suite.add("tree/tree_view_1m_frame", 1, [tree](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      Headless::begin_frame();
+      bench::do_not_optimize(tree->draw("tree"));
+      Headless::end_frame();
+    }
+  });
+
+  // Closing and opening the last top level node, which moves no rows, and
+  // the first one, which moves all of the rows after it.
+  suite.add("tree/expand_collapse_1m_last", 1000, [tree](std::uint64_t iters) {
+    const std::size_t row = tree->row_count() - 1001;
+    for (std::uint64_t i = 0; i < iters; i++) {
+      tree->collapse(row);
+      tree->expand(row);
+    }
+  });
+  suite.add("tree/expand_collapse_1m_first", 1000, [tree](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      tree->collapse(0);
+      tree->expand(0);
+    }
+  });
+
+  // For comparison, submitting an open tree node for each of 10k nodes.
+  constexpr int n_nodes = 10000;
+  suite.add("tree/tree_node_10k_frame", n_nodes, [](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      Headless::begin_frame();
+      ImGui::BeginChild("nodes");
+      for (int n = 0; n < n_nodes; n++) {
+        ImGui::SetNextItemOpen(true, ImGuiCond_Once);
+        if (ImGui::TreeNode(reinterpret_cast<void*>(std::intptr_t(n + 1)),
+                            "node %d", n))
+          ImGui::TreePop();
+      }
+      ImGui::EndChild();
+      Headless::end_frame();
+    }
+  });
+}
+
+// A log file, with lines of varying length.
+std::string log_text(std::size_t n_lines) {
+  std::string text;
+  std::mt19937 rng(5);
+  for (std::size_t i = 0; i < n_lines; i++) {
+    text += "[" + std::to_string(i) + "] ";
+    text.append(lorem, rng() % 60);
+    text += '\n';
+  }
+  return text;
+}
+
+void add_text_editor_benchmarks(bench::Suite& suite) {
+  constexpr std::size_t n_lines = 1000000;
+  auto editor = std::make_shared<ImApp::TextEditor>();
+  editor->set_text(log_text(n_lines));
+  const std::size_t size = editor->buffer().size();
+
+  suite.add("text/editor_frame_1m_lines", 1, [editor](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++) {
+      Headless::begin_frame();
+      bench::do_not_optimize(editor->draw("editor"));
+      Headless::end_frame();
+    }
+  });
+
+  // Edits at random places, which fragment the buffer into more pieces the
+  // longer the benchmark runs.
+  auto buffer = std::make_shared<ImApp::TextBuffer>(log_text(n_lines));
+  suite.add("text/buffer_insert_erase_1m_lines", 2,
+            [buffer, size](std::uint64_t iters) {
+              std::mt19937_64 rng(3);
+              for (std::uint64_t i = 0; i < iters; i++) {
+                const std::size_t offset = rng() % size;
+                buffer->insert(offset, "x\n");
+                buffer->erase(offset + 1, 1);
+              }
+            });
+
+  suite.add("text/buffer_line_start_1m_lines", 1,
+            [buffer](std::uint64_t iters) {
+              std::mt19937_64 rng(3);
+              std::size_t sum = 0;
+              for (std::uint64_t i = 0; i < iters; i++)
+                sum += buffer->line_start(rng() % n_lines);
+              bench::do_not_optimize(sum);
+            });
+
+  // For comparison, a multiline InputText, which scans its whole buffer
+  // every frame.
+  constexpr std::size_t n_input_lines = 20000;
+  auto input = std::make_shared<std::string>(log_text(n_input_lines));
+  suite.add("text/input_text_multiline_20k_lines", 1,
+            [input](std::uint64_t iters) {
+              for (std::uint64_t i = 0; i < iters; i++) {
+                Headless::begin_frame();
+                ImGui::InputTextMultiline("##input", input->data(),
+                                          input->size() + 1, ImVec2(0.f, 0.f),
+                                          ImGuiInputTextFlags_ReadOnly);
+                Headless::end_frame();
+              }
+            });
+}
+
+// A scrolling table as wide as the column limit allows (2000 columns by
+// default is over IMAPP_TABLE_MAX_COLUMNS), scrolled to its middle, with a
+// frozen header row and first column.
+constexpr int n_table_columns = std::min(2000, IMGUI_TABLE_MAX_COLUMNS - 1);
+
+template <typename SubmitRow>
+void wide_table_frame(SubmitRow submit_row) {
+  constexpr ImGuiTableFlags flags = ImGuiTableFlags_ScrollX |
+                                    ImGuiTableFlags_ScrollY |
+                                    ImGuiTableFlags_Borders |
+                                    ImGuiTableFlags_RowBg;
+  Headless::begin_frame();
+  if (ImGui::BeginTable("wide", n_table_columns, flags)) {
+    ImGui::TableSetupScrollFreeze(1, 1);
+    for (int c = 0; c < n_table_columns; c++)
+      ImGui::TableSetupColumn(nullptr, ImGuiTableColumnFlags_WidthFixed, 60.f);
+    ImGui::TableHeadersRow();
+    ImGui::SetScrollX(30.f * n_table_columns);
+
+    ImGuiListClipper clipper;
+    clipper.Begin(10000);
+    while (clipper.Step())
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        ImGui::TableNextRow();
+        submit_row();
+      }
+    ImGui::EndTable();
+  }
+  Headless::end_frame();
+}
+
+void add_table_benchmarks(bench::Suite& suite) {
+  // Visiting every column of every row, as tables are usually submitted.
+  suite.add("table/wide_columns_naive", 1, [](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++)
+      wide_table_frame([] {
+        for (int c = 0; c < n_table_columns; c++)
+          if (ImGui::TableSetColumnIndex(c)) ImGui::TextUnformatted("cell");
+      });
+  });
+
+  // Only visiting the columns in sight.
+  suite.add("table/wide_columns_visible", 1, [](std::uint64_t iters) {
+    for (std::uint64_t i = 0; i < iters; i++)
+      wide_table_frame([] {
+        while (ImGui::TableNextVisibleColumn()) ImGui::TextUnformatted("cell");
+      });
+  });
+}
+
+void add_format_benchmarks(bench::Suite& suite) {
+  // ImFormatNumber against the vsnprintf path of ImFormatString, which it
+  // replaces for tick labels, heatmap labels, and scalar widgets.
+  constexpr std::size_t n_values = 1024;
+  auto values = std::make_shared<std::vector<double>>(
+      random_values(n_values, 4));
+  const std::pair<const char*, const char*> formats[] = {
+      {"fixed", "%.3f"}, {"general", "%g"}, {"percent", "%.1f%%"}};
+  for (const auto& format : formats) {
+    const char* fmt = format.second;
+    suite.add(std::string("format/imformatstring_") + format.first, n_values,
+              [values, fmt](std::uint64_t iters) {
+                char buf[64];
+                for (std::uint64_t i = 0; i < iters; i++)
+                  for (double v : *values)
+                    bench::do_not_optimize(
+                        ImFormatString(buf, sizeof(buf), fmt, v));
+              });
+    suite.add(std::string("format/imformatnumber_") + format.first, n_values,
+              [values, fmt](std::uint64_t iters) {
+                char buf[64];
+                for (std::uint64_t i = 0; i < iters; i++)
+                  for (double v : *values)
+                    bench::do_not_optimize(
+                        ImFormatNumber(buf, sizeof(buf), fmt, v));
+              });
+  }
+
+  suite.add("format/imformatstring_int", n_values, [](std::uint64_t iters) {
+    char buf[64];
+    for (std::uint64_t i = 0; i < iters; i++)
+      for (int v = 0; v < static_cast<int>(n_values); v++)
+        bench::do_not_optimize(
+            ImFormatString(buf, sizeof(buf), "%d", v * 7919));
+  });
+  suite.add("format/imformatnumber_int", n_values, [](std::uint64_t iters) {
+    char buf[64];
+    for (std::uint64_t i = 0; i < iters; i++)
+      for (int v = 0; v < static_cast<int>(n_values); v++)
+        bench::do_not_optimize(
+            ImFormatNumber(buf, sizeof(buf), "%d", v * 7919));
+  });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Headless context;
+
+  bench::Suite suite;
+  add_draw_list_benchmarks(suite);
+  add_implot_benchmarks(suite);
+  add_image_benchmarks(suite);
+  add_codec_benchmarks(suite);
+  add_resample_benchmarks(suite);
+  add_residency_benchmarks(suite);
+  add_storage_benchmarks(suite);
+  add_tree_benchmarks(suite);
+  add_text_editor_benchmarks(suite);
+  add_table_benchmarks(suite);
+  add_format_benchmarks(suite);
+  return suite.run(argc, argv);
+}
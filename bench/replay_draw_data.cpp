@@ -0,0 +1,189 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+
+// Usage: imapp_replay <capture file> [passes]
+//
+// Replays every frame of a capture made with App::capture_frames through
+// ImGui_ImplOpenGL3_RenderDrawData in a hidden window, and reports the
+// throughput. The font atlas is rebuilt with the default ImGui font, and all
+// other textures are replaced by a single white texture, so only geometry and
+// state changes are measured, and not the contents of the textures.
+
+#include <GLFW/glfw3.h>
+
+#include <ImApp/draw_capture.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "imgui/imgui_impl_opengl3.h"
+
+static GLuint make_white_texture() {
+  const std::uint32_t white = 0xFFFFFFFF;
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               &white);
+  return texture;
+}
+
+static int replay(const char* fname, int passes) {
+  ImApp::DrawDataReader reader(fname);
+  std::vector<ImApp::CapturedFrame> frames = reader.read_all();
+  if (frames.empty()) {
+    std::fprintf(stderr, "imapp_replay: \"%s\" contains no frames.\n", fname);
+    return 1;
+  }
+
+  const ImDrawData& first = frames.front().draw_data();
+  const int fb_w =
+      static_cast<int>(first.DisplaySize.x * first.FramebufferScale.x);
+  const int fb_h =
+      static_cast<int>(first.DisplaySize.y * first.FramebufferScale.y);
+
+  if (!glfwInit()) return 1;
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#if defined(__APPLE__)
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  const char* glsl_version = "#version 150";
+#else
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+  const char* glsl_version = "#version 130";
+#endif
+  GLFWwindow* window = glfwCreateWindow(fb_w > 0 ? fb_w : 1,
+                                        fb_h > 0 ? fb_h : 1, "imapp_replay",
+                                        nullptr, nullptr);
+  if (window == nullptr) {
+    glfwTerminate();
+    return 1;
+  }
+  glfwMakeContextCurrent(window);
+  glfwSwapInterval(0);
+
+  ImGui::CreateContext();
+  ImGui_ImplOpenGL3_Init(glsl_version);
+  ImGui::GetIO().Fonts->AddFontDefault();
+  ImGui_ImplOpenGL3_NewFrame();  // Creates the device objects and font atlas
+
+  const ImTextureID font = ImGui::GetIO().Fonts->TexID;
+  const GLuint white = make_white_texture();
+  std::size_t n_vtx = 0, n_idx = 0, n_cmds = 0;
+  for (auto& frame : frames) {
+    frame.remap_textures([font, white](std::uint64_t, bool is_font) {
+      return is_font ? font : (ImTextureID)(std::intptr_t)white;
+    });
+    n_vtx += static_cast<std::size_t>(frame.draw_data().TotalVtxCount);
+    n_idx += static_cast<std::size_t>(frame.draw_data().TotalIdxCount);
+    n_cmds += frame.command_count();
+  }
+
+  // One untimed pass, so that buffer allocations in the driver are warm.
+  auto render_pass = [&frames, fb_w, fb_h]() {
+    for (auto& frame : frames) {
+      glViewport(0, 0, fb_w, fb_h);
+      glClear(GL_COLOR_BUFFER_BIT);
+      ImGui_ImplOpenGL3_RenderDrawData(&frame.draw_data());
+    }
+    glFinish();
+  };
+  render_pass();
+
+  std::vector<double> pass_ms;
+  for (int p = 0; p < passes; p++) {
+    const auto begin = std::chrono::steady_clock::now();
+    render_pass();
+    const std::chrono::duration<double, std::milli> time =
+        std::chrono::steady_clock::now() - begin;
+    pass_ms.push_back(time.count());
+  }
+
+  double total_ms = 0., best_ms = pass_ms.front();
+  for (double ms : pass_ms) {
+    total_ms += ms;
+    if (ms < best_ms) best_ms = ms;
+  }
+  const double mean_ms = total_ms / static_cast<double>(passes);
+  const double n_frames = static_cast<double>(frames.size());
+
+  std::printf("frames          : %zu (%d x %d)\n", frames.size(), fb_w, fb_h);
+  std::printf("per frame       : %.1f vertices, %.1f indices, %.1f cmds\n",
+              static_cast<double>(n_vtx) / n_frames,
+              static_cast<double>(n_idx) / n_frames,
+              static_cast<double>(n_cmds) / n_frames);
+  std::printf("passes          : %d\n", passes);
+  std::printf("frame time (ms) : mean %.4f, best %.4f\n", mean_ms / n_frames,
+              best_ms / n_frames);
+  std::printf("frames/s        : %.1f\n", 1000. * n_frames / mean_ms);
+  std::printf("vertices/s      : %.4g\n",
+              1000. * static_cast<double>(n_vtx) / mean_ms);
+  std::printf("triangles/s     : %.4g\n",
+              1000. * static_cast<double>(n_idx / 3) / mean_ms);
+
+  glDeleteTextures(1, &white);
+  ImGui_ImplOpenGL3_Shutdown();
+  ImGui::DestroyContext();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s <capture file> [passes]\n", argv[0]);
+    return 1;
+  }
+
+  const int passes = argc > 2 ? std::atoi(argv[2]) : 20;
+  if (passes <= 0) {
+    std::fprintf(stderr, "imapp_replay: passes must be positive.\n");
+    return 1;
+  }
+
+  try {
+    return replay(argv[1], passes);
+  } catch (const std::exception& err) {
+    std::fprintf(stderr, "imapp_replay: %s\n", err.what());
+    return 1;
+  }
+}
@@ -0,0 +1,471 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_CODEC_H
+#define IMAPP_CODEC_H
+
+#include <ImApp/image.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ImApp {
+
+/**
+ * @brief File formats which can be recognized from the first bytes of a file.
+ * Formats without a signature, such as TGA, are Unknown.
+ */
+enum class ImageFormat {
+  Unknown,
+  PNG,
+  JPEG,
+  WebP,
+  GIF,
+  BMP,
+  PSD,
+  HDR,
+  PNM,
+  PIC
+};
+
+/**
+ * @brief Returns the format of an encoded image, from its signature.
+ * @param data Pointer to the start of the encoded image.
+ * @param size Number of bytes at data.
+ */
+ImageFormat detect_format(const unsigned char* data, std::size_t size);
+
+/**
+ * @brief Destination for the pixels of a decoder. A sink asks for a number
+ * of channels (1 to 4, as gray, gray + alpha, RGB, or RGBA), with 8 or 16
+ * bits per channel in native byte order. The decoder converts the pixels of
+ * the file to that layout, calls begin once the size of the image is known,
+ * and then writes every row, reporting finished rows with rows_ready.
+ */
+class DecodeSink {
+ public:
+  DecodeSink(int channels, int bit_depth)
+      : channels_(channels), bit_depth_(bit_depth) {}
+  virtual ~DecodeSink() = default;
+
+  /**
+   * @brief Number of channels which the decoder must write.
+   */
+  int channels() const { return channels_; }
+
+  /**
+   * @brief Bits per channel which the decoder must write, either 8 or 16.
+   */
+  int bit_depth() const { return bit_depth_; }
+
+  /**
+   * @brief Height of the image, once begin has been called.
+   */
+  std::uint32_t height() const { return height_; }
+
+  /**
+   * @brief Width of the image, once begin has been called.
+   */
+  std::uint32_t width() const { return width_; }
+
+  /**
+   * @brief Number of bytes in one row of pixels, without any padding.
+   */
+  std::size_t row_bytes() const { return width_ * pixel_bytes(); }
+
+  /**
+   * @brief Number of bytes in one pixel.
+   */
+  std::size_t pixel_bytes() const {
+    return static_cast<std::size_t>(channels_ * bit_depth_ / 8);
+  }
+
+  /**
+   * @brief Called by the decoder once the size of the image is known. It may
+   * be called again if a decoder fails, and another one is tried.
+   * @param height Number of rows of the image.
+   * @param width Number of columns of the image.
+   */
+  void begin(std::uint32_t height, std::uint32_t width) {
+    height_ = height;
+    width_ = width;
+    this->allocate(height, width);
+  }
+
+  /**
+   * @brief Returns where the pixels of a row are written. There is room for
+   * row_bytes() bytes.
+   * @param y Index of the row, in the interval [0,height).
+   */
+  virtual unsigned char* row(std::uint32_t y) = 0;
+
+  /**
+   * @brief Number of bytes between the starts of two rows.
+   */
+  virtual std::size_t stride() const = 0;
+
+  /**
+   * @brief Called by the decoder once the rows [y_begin,y_end) hold their
+   * final pixels. Rows are finished from top to bottom, though a decoder may
+   * only be able to report all of them at the end.
+   */
+  virtual void rows_ready(std::uint32_t /*y_begin*/, std::uint32_t /*y_end*/) {
+  }
+
+ protected:
+  virtual void allocate(std::uint32_t height, std::uint32_t width) = 0;
+
+ private:
+  int channels_;
+  int bit_depth_;
+  std::uint32_t height_ = 0;
+  std::uint32_t width_ = 0;
+};
+
+/**
+ * @brief A DecodeSink which decodes straight into the rows of an image.
+ * Pixel types with 8-bit channels are decoded with their own number of
+ * channels, and PixelR16 as 16-bit gray.
+ */
+template <typename P>
+class ImageDecodeSink : public DecodeSink {
+  static_assert(PixelTraits<P>::format == PixelFormat::R8 ||
+                    PixelTraits<P>::format == PixelFormat::R16 ||
+                    PixelTraits<P>::format == PixelFormat::RG8 ||
+                    PixelTraits<P>::format == PixelFormat::RGB8 ||
+                    PixelTraits<P>::format == PixelFormat::RGBA8,
+                "ImageDecodeSink needs 8 or 16 bit integer pixels.");
+
+ public:
+  /**
+   * @param options Options for the pixel storage of the image. The pixels
+   * are never initialized, as every one of them is decoded.
+   */
+  explicit ImageDecodeSink(ImageOptions options = ImageOptions())
+      : DecodeSink(PixelTraits<P>::channels,
+                   8 * static_cast<int>(sizeof(P)) / PixelTraits<P>::channels),
+        options_(std::move(options)),
+        image_(0, 0),
+        view_() {
+    options_.initialize = false;
+  }
+
+  unsigned char* row(std::uint32_t y) override {
+    return reinterpret_cast<unsigned char*>(view_.row(y));
+  }
+
+  std::size_t stride() const override { return view_.stride() * sizeof(P); }
+
+  /**
+   * @brief Returns a view of the image which is being decoded.
+   */
+  typename BasicImage<P>::const_view_type view() const { return view_; }
+
+  /**
+   * @brief Returns the decoded image, leaving the sink empty.
+   */
+  BasicImage<P> take() {
+    view_ = typename BasicImage<P>::view_type();
+    return std::move(image_);
+  }
+
+ protected:
+  void allocate(std::uint32_t height, std::uint32_t width) override {
+    image_ = BasicImage<P>(height, width, options_);
+    view_ = image_.view();
+  }
+
+ private:
+  ImageOptions options_;
+  BasicImage<P> image_;
+  typename BasicImage<P>::view_type view_;
+};
+
+/**
+ * @brief Interface of an image decoder, which can be registered with the
+ * CodecRegistry.
+ */
+class ImageDecoder {
+ public:
+  virtual ~ImageDecoder() = default;
+
+  /**
+   * @brief Returns a short name which identifies the decoder, such as "stb".
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * @brief Returns true if the decoder should be tried for files of the
+   * given format.
+   */
+  virtual bool supports(ImageFormat format) const = 0;
+
+  /**
+   * @brief Decodes an image into a sink.
+   * @param data Pointer to the start of the encoded image.
+   * @param size Number of bytes at data.
+   * @param sink Destination of the decoded pixels.
+   * @param error Set to the reason of the failure if the image could not be
+   * decoded.
+   * @return True if the image was decoded.
+   */
+  virtual bool decode(const unsigned char* data, std::size_t size,
+                      DecodeSink& sink, std::string& error) = 0;
+
+  /**
+   * @brief Decodes an image while reading it from a stream, so the whole
+   * file never has to be in memory. The default reads the rest of the
+   * stream, and hands it to decode.
+   * @param stream Stream positioned at the start of the encoded image.
+   * @param sink Destination of the decoded pixels.
+   * @param error Set to the reason of the failure if the image could not be
+   * decoded.
+   * @return True if the image was decoded.
+   */
+  virtual bool decode_stream(std::istream& stream, DecodeSink& sink,
+                             std::string& error);
+
+  /**
+   * @brief Decodes a smaller version of an image, for decoders which can do
+   * so much faster than decoding the whole image. The default supports no
+   * previews.
+   * @param stream Stream positioned at the start of the encoded image.
+   * @param sink Destination of the preview.
+   * @param max_size The preview should be at least this many pixels along
+   * its longer side.
+   * @param error Set to the reason if no preview was made.
+   * @return True if a preview was decoded.
+   */
+  virtual bool preview(std::istream& stream, DecodeSink& sink,
+                       std::uint32_t max_size, std::string& error);
+};
+
+/**
+ * @brief Holds the image decoders which are used by BasicImage::from_file,
+ * in order of preference. The fastest decoders which were found by CMake
+ * (libjpeg-turbo, libpng, and libwebp) are registered first, followed by
+ * stb_image, which can decode every other format. When a decoder fails, the
+ * next one which supports the format is tried.
+ */
+class CodecRegistry {
+ public:
+  /**
+   * @brief Returns the registry used by BasicImage::from_file.
+   */
+  static CodecRegistry& global();
+
+  /**
+   * @brief Creates a registry containing the built-in decoders.
+   */
+  CodecRegistry();
+
+  /**
+   * @brief Adds a decoder, which is preferred over all decoders which are
+   * already registered.
+   */
+  void add(std::shared_ptr<ImageDecoder> decoder);
+
+  /**
+   * @brief Removes the decoder with the given name. Returns true if a
+   * decoder was removed.
+   */
+  bool remove(const std::string& name);
+
+  /**
+   * @brief Returns the decoder with the given name, or nullptr.
+   */
+  std::shared_ptr<ImageDecoder> find(const std::string& name) const;
+
+  /**
+   * @brief Returns all decoders, in order of preference.
+   */
+  std::vector<std::shared_ptr<ImageDecoder>> decoders() const;
+
+  /**
+   * @brief Decodes an image with the first decoder which supports its
+   * format and succeeds. An std::runtime_error is thrown, with the reason
+   * given by every decoder which was tried, if none succeeds.
+   * @param data Pointer to the start of the encoded image.
+   * @param size Number of bytes at data.
+   * @param sink Destination of the decoded pixels.
+   */
+  void decode(const unsigned char* data, std::size_t size,
+              DecodeSink& sink) const;
+
+  /**
+   * @brief Decodes an image while reading it from a stream, trying the
+   * decoders in the same way as for an image in memory. The stream must
+   * support seeking, so that every decoder can start from the beginning.
+   * @param stream Stream positioned at the start of the encoded image.
+   * @param sink Destination of the decoded pixels.
+   */
+  void decode(std::istream& stream, DecodeSink& sink) const;
+
+  /**
+   * @brief Decodes a smaller version of an image with the first decoder
+   * which can do so quickly, such as libjpeg, which can decode at 1/8 scale.
+   * The stream is returned to where it started.
+   * @param stream Stream positioned at the start of the encoded image.
+   * @param sink Destination of the preview.
+   * @param max_size The preview should be at least this many pixels along
+   * its longer side.
+   * @return True if a preview was decoded.
+   */
+  bool preview(std::istream& stream, DecodeSink& sink,
+               std::uint32_t max_size) const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<ImageDecoder>> decoders_;
+};
+
+/**
+ * @brief Callbacks which follow the progress of decode_file. They are called
+ * on the thread which runs decode_file, so an application would typically
+ * decode on a JobSystem worker, and App::post the results which are needed
+ * by the main thread.
+ */
+template <typename P>
+struct DecodeCallbacks {
+  /**
+   * @brief Called with a quickly decoded, smaller version of the image,
+   * before the full decode starts. Only some decoders can make previews.
+   */
+  std::function<void(BasicImage<P> preview)> on_preview;
+
+  /**
+   * @brief Called once the size of the image is known. It is called again
+   * if a decoder fails part way, and the next decoder starts over.
+   */
+  std::function<void(std::uint32_t height, std::uint32_t width)> on_size;
+
+  /**
+   * @brief Called with every band of rows which has been decoded, starting
+   * at row y. The view is only valid during the call, so the rows must be
+   * copied if they are needed later.
+   */
+  std::function<void(std::uint32_t y, BasicImageView<const P> rows)> on_rows;
+
+  /**
+   * @brief Minimum number of rows in the bands given to on_rows, other
+   * than the last one.
+   */
+  std::uint32_t band_rows = 64;
+
+  /**
+   * @brief Minimum size of the longer side of the preview.
+   */
+  std::uint32_t preview_size = 256;
+};
+
+namespace detail {
+template <typename P>
+class StreamingSink : public ImageDecodeSink<P> {
+ public:
+  StreamingSink(const DecodeCallbacks<P>& callbacks, ImageOptions options)
+      : ImageDecodeSink<P>(std::move(options)),
+        callbacks_(callbacks),
+        emitted_(0) {}
+
+  void rows_ready(std::uint32_t /*y_begin*/, std::uint32_t y_end) override {
+    const std::uint32_t band = std::max(callbacks_.band_rows, 1u);
+    if (y_end <= emitted_) return;
+    if (y_end - emitted_ < band && y_end < this->height()) return;
+
+    if (callbacks_.on_rows) {
+      callbacks_.on_rows(
+          emitted_, this->view().sub(emitted_, 0, y_end - emitted_,
+                                     this->width()));
+    }
+    emitted_ = y_end;
+  }
+
+ protected:
+  void allocate(std::uint32_t height, std::uint32_t width) override {
+    ImageDecodeSink<P>::allocate(height, width);
+    emitted_ = 0;
+    if (callbacks_.on_size) callbacks_.on_size(height, width);
+  }
+
+ private:
+  const DecodeCallbacks<P>& callbacks_;
+  std::uint32_t emitted_;
+};
+}  // namespace detail
+
+/**
+ * @brief Decodes an image file while it is being read, reporting a preview
+ * and bands of decoded rows through callbacks, so that a large image can be
+ * shown before it has been fully decoded. Decoders which can't produce rows
+ * as they go report all of them at the end. An std::runtime_error is thrown
+ * if the file can't be opened or decoded.
+ * @param fname Path to the image file.
+ * @param callbacks Callbacks which are told about the progress.
+ * @param options Options for the pixel storage.
+ * @return The fully decoded image.
+ */
+template <typename P>
+BasicImage<P> decode_file(const std::filesystem::path& fname,
+                          const DecodeCallbacks<P>& callbacks,
+                          const ImageOptions& options = ImageOptions()) {
+  std::ifstream file(fname, std::ios::binary);
+  if (!file) {
+    std::string mssg = "ImApp::decode_file: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  const CodecRegistry& registry = CodecRegistry::global();
+  if (callbacks.on_preview) {
+    ImageDecodeSink<P> preview(options);
+    if (registry.preview(file, preview, callbacks.preview_size))
+      callbacks.on_preview(preview.take());
+  }
+
+  detail::StreamingSink<P> sink(callbacks, options);
+  registry.decode(file, sink);
+  return sink.take();
+}
+
+}  // namespace ImApp
+#endif
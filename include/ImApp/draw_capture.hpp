@@ -0,0 +1,161 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_DRAW_CAPTURE_H
+#define IMAPP_DRAW_CAPTURE_H
+
+#include <ImApp/imgui.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ImApp {
+
+/**
+ * @brief Writes the ImDrawData of rendered frames to a compact binary file,
+ * so that real workloads can later be replayed for benchmarking. Every frame
+ * stores all draw lists with their commands, vertices, and indices. Textures
+ * are stored by reference only, together with a flag marking the font atlas.
+ * User callbacks can't be stored, so commands which use them are dropped,
+ * with the exception of ImDrawCallback_ResetRenderState.
+ */
+class DrawDataWriter {
+ public:
+  /**
+   * @brief Creates the capture file, and writes its header. An
+   * std::runtime_error is thrown if the file can't be opened.
+   * @param fname Path to the capture file.
+   */
+  explicit DrawDataWriter(const std::filesystem::path& fname);
+
+  /**
+   * @brief Appends a frame to the capture file.
+   * @param draw_data Draw data returned by ImGui::GetDrawData after
+   * ImGui::Render.
+   * @param font_texture Texture ID of the font atlas.
+   */
+  void write(const ImDrawData& draw_data, ImTextureID font_texture);
+
+  /**
+   * @brief Returns the number of frames written so far.
+   */
+  std::uint32_t frames() const { return frames_; }
+
+ private:
+  std::ofstream file_;
+  std::uint32_t frames_;
+};
+
+/**
+ * @brief A frame which has been read back from a capture file. It owns its
+ * draw lists, and provides an ImDrawData which can be handed to a renderer
+ * backend.
+ */
+class CapturedFrame {
+ public:
+  CapturedFrame() = default;
+  CapturedFrame(CapturedFrame&&) = default;
+  CapturedFrame& operator=(CapturedFrame&&) = default;
+
+  /**
+   * @brief Returns the draw data of the frame. Texture IDs refer to the
+   * textures of the captured application until remap_textures is called.
+   */
+  ImDrawData& draw_data() { return draw_data_; }
+
+  /**
+   * @brief Replaces the texture of every draw command.
+   * @param map Function called as map(captured_id, is_font_atlas), which
+   * returns the texture ID to use for the replay.
+   */
+  void remap_textures(
+      const std::function<ImTextureID(std::uint64_t, bool)>& map);
+
+  /**
+   * @brief Returns the total number of draw commands in the frame.
+   */
+  std::size_t command_count() const { return textures_.size(); }
+
+ private:
+  struct TextureRef {
+    ImDrawCmd* cmd;
+    std::uint64_t id;
+    bool is_font;
+  };
+
+  std::vector<std::unique_ptr<ImDrawList>> lists_;
+  std::vector<TextureRef> textures_;
+  ImDrawData draw_data_;
+
+  friend class DrawDataReader;
+};
+
+/**
+ * @brief Reads frames from a file created by DrawDataWriter. An
+ * std::runtime_error is thrown if the file can't be opened, is not a capture
+ * file, or was captured with a different ImDrawVert or ImDrawIdx layout. The
+ * same is thrown when a frame is truncated, or has counts, offsets or indices
+ * which do not fit its data.
+ */
+class DrawDataReader {
+ public:
+  /**
+   * @brief Opens a capture file, and validates its header.
+   * @param fname Path to the capture file.
+   */
+  explicit DrawDataReader(const std::filesystem::path& fname);
+
+  /**
+   * @brief Reads the next frame from the file.
+   * @param frame Frame into which the data is read.
+   * @return True if a frame was read, and false at the end of the file.
+   */
+  bool read(CapturedFrame& frame);
+
+  /**
+   * @brief Reads all remaining frames from the file.
+   */
+  std::vector<CapturedFrame> read_all();
+
+ private:
+  std::ifstream file_;
+  std::uint64_t size_;
+
+  std::uint64_t remaining();
+};
+
+}  // namespace ImApp
+#endif
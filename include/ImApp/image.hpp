@@ -0,0 +1,1196 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_IMAGE_H
+#define IMAPP_IMAGE_H
+
+#include <ImApp/implot.h>
+#include <ImApp/pixel_allocator.hpp>
+#include <ImApp/texture.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ImApp {
+
+/**
+ * @brief The layout of the pixels of an image, which determines the number
+ * of channels, and the type of each channel.
+ */
+enum class PixelFormat {
+  R8,     /**< One 8-bit normalized channel. */
+  R16,    /**< One 16-bit normalized channel. */
+  R32F,   /**< One 32-bit float channel. */
+  RG8,    /**< Two 8-bit normalized channels. */
+  RGB8,   /**< Three 8-bit normalized channels. */
+  RGBA8,  /**< Four 8-bit normalized channels. */
+  RGBA16F /**< Four 16-bit float channels. */
+};
+
+/**
+ * @brief Converts a float to the bits of an IEEE 754 half precision float,
+ * rounding to the nearest representable value.
+ */
+inline std::uint16_t float_to_half(float value) {
+  std::uint32_t x;
+  std::memcpy(&x, &value, sizeof(x));
+  const std::uint32_t sign = (x >> 16) & 0x8000u;
+  const std::uint32_t abs = x & 0x7FFFFFFFu;
+
+  // Infinity and NaN
+  if (abs >= 0x7F800000u) {
+    return static_cast<std::uint16_t>(sign | 0x7C00u |
+                                      (abs > 0x7F800000u ? 0x200u : 0u));
+  }
+
+  // Too large, so we round to infinity
+  if (abs >= 0x477FF000u) return static_cast<std::uint16_t>(sign | 0x7C00u);
+
+  // Subnormal half, or zero
+  if (abs < 0x38800000u) {
+    if (abs < 0x33000000u) return static_cast<std::uint16_t>(sign);
+    const std::uint32_t exp = abs >> 23;
+    const std::uint32_t mant = (abs & 0x7FFFFFu) | 0x800000u;
+    const std::uint32_t shift = 126u - exp;
+    std::uint32_t h = mant >> shift;
+    const std::uint32_t rem = mant & ((1u << shift) - 1u);
+    const std::uint32_t halfway = 1u << (shift - 1u);
+    if (rem > halfway || (rem == halfway && (h & 1u))) h++;
+    return static_cast<std::uint16_t>(sign | h);
+  }
+
+  // Normal half, where we rebias the exponent from 127 to 15
+  std::uint32_t h = (abs - 0x38000000u) >> 13;
+  const std::uint32_t rem = abs & 0x1FFFu;
+  if (rem > 0x1000u || (rem == 0x1000u && (h & 1u))) h++;
+  return static_cast<std::uint16_t>(sign | h);
+}
+
+/**
+ * @brief Converts the bits of an IEEE 754 half precision float to a float.
+ */
+inline float half_to_float(std::uint16_t bits) {
+  const std::uint32_t sign = (bits & 0x8000u) << 16;
+  std::uint32_t exp = (bits >> 10) & 0x1Fu;
+  std::uint32_t mant = bits & 0x3FFu;
+  std::uint32_t x;
+
+  if (exp == 0) {
+    if (mant == 0) {
+      x = sign;
+    } else {
+      // Subnormal, which is normalized for the float
+      exp = 113;
+      while ((mant & 0x400u) == 0) {
+        mant <<= 1;
+        exp--;
+      }
+      x = sign | (exp << 23) | ((mant & 0x3FFu) << 13);
+    }
+  } else if (exp == 31) {
+    x = sign | 0x7F800000u | (mant << 13);
+  } else {
+    x = sign | ((exp + 112u) << 23) | (mant << 13);
+  }
+
+  float value;
+  std::memcpy(&value, &x, sizeof(value));
+  return value;
+}
+
+/**
+ * @brief A 16-bit floating point number, as used by PixelFormat::RGBA16F.
+ */
+class Half {
+ public:
+  Half() : bits_(0) {}
+  Half(float value) : bits_(float_to_half(value)) {}
+
+  operator float() const { return half_to_float(bits_); }
+
+  /**
+   * @brief Returns the raw bits of the number.
+   */
+  std::uint16_t bits() const { return bits_; }
+
+ private:
+  std::uint16_t bits_;
+};
+
+/**
+ * @brief A class which represents a single pixel in an image. Each pixel has
+ * four 8-bit channels: Red, Green, Blue, and Alpha.
+ */
+class Pixel {
+ public:
+  Pixel() : r_(255), g_(255), b_(255), a_(255) {}
+
+  /**
+   * @breif Constructs a pixel with a specified color and opacity.
+   * @param R Value of the red channel in [0,255].
+   * @param G Value of the green channel in [0,255].
+   * @param B Value of the blue channel in [0,255].
+   * @param A Value of alpha (the opacity) in [0,255].
+   */
+  Pixel(std::uint8_t R, std::uint8_t G, std::uint8_t B, std::uint8_t A = 255)
+      : r_(R), g_(G), b_(B), a_(A) {}
+
+  /**
+   * @brief Returns a modifiable reference to the red channel.
+   */
+  std::uint8_t& r() { return r_; }
+
+  /**
+   * @brief Returns a const reference to the red channel.
+   */
+  const std::uint8_t& r() const { return r_; }
+
+  /**
+   * @brief Returns a modifiable reference to the green channel.
+   */
+  std::uint8_t& g() { return g_; }
+
+  /**
+   * @brief Returns a const reference to the green channel.
+   */
+  const std::uint8_t& g() const { return g_; }
+
+  /**
+   * @brief Returns a modifiable reference to the blue channel.
+   */
+  std::uint8_t& b() { return b_; }
+
+  /**
+   * @brief Returns a const reference to the blue channel.
+   */
+  const std::uint8_t& b() const { return b_; }
+
+  /**
+   * @brief Returns a modifiable reference to the alpha channel.
+   */
+  std::uint8_t& a() { return a_; }
+
+  /**
+   * @brief Returns a const reference to the alpha channel.
+   */
+  const std::uint8_t& a() const { return a_; }
+
+ private:
+  std::uint8_t r_, g_, b_, a_;
+};
+
+using PixelRGBA8 = Pixel;
+
+/**
+ * @brief A pixel with a single 8-bit channel, such as a grayscale value.
+ */
+struct PixelR8 {
+  std::uint8_t r = 255;
+};
+
+/**
+ * @brief A pixel with a single 16-bit channel, such as a detector count.
+ */
+struct PixelR16 {
+  std::uint16_t r = 65535;
+};
+
+/**
+ * @brief A pixel with a single float channel, such as a scalar field.
+ */
+struct PixelR32F {
+  float r = 1.f;
+};
+
+/**
+ * @brief A pixel with two 8-bit channels.
+ */
+struct PixelRG8 {
+  std::uint8_t r = 255, g = 255;
+};
+
+/**
+ * @brief A pixel with three 8-bit channels, and no alpha.
+ */
+struct PixelRGB8 {
+  std::uint8_t r = 255, g = 255, b = 255;
+};
+
+/**
+ * @brief A pixel with four 16-bit float channels, for high dynamic range
+ * images.
+ */
+struct PixelRGBA16F {
+  Half r = 1.f, g = 1.f, b = 1.f, a = 1.f;
+};
+
+namespace detail {
+inline std::uint8_t to_unorm8(float v) {
+  return static_cast<std::uint8_t>(std::clamp(v, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+inline std::uint16_t to_unorm16(float v) {
+  return static_cast<std::uint16_t>(std::clamp(v, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+// Rec. 709 luma, used to reduce color to a single channel
+inline float luma(const std::array<float, 4>& c) {
+  return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+}  // namespace detail
+
+/**
+ * @brief Describes a pixel type. Every pixel can be converted to and from
+ * normalized RGBA, where normalized channels are in [0,1], and float channels
+ * are kept as is. Single channel pixels expand to gray, and color is reduced
+ * to a single channel by its luma.
+ */
+template <typename P>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<PixelR8> {
+  static constexpr PixelFormat format = PixelFormat::R8;
+  static constexpr int channels = 1;
+  static std::array<float, 4> to_rgba(const PixelR8& p) {
+    const float v = p.r / 255.f;
+    return {v, v, v, 1.f};
+  }
+  static PixelR8 from_rgba(const std::array<float, 4>& c) {
+    return {detail::to_unorm8(detail::luma(c))};
+  }
+};
+
+template <>
+struct PixelTraits<PixelR16> {
+  static constexpr PixelFormat format = PixelFormat::R16;
+  static constexpr int channels = 1;
+  static std::array<float, 4> to_rgba(const PixelR16& p) {
+    const float v = p.r / 65535.f;
+    return {v, v, v, 1.f};
+  }
+  static PixelR16 from_rgba(const std::array<float, 4>& c) {
+    return {detail::to_unorm16(detail::luma(c))};
+  }
+};
+
+template <>
+struct PixelTraits<PixelR32F> {
+  static constexpr PixelFormat format = PixelFormat::R32F;
+  static constexpr int channels = 1;
+  static std::array<float, 4> to_rgba(const PixelR32F& p) {
+    return {p.r, p.r, p.r, 1.f};
+  }
+  static PixelR32F from_rgba(const std::array<float, 4>& c) {
+    return {detail::luma(c)};
+  }
+};
+
+template <>
+struct PixelTraits<PixelRG8> {
+  static constexpr PixelFormat format = PixelFormat::RG8;
+  static constexpr int channels = 2;
+  static std::array<float, 4> to_rgba(const PixelRG8& p) {
+    return {p.r / 255.f, p.g / 255.f, 0.f, 1.f};
+  }
+  static PixelRG8 from_rgba(const std::array<float, 4>& c) {
+    return {detail::to_unorm8(c[0]), detail::to_unorm8(c[1])};
+  }
+};
+
+template <>
+struct PixelTraits<PixelRGB8> {
+  static constexpr PixelFormat format = PixelFormat::RGB8;
+  static constexpr int channels = 3;
+  static std::array<float, 4> to_rgba(const PixelRGB8& p) {
+    return {p.r / 255.f, p.g / 255.f, p.b / 255.f, 1.f};
+  }
+  static PixelRGB8 from_rgba(const std::array<float, 4>& c) {
+    return {detail::to_unorm8(c[0]), detail::to_unorm8(c[1]),
+            detail::to_unorm8(c[2])};
+  }
+};
+
+template <>
+struct PixelTraits<Pixel> {
+  static constexpr PixelFormat format = PixelFormat::RGBA8;
+  static constexpr int channels = 4;
+  static std::array<float, 4> to_rgba(const Pixel& p) {
+    return {p.r() / 255.f, p.g() / 255.f, p.b() / 255.f, p.a() / 255.f};
+  }
+  static Pixel from_rgba(const std::array<float, 4>& c) {
+    return Pixel(detail::to_unorm8(c[0]), detail::to_unorm8(c[1]),
+                 detail::to_unorm8(c[2]), detail::to_unorm8(c[3]));
+  }
+};
+
+template <>
+struct PixelTraits<PixelRGBA16F> {
+  static constexpr PixelFormat format = PixelFormat::RGBA16F;
+  static constexpr int channels = 4;
+  static std::array<float, 4> to_rgba(const PixelRGBA16F& p) {
+    return {p.r, p.g, p.b, p.a};
+  }
+  static PixelRGBA16F from_rgba(const std::array<float, 4>& c) {
+    return {c[0], c[1], c[2], c[3]};
+  }
+};
+
+/**
+ * @brief A non-owning view of a rectangle of pixels, which may be all of an
+ * image, or only part of one. Consecutive rows are stride pixels apart, so
+ * sub-images can be referred to without copying. P may be const qualified
+ * for a read-only view. A view must not outlive the pixels it refers to.
+ */
+template <typename P>
+class BasicImageView {
+ public:
+  using pixel_type = std::remove_const_t<P>;
+
+  BasicImageView() : data_(nullptr), height_(0), width_(0), stride_(0) {}
+
+  /**
+   * @brief Creates a view of existing pixels.
+   * @param data Pointer to the first pixel of the first row.
+   * @param height Number of rows.
+   * @param width Number of pixels in each row.
+   * @param stride Number of pixels from the start of one row to the start of
+   * the next. Must be at least width.
+   */
+  BasicImageView(P* data, std::uint32_t height, std::uint32_t width,
+                 std::size_t stride)
+      : data_(data), height_(height), width_(width), stride_(stride) {
+    if (stride_ < width_) {
+      throw std::invalid_argument(
+          "ImApp::ImageView: stride must be >= width.");
+    }
+  }
+
+  /**
+   * @brief Allows a mutable view to be used as a read-only view.
+   */
+  template <typename Q, typename = std::enable_if_t<
+                            std::is_same_v<const Q, P> &&
+                            !std::is_same_v<Q, P>>>
+  BasicImageView(const BasicImageView<Q>& other)
+      : data_(other.data()),
+        height_(other.height()),
+        width_(other.width()),
+        stride_(other.stride()) {}
+
+  /**
+   * @brief Returns the width of the view.
+   */
+  std::uint32_t width() const { return width_; }
+
+  /**
+   * @brief Returns the height of the view.
+   */
+  std::uint32_t height() const { return height_; }
+
+  /**
+   * @brief Returns the number of pixels between the starts of two rows.
+   */
+  std::size_t stride() const { return stride_; }
+
+  /**
+   * @brief Returns a pointer to the first pixel of the view.
+   */
+  P* data() const { return data_; }
+
+  /**
+   * @brief Returns true if the view contains no pixels.
+   */
+  bool empty() const { return width_ == 0 || height_ == 0; }
+
+  /**
+   * @brief Returns true if there are no gaps between the rows of the view.
+   */
+  bool contiguous() const { return stride_ == width_ || height_ <= 1; }
+
+  /**
+   * @brief Returns a pointer to the first pixel of a row.
+   * @param h Index of the row, in the interval [0,height).
+   */
+  P* row(std::uint32_t h) const { return data_ + h * stride_; }
+
+  /**
+   * @brief Returns a reference to a pixel for a given row and column.
+   * @param h Index for the row of the pixel, in the interval [0,height).
+   * @param w Index for the column of the pixel, in the interval [0,width).
+   */
+  P& operator()(std::uint32_t h, std::uint32_t w) const {
+    return data_[h * stride_ + w];
+  }
+
+  /**
+   * @brief Returns a reference to a pixel for a given row and column. An
+   * std::out_of_range exception is thrown if the row or column are out of
+   * range.
+   * @param h Index for the row of the pixel, in the interval [0,height).
+   * @param w Index for the column of the pixel, in the interval [0,width).
+   */
+  P& at(std::uint32_t h, std::uint32_t w) const {
+    if (h >= height_) {
+      throw std::out_of_range("ImApp::ImageView::at: h must be < height.");
+    } else if (w >= width_) {
+      throw std::out_of_range("ImApp::ImageView::at: w must be < width.");
+    }
+
+    return (*this)(h, w);
+  }
+
+  /**
+   * @brief Returns a view of a rectangle inside of this view, without
+   * copying any pixels. An std::out_of_range exception is thrown if the
+   * rectangle does not fit inside of the view.
+   * @param y Row of the top left corner of the rectangle.
+   * @param x Column of the top left corner of the rectangle.
+   * @param height Height of the rectangle.
+   * @param width Width of the rectangle.
+   */
+  BasicImageView sub(std::uint32_t y, std::uint32_t x, std::uint32_t height,
+                     std::uint32_t width) const {
+    if (std::uint64_t(y) + height > height_ ||
+        std::uint64_t(x) + width > width_) {
+      throw std::out_of_range(
+          "ImApp::ImageView::sub: Rectangle is outside of the view.");
+    }
+
+    return BasicImageView(data_ + y * stride_ + x, height, width, stride_);
+  }
+
+ private:
+  P* data_;
+  std::uint32_t height_, width_;
+  std::size_t stride_;
+};
+
+/**
+ * @brief Copies the pixels of one view into another view of the same size.
+ * This may be used to assemble tiles into a larger image, or to extract a
+ * region into an image of its own.
+ * @param src View from which the pixels are read.
+ * @param dst View into which the pixels are written.
+ */
+template <typename P>
+void copy_pixels(BasicImageView<const P> src, BasicImageView<P> dst) {
+  if (src.height() != dst.height() || src.width() != dst.width()) {
+    throw std::invalid_argument(
+        "ImApp::copy_pixels: Views must have the same size.");
+  }
+
+  for (std::uint32_t h = 0; h < src.height(); h++) {
+    std::copy(src.row(h), src.row(h) + src.width(), dst.row(h));
+  }
+}
+
+/**
+ * @brief Options for the storage of the pixels of an image.
+ */
+struct ImageOptions {
+  /**
+   * @brief If false, the pixels are left uninitialized instead of being made
+   * white. This saves a pass over the memory when every pixel is about to be
+   * overwritten, such as when decoding a file.
+   */
+  bool initialize = true;
+
+  /**
+   * @brief If not zero, every row is padded so that it starts on a multiple
+   * of this many bytes, allowing SIMD code to use aligned loads on any row.
+   * Must be a power of two which is no larger than pixel_alignment.
+   */
+  std::size_t row_alignment = 0;
+
+  /**
+   * @brief Allocator which provides the pixel memory. If null, the
+   * allocator returned by default_pixel_allocator is used.
+   */
+  std::shared_ptr<PixelAllocator> allocator = nullptr;
+};
+
+namespace detail {
+struct UploadSource;
+
+template <typename P>
+UploadSource upload_source(const BasicImage<P>& image);
+}  // namespace detail
+
+/**
+ * @brief A class which respresents an image, containing an array of pixels of
+ * type P. All of the pixels are stored in row major order, in a buffer which
+ * is aligned to pixel_alignment. Rows may be padded (see ImageOptions), in
+ * which case consecutive rows are stride() pixels apart.
+ *
+ * Copying an image copies its pixels. To hand the pixels to another layer or
+ * thread without a copy, share() makes an image which refers to the same
+ * pixels, and changes made through either image are seen by both. Each image
+ * owns its own Texture, which is never shared by copies, and is deleted with
+ * the image. P may be any pixel
+ * type with a PixelTraits specialization. When sent to the GPU, the texture
+ * uses the matching OpenGL format, so a 16-bit or float image is not expanded
+ * to RGBA. Images with one channel are displayed in gray, and images with two
+ * channels are displayed in red and green.
+ */
+template <typename P>
+class BasicImage {
+ public:
+  using pixel_type = P;
+  using view_type = BasicImageView<P>;
+  using const_view_type = BasicImageView<const P>;
+  static constexpr PixelFormat format = PixelTraits<P>::format;
+  static constexpr int channels = PixelTraits<P>::channels;
+
+  static_assert(std::is_trivially_copyable_v<P>,
+                "Pixels are copied as raw memory.");
+
+  /**
+   * @breif Create an image of specified height and width.
+   * @param height Initial height of the image.
+   * @param width Initial width of the image.
+   */
+  BasicImage(std::uint32_t height, std::uint32_t width)
+      : BasicImage(height, width, ImageOptions()) {}
+
+  /**
+   * @brief Create an image of specified height and width, with control over
+   * how the pixels are stored. An std::invalid_argument exception is thrown
+   * if the row alignment is not valid.
+   * @param height Initial height of the image.
+   * @param width Initial width of the image.
+   * @param options Options for the pixel storage.
+   */
+  BasicImage(std::uint32_t height, std::uint32_t width,
+             const ImageOptions& options)
+      : height_(height),
+        width_(width),
+        stride_(padded_stride(width, options.row_alignment)),
+        row_alignment_(options.row_alignment),
+        image_(std::make_shared<detail::PixelBuffer>(
+            static_cast<std::size_t>(height) * stride_ * sizeof(P),
+            options.allocator)),
+        texture_() {
+    if (options.initialize) {
+      std::fill_n(this->data(), static_cast<std::size_t>(height_) * stride_,
+                  P());
+    }
+  }
+
+  /**
+   * @brief Creates an image holding a copy of the pixels of a view.
+   * @param src View of the pixels to be copied.
+   * @param options Options for the pixel storage. The initialize option is
+   * ignored, as every pixel is copied.
+   */
+  explicit BasicImage(const_view_type src,
+                      const ImageOptions& options = ImageOptions())
+      : BasicImage(src.height(), src.width(), uninitialized(options)) {
+    copy_pixels(src, this->view());
+  }
+
+  /**
+   * @brief Creates an image with a copy of the pixels of another image, using
+   * the same allocator and row alignment. The texture of the other image is
+   * not copied.
+   */
+  BasicImage(const BasicImage& other)
+      : height_(other.height_),
+        width_(other.width_),
+        stride_(other.stride_),
+        row_alignment_(other.row_alignment_),
+        image_(copy_buffer(other.image_)),
+        texture_() {}
+
+  /**
+   * @brief Copies the pixels of another image. The texture of this image is
+   * kept, and is updated by the next call to send_to_gpu.
+   */
+  BasicImage& operator=(const BasicImage& other) {
+    if (this != &other) {
+      height_ = other.height_;
+      width_ = other.width_;
+      stride_ = other.stride_;
+      row_alignment_ = other.row_alignment_;
+      image_ = copy_buffer(other.image_);
+    }
+    return *this;
+  }
+
+  BasicImage(BasicImage&& other) noexcept
+      : height_(std::exchange(other.height_, 0)),
+        width_(std::exchange(other.width_, 0)),
+        stride_(std::exchange(other.stride_, 0)),
+        row_alignment_(other.row_alignment_),
+        image_(std::move(other.image_)),
+        texture_(std::move(other.texture_)) {}
+
+  BasicImage& operator=(BasicImage&& other) noexcept {
+    if (this != &other) {
+      height_ = std::exchange(other.height_, 0);
+      width_ = std::exchange(other.width_, 0);
+      stride_ = std::exchange(other.stride_, 0);
+      row_alignment_ = other.row_alignment_;
+      image_ = std::move(other.image_);
+      this->delete_from_gpu();
+      texture_ = std::move(other.texture_);
+    }
+    return *this;
+  }
+
+  ~BasicImage() { this->delete_from_gpu(); }
+
+  /**
+   * @brief Loads an image from a file. Can be almost any common image type,
+   * which is decoded with the decoders of the global CodecRegistry.
+   * Files with 16 bits per channel keep their precision for PixelR16, and
+   * other files are converted to the pixel type of the image.
+   * @brief fname Path to the file containing the image.
+   * @param options Options for the pixel storage. The initialize option is
+   * ignored, as every pixel is decoded.
+   */
+  static BasicImage from_file(const std::filesystem::path& fname,
+                              const ImageOptions& options = ImageOptions());
+
+  /**
+   * @brief Decodes an image which is already in memory, with the decoders
+   * of the global CodecRegistry. An std::runtime_error is thrown if the
+   * image can't be decoded.
+   * @param data Pointer to the start of the encoded image.
+   * @param size Number of bytes at data.
+   * @param options Options for the pixel storage.
+   */
+  static BasicImage from_memory(const unsigned char* data, std::size_t size,
+                                const ImageOptions& options = ImageOptions());
+
+  /**
+   * @brief Saves the image in a PNG file. Images which are not 8-bit are
+   * converted first.
+   * @param fname Path to the file where the image will be written.
+   */
+  bool save_png(const std::filesystem::path& fname) const;
+
+  /**
+   * @brief Saves the image in a JPG file. Images which are not 8-bit are
+   * converted first.
+   * @param fname Path to the file where the image will be written.
+   */
+  bool save_jpg(const std::filesystem::path& fname) const;
+
+  /**
+   * @brief Returns the width of the image.
+   */
+  const std::uint32_t& width() const { return width_; }
+
+  /**
+   * @brief Returns the height of the image.
+   */
+  const std::uint32_t& height() const { return height_; }
+
+  /**
+   * @brief Returns the number of pixels between the starts of two rows,
+   * which is larger than the width when the rows are padded.
+   */
+  std::uint32_t stride() const { return stride_; }
+
+  /**
+   * @brief Returns the allocator which provides the pixel memory.
+   */
+  std::shared_ptr<PixelAllocator> allocator() const {
+    return image_ ? image_->allocator() : default_pixel_allocator();
+  }
+
+  /**
+   * @brief Returns a pointer to the first pixel of the image.
+   */
+  P* data() { return const_cast<P*>(std::as_const(*this).data()); }
+
+  /**
+   * @brief Returns a const pointer to the first pixel of the image.
+   */
+  const P* data() const {
+    return image_ ? static_cast<const P*>(image_->data()) : nullptr;
+  }
+
+  /**
+   * @brief Returns an image which refers to the same pixels as this one,
+   * without copying them, so that changes made through either image are seen
+   * by both. Only the pixels are shared, and the new image has no texture.
+   * The image may be resized independently, which gives it new pixels.
+   */
+  BasicImage share() {
+    BasicImage shared;
+    shared.height_ = height_;
+    shared.width_ = width_;
+    shared.stride_ = stride_;
+    shared.row_alignment_ = row_alignment_;
+    shared.image_ = image_;
+    return shared;
+  }
+
+  /**
+   * @brief Returns true if the pixels are shared with another image, made by
+   * share, or with an upload which is still in progress.
+   */
+  bool shared() const { return image_.use_count() > 1; }
+
+  /**
+   * @brief Returns a view of all pixels of the image.
+   */
+  view_type view() { return view_type(this->data(), height_, width_, stride_); }
+
+  /**
+   * @brief Returns a read-only view of all pixels of the image.
+   */
+  const_view_type view() const {
+    return const_view_type(this->data(), height_, width_, stride_);
+  }
+
+  /**
+   * @brief Returns a view of a rectangle of the image, without copying. An
+   * std::out_of_range exception is thrown if the rectangle does not fit
+   * inside of the image.
+   * @param y Row of the top left corner of the rectangle.
+   * @param x Column of the top left corner of the rectangle.
+   * @param height Height of the rectangle.
+   * @param width Width of the rectangle.
+   */
+  view_type view(std::uint32_t y, std::uint32_t x, std::uint32_t height,
+                 std::uint32_t width) {
+    return this->view().sub(y, x, height, width);
+  }
+
+  /**
+   * @brief Returns a read-only view of a rectangle of the image, without
+   * copying. An std::out_of_range exception is thrown if the rectangle does
+   * not fit inside of the image.
+   * @param y Row of the top left corner of the rectangle.
+   * @param x Column of the top left corner of the rectangle.
+   * @param height Height of the rectangle.
+   * @param width Width of the rectangle.
+   */
+  const_view_type view(std::uint32_t y, std::uint32_t x, std::uint32_t height,
+                       std::uint32_t width) const {
+    return this->view().sub(y, x, height, width);
+  }
+
+  /**
+   * @brief Allows an image to be passed wherever a read-only view is taken.
+   */
+  operator const_view_type() const { return this->view(); }
+
+  /**
+   * @breif Returns a modifiable reference to a pixel, given a linear index.
+   * The padding of rows is skipped, so the index is always h * width + w.
+   * @param i Linear index into pixel vector.
+   */
+  P& operator[](std::size_t i) {
+    if (stride_ == width_) return this->data()[i];
+    return (*this)(static_cast<std::uint32_t>(i / width_),
+                   static_cast<std::uint32_t>(i % width_));
+  }
+
+  /**
+   * @breif Returns a const reference to a pixel, given a linear index.
+   * The padding of rows is skipped, so the index is always h * width + w.
+   * @param i Linear index into pixel vector.
+   */
+  const P& operator[](std::size_t i) const {
+    if (stride_ == width_) return this->data()[i];
+    return (*this)(static_cast<std::uint32_t>(i / width_),
+                   static_cast<std::uint32_t>(i % width_));
+  }
+
+  /**
+   * @breif Returns the linear size of the pixel buffer (i.e. width * height).
+   */
+  std::uint32_t size() const { return width_ * height_; }
+
+  /**
+   * @breif Returns a modifiable reference to a pixel for a given row and
+   * column.
+   * @param h Index for the row of the pixel. Must be in the interval
+   * [0,height).
+   * @param w Index for the column of the pixel. Must be in the interval
+   * [0,width).
+   */
+  P& operator()(std::uint32_t h, std::uint32_t w) {
+    std::size_t i = w + (static_cast<std::size_t>(h) * stride_);
+    return this->data()[i];
+  }
+
+  /**
+   * @breif Returns a const reference to a pixel for a given row and column.
+   * @param h Index for the row of the pixel. Must be in the interval
+   * [0,height).
+   * @param w Index for the column of the pixel. Must be in the interval
+   * [0,width).
+   */
+  const P& operator()(std::uint32_t h, std::uint32_t w) const {
+    std::size_t i = w + (static_cast<std::size_t>(h) * stride_);
+    return this->data()[i];
+  }
+
+  /**
+   * @breif Returns a modifiable reference to a pixel for a given row and
+   * column. An std::out_of_range exception is thrown if the desired row or
+   * column are out of range.
+   * @param h Index for the row of the pixel. Must be in the interval
+   * [0,height).
+   * @param w Index for the column of the pixel. Must be in the interval
+   * [0,width).
+   */
+  P& at(std::uint32_t h, std::uint32_t w) {
+    if (h >= height_) {
+      throw std::out_of_range("ImApp::Image::at: h must be < height.");
+    } else if (w >= width_) {
+      throw std::out_of_range("ImApp::Image::at: w must be < width.");
+    }
+
+    return (*this)(h, w);
+  }
+
+  /**
+   * @breif Returns a const reference to a pixel for a given row and
+   * column. An std::out_of_range exception is thrown if the desired row or
+   * column are out of range.
+   * @param h Index for the row of the pixel. Must be in the interval
+   * [0,height).
+   * @param w Index for the column of the pixel. Must be in the interval
+   * [0,width).
+   */
+  const P& at(std::uint32_t h, std::uint32_t w) const {
+    if (h >= height_) {
+      throw std::out_of_range("ImApp::Image::at: h must be < height.");
+    } else if (w >= width_) {
+      throw std::out_of_range("ImApp::Image::at: w must be < width.");
+    }
+
+    return (*this)(h, w);
+  }
+
+  /**
+   * @breif Resizes the image. Every pixel keeps its row and column, and
+   * pixels outside of the new size are discarded. If an image is made larger,
+   * the new pixels will be white. The new pixels are stored with the same
+   * allocator and row alignment.
+   * @param height New image height.
+   * @param width New image width.
+   */
+  void resize(std::uint32_t height, std::uint32_t width) {
+    const std::uint32_t stride = padded_stride(width, row_alignment_);
+    if (stride != stride_ || height > height_) {
+      ImageOptions options;
+      options.row_alignment = row_alignment_;
+      options.allocator = this->allocator();
+      BasicImage resized(height, width, options);
+
+      const std::uint32_t rows = std::min(height, height_);
+      const std::uint32_t cols = std::min(width, width_);
+      copy_pixels<P>(std::as_const(*this).view(0, 0, rows, cols),
+                     resized.view(0, 0, rows, cols));
+      image_.swap(resized.image_);
+    } else if (width > width_) {
+      // The rows stay where they are, but the padding which becomes part of
+      // the image must be made white.
+      for (std::uint32_t h = 0; h < height; h++)
+        std::fill(&(*this)(h, width_), &(*this)(h, 0) + width, P());
+    }
+
+    height_ = height;
+    width_ = width;
+    stride_ = stride;
+  }
+
+  /**
+   * @brief Sends the image to the GPU, and populates the OpenGL texture id, if
+   * it is not yet populated. This method is also used to update the image on
+   * the GPU if it has been modified.
+   */
+  void send_to_gpu();
+
+  /**
+   * @brief Updates a rectangle of the texture on the GPU from the same
+   * rectangle of the image, without uploading the rest of the image. If the
+   * image is not yet on the GPU, or its size has changed, the whole image is
+   * uploaded instead. An std::out_of_range exception is thrown if the
+   * rectangle does not fit inside of the image.
+   * @param y Row of the top left corner of the rectangle.
+   * @param x Column of the top left corner of the rectangle.
+   * @param height Height of the rectangle.
+   * @param width Width of the rectangle.
+   */
+  void send_to_gpu(std::uint32_t y, std::uint32_t x, std::uint32_t height,
+                   std::uint32_t width);
+
+  /**
+   * @breif Removes the image from the GPU, and clears the OpenGL texture id.
+   * The texture is given back to the global TexturePool, so that it may be
+   * reused by another image of the same size. This method is automatically
+   * called on destruction.
+   */
+  void delete_from_gpu();
+
+  /**
+   * @breif Returns true if the image is on, and false otherwise. This does NOT
+   * mean that the version of the image on the GPU is up-to-date with the image
+   * stored in the object.
+   */
+  bool on_gpu() const { return static_cast<bool>(texture_); }
+
+  /**
+   * @breif Returns the optional texture ID for the image on the GPU, which is
+   * returned as an std::uint32_t. The ID changes when the texture is evicted
+   * by the ResidencyManager, so use texture_id to draw the image.
+   */
+  std::optional<std::uint32_t> ogl_texture_id() const {
+    if (texture_) return texture_.id();
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Returns the ID with which the image is drawn by ImGui, such as in
+   * ImGui::Image. If the image is not on the GPU, because it was never sent
+   * or because its texture was evicted by the ResidencyManager, it is sent
+   * to the GPU first.
+   */
+  ImTextureID texture_id() {
+    if (!texture_) this->send_to_gpu();
+    return reinterpret_cast<ImTextureID>(
+        static_cast<std::uintptr_t>(texture_.id()));
+  }
+
+  /**
+   * @brief Returns the texture of the image, which is empty if the image is
+   * not on the GPU.
+   */
+  const Texture& texture() const { return texture_; }
+
+  /**
+   * @brief Takes the texture away from the image, so that it can outlive the
+   * image, or be shared with Texture::share. The image is no longer on the
+   * GPU afterwards, and the texture is no longer tracked by the
+   * ResidencyManager.
+   */
+  Texture take_texture() {
+    if (texture_.tracked()) detail::untrack_texture(texture_);
+    return std::move(texture_);
+  }
+
+  /**
+   * @brief Gives the image a texture which holds its pixels, such as one made
+   * by a TextureUploader. The previous texture of the image is deleted, and
+   * the new one is tracked by the ResidencyManager.
+   * @param texture Texture for the image.
+   */
+  void set_texture(Texture texture);
+
+ private:
+  std::uint32_t height_, width_, stride_;
+  std::size_t row_alignment_;
+  std::shared_ptr<detail::PixelBuffer> image_;
+  Texture texture_;
+
+  BasicImage()
+      : height_(0),
+        width_(0),
+        stride_(0),
+        row_alignment_(0),
+        image_(),
+        texture_() {}
+
+  static std::shared_ptr<detail::PixelBuffer> copy_buffer(
+      const std::shared_ptr<detail::PixelBuffer>& buffer) {
+    if (!buffer) return nullptr;
+    return std::make_shared<detail::PixelBuffer>(*buffer);
+  }
+
+  // Returns the smallest stride, no smaller than the width, for which every
+  // row starts on a multiple of row_alignment bytes.
+  static std::uint32_t padded_stride(std::uint32_t width,
+                                     std::size_t row_alignment) {
+    if (row_alignment == 0) return width;
+    if ((row_alignment & (row_alignment - 1)) != 0 ||
+        row_alignment > pixel_alignment) {
+      throw std::invalid_argument(
+          "ImApp::Image: row_alignment must be a power of two, no larger than "
+          "pixel_alignment.");
+    }
+
+    const std::size_t unit = row_alignment / std::gcd(row_alignment, sizeof(P));
+    const std::size_t stride = (width + unit - 1) / unit * unit;
+    return static_cast<std::uint32_t>(stride);
+  }
+
+  static ImageOptions uninitialized(ImageOptions options) {
+    options.initialize = false;
+    return options;
+  }
+
+  template <typename Q>
+  friend class BasicImage;
+  template <typename Q>
+  friend detail::UploadSource detail::upload_source(const BasicImage<Q>& image);
+};
+
+using Image = BasicImage<Pixel>;
+using ImageR8 = BasicImage<PixelR8>;
+using ImageR16 = BasicImage<PixelR16>;
+using ImageR32F = BasicImage<PixelR32F>;
+using ImageRG8 = BasicImage<PixelRG8>;
+using ImageRGB8 = BasicImage<PixelRGB8>;
+using ImageRGBA16F = BasicImage<PixelRGBA16F>;
+
+extern template class BasicImage<PixelR8>;
+extern template class BasicImage<PixelR16>;
+extern template class BasicImage<PixelR32F>;
+extern template class BasicImage<PixelRG8>;
+extern template class BasicImage<PixelRGB8>;
+extern template class BasicImage<Pixel>;
+extern template class BasicImage<PixelRGBA16F>;
+
+namespace detail {
+template <typename P>
+Image colormap(BasicImageView<const P> src, float min, float max,
+               ImPlotColormap cmap);
+
+template <typename P>
+bool write_png(BasicImageView<const P> src, const std::filesystem::path& fname);
+
+template <typename P>
+bool write_jpg(BasicImageView<const P> src, const std::filesystem::path& fname);
+}  // namespace detail
+
+/**
+ * @brief Converts a view of an image to another pixel type. Normalized
+ * channels are rescaled, float channels are clamped to [0,1] when converted
+ * to normalized channels, and color is reduced to a single channel by its
+ * luma.
+ * @param src View of the pixels to be converted.
+ * @param options Options for the storage of the converted pixels. The
+ * initialize option is ignored, as every pixel is converted.
+ */
+template <typename To, typename From>
+BasicImage<To> convert(BasicImageView<From> src,
+                       ImageOptions options = ImageOptions()) {
+  using FromPixel = std::remove_const_t<From>;
+  options.initialize = false;
+  BasicImage<To> dst(src.height(), src.width(), options);
+
+  for (std::uint32_t h = 0; h < src.height(); h++) {
+    const FromPixel* in = src.row(h);
+    To* out = &dst(h, 0);
+    if constexpr (std::is_same_v<To, FromPixel>) {
+      std::copy(in, in + src.width(), out);
+    } else {
+      for (std::uint32_t w = 0; w < src.width(); w++) {
+        out[w] =
+            PixelTraits<To>::from_rgba(PixelTraits<FromPixel>::to_rgba(in[w]));
+      }
+    }
+  }
+
+  return dst;
+}
+
+/**
+ * @brief Converts an image to another pixel type.
+ * @param src Image to be converted.
+ * @param options Options for the storage of the converted pixels.
+ */
+template <typename To, typename From>
+BasicImage<To> convert(const BasicImage<From>& src,
+                       const ImageOptions& options = ImageOptions()) {
+  return convert<To>(src.view(), options);
+}
+
+/**
+ * @brief Maps the values of a view of an image to colors, which is how
+ * scalar data, such as float fields or 16-bit detector frames, are usually
+ * displayed. The value of a pixel is its first channel for images with one
+ * or two channels, and its luma otherwise, where normalized channels are in
+ * [0,1]. The colormap is sampled from ImPlot, so this must be called while an
+ * ImPlot context exists.
+ * @param src View of the pixels to be mapped.
+ * @param min Value mapped to the start of the colormap.
+ * @param max Value mapped to the end of the colormap.
+ * @param cmap ImPlot colormap which is used.
+ */
+template <typename P>
+Image colormap(BasicImageView<P> src, float min, float max,
+               ImPlotColormap cmap = ImPlotColormap_Viridis) {
+  using Pixel_t = std::remove_const_t<P>;
+  return detail::colormap<Pixel_t>(src, min, max, cmap);
+}
+
+/**
+ * @brief Maps the values of an image to colors. See the overload for views.
+ */
+template <typename P>
+Image colormap(const BasicImage<P>& src, float min, float max,
+               ImPlotColormap cmap = ImPlotColormap_Viridis) {
+  return detail::colormap<P>(src.view(), min, max, cmap);
+}
+
+/**
+ * @brief Saves a view of an image in a PNG file. 8-bit views are written
+ * directly from their rows, and other views are converted first.
+ * @param src View of the pixels to be written.
+ * @param fname Path to the file where the image will be written.
+ */
+template <typename P>
+bool save_png(BasicImageView<P> src, const std::filesystem::path& fname) {
+  return detail::write_png<std::remove_const_t<P>>(src, fname);
+}
+
+/**
+ * @brief Saves a view of an image in a JPG file. Views which are not 8-bit,
+ * or whose rows are not contiguous, are copied first.
+ * @param src View of the pixels to be written.
+ * @param fname Path to the file where the image will be written.
+ */
+template <typename P>
+bool save_jpg(BasicImageView<P> src, const std::filesystem::path& fname) {
+  return detail::write_jpg<std::remove_const_t<P>>(src, fname);
+}
+
+}  // namespace ImApp
+#endif
@@ -35,300 +35,243 @@
 
 #include <ImApp/IconsFontAwesome6.h>
 #include <ImApp/IconsFontAwesome6Brands.h>
+#include <ImApp/codec.hpp>
+#include <ImApp/image.hpp>
 #include <ImApp/imgui.h>
+#include <ImApp/job_system.hpp>
+#include <ImApp/mpsc_queue.hpp>
 #include <ImApp/implot.h>
-
+#include <ImApp/resample.hpp>
+#include <ImApp/residency.hpp>
+#include <ImApp/text_editor.hpp>
+#include <ImApp/texture_pool.hpp>
+#include <ImApp/texture_uploader.hpp>
+#include <ImApp/tree_view.hpp>
+
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 struct GLFWwindow;
 
 namespace ImApp {
 
+class DrawDataWriter;
+class InputRecorder;
+class InputPlayer;
+
+// Forward declare ImApp::App class to store pointer in Layer.
+class App;
+
 /**
- * @brief A class which represents a single pixel in an image. Each pixel has
- * four 8-bit channels: Red, Green, Blue, and Alpha.
+ * @brief Holds two copies of some state, so that one copy can be written by
+ * Layer::update, while the other is read by Layer::render. The copies should
+ * be exchanged in Layer::publish.
  */
-class Pixel {
+template <typename T>
+class DoubleBuffer {
  public:
-  Pixel() : r_(255), g_(255), b_(255), a_(255) {}
-
-  /**
-   * @breif Constructs a pixel with a specified color and opacity.
-   * @param R Value of the red channel in [0,255].
-   * @param G Value of the green channel in [0,255].
-   * @param B Value of the blue channel in [0,255].
-   * @param A Value of alpha (the opacity) in [0,255].
-   */
-  Pixel(std::uint8_t R, std::uint8_t G, std::uint8_t B, std::uint8_t A = 255)
-      : r_(R), g_(G), b_(B), a_(A) {}
-
-  /**
-   * @brief Returns a modifiable reference to the red channel.
-   */
-  std::uint8_t& r() { return r_; }
-
-  /**
-   * @brief Returns a const reference to the red channel.
-   */
-  const std::uint8_t& r() const { return r_; }
-
-  /**
-   * @brief Returns a modifiable reference to the green channel.
-   */
-  std::uint8_t& g() { return g_; }
+  DoubleBuffer() : buffers_{T(), T()}, front_(0) {}
 
   /**
-   * @brief Returns a const reference to the green channel.
+   * @brief Initializes both copies of the state.
+   * @param init Initial value of the state.
    */
-  const std::uint8_t& g() const { return g_; }
+  explicit DoubleBuffer(const T& init) : buffers_{init, init}, front_(0) {}
 
   /**
-   * @brief Returns a modifiable reference to the blue channel.
+   * @brief Returns a modifiable reference to the copy of the state which is
+   * being written by update.
    */
-  std::uint8_t& b() { return b_; }
+  T& back() { return buffers_[1 - front_]; }
 
   /**
-   * @brief Returns a const reference to the blue channel.
+   * @brief Returns a const reference to the copy of the state which is read by
+   * render.
    */
-  const std::uint8_t& b() const { return b_; }
+  const T& front() const { return buffers_[front_]; }
 
   /**
-   * @brief Returns a modifiable reference to the alpha channel.
+   * @brief Exchanges the two copies. The back copy then holds the state from
+   * before the last update, so this should be used when update rewrites the
+   * entire state.
    */
-  std::uint8_t& a() { return a_; }
+  void swap() { front_ = 1 - front_; }
 
   /**
-   * @brief Returns a const reference to the alpha channel.
+   * @brief Exchanges the two copies, and then copies the new front into the
+   * back, so that update continues from the latest state.
    */
-  const std::uint8_t& a() const { return a_; }
+  void publish() {
+    this->swap();
+    this->back() = this->front();
+  }
 
  private:
-  std::uint8_t r_, g_, b_, a_;
+  T buffers_[2];
+  int front_;
 };
 
 /**
- * @brief A class which respresents an image, containing an array of Pixel
- * objects. All of the Pixels are stored in row major order.
+ * @breif Abstract class for the interface of a rendering layer.
  */
-class Image {
+class Layer {
  public:
-  /**
-   * @breif Create an image of specified height and width.
-   * @param height Initial height of the image.
-   * @param width Initial width of the image.
-   */
-  Image(std::uint32_t height, std::uint32_t width)
-      : height_(height),
-        width_(width),
-        image_(height_ * width_, Pixel()),
-        ogl_texture_id_(std::nullopt) {}
-
-  ~Image() { this->delete_from_gpu(); }
-
-  /**
-   * @brief Loads an Image from a file. Can be almost any common image type.
-   * @brief fname Path to the file containing the image.
-   */
-  static Image from_file(const std::filesystem::path& fname);
-
-  /**
-   * @brief Saves the image in a PNG file.
-   * @param fname Path to the file where the image will be written.
-   */
-  bool save_png(const std::filesystem::path& fname);
-
-  /**
-   * @brief Saves the image in a JPG file.
-   * @param fname Path to the file where the image will be written.
-   */
-  bool save_jpg(const std::filesystem::path& fname);
-
-  /**
-   * @brief Returns the width of the image.
-   */
-  const std::uint32_t& width() const { return width_; }
+  Layer() : app_(nullptr), enabled_(true), ready_(false), init_() {}
+  virtual ~Layer() = default;
 
   /**
-   * @brief Returns the height of the image.
+   * @breif A virtual method which is called when a Layer is added to an App.
+   * This is always called on the main thread, and app() is already valid.
    */
-  const std::uint32_t& height() const { return height_; }
+  virtual void on_push(){};
 
   /**
-   * @breif Returns a modifiable reference to a Pixel, given a linear index.
-   * @param i Linear index into pixel vector.
+   * @brief A virtual method which is called on a JobSystem worker thread after
+   * on_push, to perform expensive initialization (e.g. loading files) without
+   * blocking the application. It is only called if has_async_init returns
+   * true. Until it has finished, the layer is not updated, and
+   * render_placeholder is called instead of render. An exception thrown here
+   * is rethrown from App::run.
    */
-  Pixel& operator[](std::size_t i) { return image_[i]; }
+  virtual void on_push_async(){};
 
   /**
-   * @breif Returns a const reference to a Pixel, given a linear index.
-   * @param i Linear index into pixel vector.
+   * @brief A virtual method which should return true for layers that override
+   * on_push_async. Other layers are ready as soon as on_push returns, and are
+   * rendered from their first frame.
    */
-  const Pixel& operator[](std::size_t i) const { return image_[i]; }
+  virtual bool has_async_init() const { return false; }
 
   /**
-   * @breif Returns the linear size of the pixel buffer (i.e. width * height).
+   * @brief A virtual method which is called instead of render for each frame,
+   * while on_push_async is still running.
    */
-  std::uint32_t size() const { return width_ * height_; }
+  virtual void render_placeholder(){};
 
   /**
-   * @breif Returns a modifiable reference to a Pixel for a given row and
-   * column.
-   * @param h Index for the row of the pixel. Must be in the interval
-   * [0,height).
-   * @param w Index for the column of the pixel. Must be in the interval
-   * [0,width).
+   * @brief A virtual method which is called to advance the state of the
+   * layer. If the App has an update rate, this is called at that fixed rate
+   * with a constant time step, independent of the frame rate. Otherwise, it is
+   * called once per frame with the frame time. Depending on the update mode
+   * of the App, this may be called from a worker thread, in parallel with
+   * other layers and with render, so it must not call ImGui functions. Work
+   * which needs the main thread may be handed to App::post_and_wait.
+   * @param dt Time step in seconds.
    */
-  Pixel& operator()(std::uint32_t h, std::uint32_t w) {
-    std::size_t i = w + (h * width_);
-    return image_[i];
-  }
+  virtual void update(double /*dt*/){};
 
   /**
-   * @breif Returns a const reference to a Pixel for a given row and column.
-   * @param h Index for the row of the pixel. Must be in the interval
-   * [0,height).
-   * @param w Index for the column of the pixel. Must be in the interval
-   * [0,width).
+   * @brief A virtual method which is called on the main thread once the
+   * updates for a frame have finished, and before the next render which
+   * should see them. This is where a DoubleBuffer should be swapped.
    */
-  const Pixel& operator()(std::uint32_t h, std::uint32_t w) const {
-    std::size_t i = w + (h * width_);
-    return image_[i];
-  }
+  virtual void publish(){};
 
   /**
-   * @breif Returns a modifiable reference to a Pixel for a given row and
-   * column. An std::out_of_range exception is thrown if the desired row or
-   * column are out of range.
-   * @param h Index for the row of the pixel. Must be in the interval
-   * [0,height).
-   * @param w Index for the column of the pixel. Must be in the interval
-   * [0,width).
+   * @breif A virtual method which is called for each frame in the rendering
+   * pipeline.
    */
-  Pixel& at(std::uint32_t h, std::uint32_t w) {
-    if (h >= height_) {
-      throw std::out_of_range("ImApp::Image::at: h must be < height.");
-    } else if (w >= width_) {
-      throw std::out_of_range("ImApp::Image::at: w must be < width.");
-    }
-
-    std::size_t i = w + (h * width_);
-    return image_[i];
-  }
+  virtual void render(){};
 
   /**
-   * @breif Returns a const reference to a Pixel for a given row and
-   * column. An std::out_of_range exception is thrown if the desired row or
-   * column are out of range.
-   * @param h Index for the row of the pixel. Must be in the interval
-   * [0,height).
-   * @param w Index for the column of the pixel. Must be in the interval
-   * [0,width).
+   * @breif A virtual method which is called on all Layer instances in an App,
+   * when the App is destroyed, or is closed. It is also called when the layer
+   * is removed with App::pop_layer.
    */
-  const Pixel& at(std::uint32_t h, std::uint32_t w) const {
-    if (h >= height_) {
-      throw std::out_of_range("ImApp::Image::at: h must be < height.");
-    } else if (w >= width_) {
-      throw std::out_of_range("ImApp::Image::at: w must be < width.");
-    }
-
-    std::size_t i = w + (h * width_);
-    return image_[i];
-  }
+  virtual void on_kill(){};
 
   /**
-   * @breif Resizes the image. None of the pixels are modified in the image upon
-   * resize. If an image is made larger, the new pixels will be white.
-   * @param height New image height.
-   * @param width New image width.
+   * @brief Returns a pointer to the associated ImApp::App instance. This
+   * pointer will only be set and valid if the layer has been pushed onto
+   * an ImApp::App instance.
    */
-  void resize(std::uint32_t height, std::uint32_t width) {
-    height_ = height;
-    width_ = width;
-    image_.resize(height_ * width_);
-  }
+  App* app() const { return app_; }
 
   /**
-   * @brief Sends the image to the GPU, and populates the OpenGL texture id, if
-   * it is not yet populated. This method is also used to update the image on
-   * the GPU if it has been modified.
+   * @brief Enables the layer if disabled. Layers are enabled by default.
    */
-  void send_to_gpu();
+  void enable() { enabled_ = true; }
 
   /**
-   * @breif Removes the image from the GPU, and clears the OpenGL texture id.
-   * This method is automatically called on destruction.
+   * @brief Disables the layer if enabled. A disabled layer is neither updated
+   * nor rendered, so it costs nothing per frame.
    */
-  void delete_from_gpu();
+  void disable() { enabled_ = false; }
 
   /**
-   * @breif Returns true if the image is on, and false otherwise. This does NOT
-   * mean that the version of the image on the GPU is up-to-date with the image
-   * stored in the object.
+   * @brief Returns true if the layer is enabled.
    */
-  bool on_gpu() const { return ogl_texture_id_.has_value(); }
+  bool enabled() const { return enabled_; }
 
   /**
-   * @breif Returns the optional texture ID for the image on the GPU, which is
-   * returned as an std::uint32_t.
+   * @brief Returns true once on_push_async has finished.
    */
-  const std::optional<std::uint32_t>& ogl_texture_id() const {
-    return ogl_texture_id_;
-  }
+  bool ready() const { return ready_; }
 
  private:
-  std::uint32_t height_, width_;
-  std::vector<Pixel> image_;
-  std::optional<std::uint32_t> ogl_texture_id_;
+  App* app_;
+  bool enabled_;
+  bool ready_;
+  JobHandle init_;
 
-  Image() : height_(0), width_(0), image_(), ogl_texture_id_(std::nullopt) {}
-};
+  void set_app_ptr(App* app_ptr) { app_ = app_ptr; }
 
-// Forward declare ImApp::App class to store pointer in Layer.
-class App;
+  friend ImApp::App;
+};
 
 /**
- * @breif Abstract class for the interface of a rendering layer.
+ * @brief Determines where Layer::update is executed.
  */
-class Layer {
- public:
-  Layer() : app_(nullptr) {}
-  virtual ~Layer() = default;
-
-  /**
-   * @breif A virtual method which is called when a Layer is added to an App.
-   */
-  virtual void on_push(){};
-
-  /**
-   * @breif A virtual method which is called for each frame in the rendering
-   * pipeline.
-   */
-  virtual void render(){};
-
-  /**
-   * @breif A virtual method which is called on all Layer instances in an App,
-   * when the App is destroyed, or is closed.
-   */
-  virtual void on_kill(){};
-
-  /**
-   * @brief Returns a pointer to the associated ImApp::App instance. This
-   * pointer will only be set and valid if the layer has been pushed onto
-   * an ImApp::App instance.
-   */
-  App* app() const { return app_; }
+enum class UpdateMode {
+  MainThread, /**< Layers are updated sequentially on the main thread. */
+  Parallel,   /**< Layers are updated in parallel on the JobSystem, and the
+                 frame waits for all updates before rendering. */
+  Background  /**< Layers are updated in parallel on the JobSystem while the
+                 frame is rendered. The results are published at the start of
+                 the next frame. */
+};
 
- private:
-  App* app_;
+/**
+ * @brief Determines how App::run paces the frames which it renders.
+ */
+enum class FramePacing {
+  VSync,      /**< Frames are synchronized to the display refresh. */
+  Uncapped,   /**< Frames are rendered as fast as possible. */
+  Capped,     /**< Frames are limited to a target frame rate, without vsync.
+                 With a low target, this is a low-power monitoring mode. */
+  LowLatency  /**< Frames are synchronized to the display refresh, but input
+                 sampling and rendering are delayed until just before the
+                 swap deadline, based on the measured render time. */
+};
 
-  void set_app_ptr(App* app_ptr) { app_ = app_ptr; }
+/**
+ * @brief Timing statistics for the frames rendered by App::run. All values
+ * are exponential moving averages.
+ */
+struct FrameStats {
+  double frame_time_ms = 0.;    /**< Time between consecutive frames. */
+  double fps = 0.;              /**< Achieved frame rate. */
+  double work_time_ms = 0.;     /**< Time from polling input until the swap
+                                   is requested. */
+  double input_latency_ms = 0.; /**< Estimated input-to-photon latency. */
+  std::uint64_t frames = 0;     /**< Number of frames rendered. */
+};
 
-  friend ImApp::App;
+/**
+ * @brief The time spent in one phase of the application startup.
+ */
+struct StartupPhase {
+  std::string name; /**< Name of the phase. */
+  double time_ms;   /**< Duration of the phase in milliseconds. */
 };
 
 /**
@@ -355,20 +298,28 @@ class App {
   void set_icon(const Image& image);
 
   /**
-   * @brief Starts the application loop. All layers must be added before calling
-   * this method.
+   * @brief Starts the application loop.
    */
   void run();
 
   /**
-   * @breif Adds a layer to the application rendering stack.
+   * @breif Adds a layer to the application rendering stack. If the
+   * application is running, the layer is added at the start of the next
+   * frame. This must be called from the main thread (use post from other
+   * threads).
    * @param layer Pointer to the new layer to be added to the rendering stack.
+   * @return Non-owning pointer to the layer, which may be used to pop it.
    */
-  void push_layer(std::unique_ptr<Layer> layer) {
-    layers_.push_back(std::move(layer));
-    layers_.back()->on_push();
-    layers_.back()->set_app_ptr(this);
-  }
+  Layer* push_layer(std::unique_ptr<Layer> layer);
+
+  /**
+   * @brief Removes a layer from the application rendering stack, calling its
+   * on_kill method before destroying it. If the application is running, the
+   * layer is removed at the start of the next frame. This must be called from
+   * the main thread (use post from other threads).
+   * @param layer Pointer to the layer to be removed.
+   */
+  void pop_layer(Layer* layer);
 
   /**
    * @brief Returns a reference to the current application sytle settings.
@@ -442,6 +393,198 @@ class App {
    */
   void set_default_style();
 
+  /**
+   * @brief Returns a reference to the application JobSystem. Layers should
+   * use this pool for background work, instead of creating their own threads.
+   */
+  JobSystem& jobs() { return *jobs_; }
+
+  /**
+   * @brief Returns a reference to the application TextureUploader, which
+   * uploads images to the GPU without blocking the render thread.
+   */
+  TextureUploader& uploader() { return *uploader_; }
+
+  /**
+   * @brief Queues a command to be executed on the main (render) thread. The
+   * commands are executed in order at the start of the next frame, right after
+   * the events have been polled, making this the place to modify UI state or
+   * upload textures from background threads. This method may be called from
+   * any thread, and never blocks.
+   * @param cmd Function to be executed on the main thread.
+   */
+  void post(std::function<void()> cmd);
+
+  /**
+   * @brief Queues a command to be executed on the main thread, and blocks until
+   * it has been executed. Any exception thrown by the command is rethrown to
+   * the caller. If called from the main thread, the command is executed
+   * immediately.
+   * @param cmd Function to be executed on the main thread.
+   */
+  void post_and_wait(std::function<void()> cmd);
+
+  /**
+   * @brief Returns true if the calling thread is the main thread of the
+   * application, on which the App was constructed.
+   */
+  bool on_main_thread() const {
+    return std::this_thread::get_id() == main_thread_;
+  }
+
+  /**
+   * @brief Sets the time budget for executing main-thread continuations from
+   * the JobSystem during each frame. The default budget is 2 ms.
+   * @param budget_ms Time budget in milliseconds.
+   */
+  void set_main_thread_budget(double budget_ms) {
+    main_thread_budget_ms_ = budget_ms;
+  }
+
+  /**
+   * @brief Returns the time spent in each phase of the startup, in the order
+   * in which the phases finished. The phases from the constructor are
+   * available right away, while "first_frame" is added once the first frame
+   * has been rendered. The "fonts (background)" entry is the time spent
+   * building the font atlas on a worker thread, while the window was created.
+   */
+  const std::vector<StartupPhase>& startup_phases() const {
+    return startup_phases_;
+  }
+
+  /**
+   * @brief Returns the time from the start of the constructor until the first
+   * frame was presented, in milliseconds, or zero if no frame has been
+   * presented yet.
+   */
+  double time_to_first_frame_ms() const;
+
+  /**
+   * @brief Sets how frames are paced. The default is FramePacing::VSync.
+   * @param mode New frame pacing mode.
+   * @param fps Target frame rate for FramePacing::Capped. For
+   * FramePacing::LowLatency, this overrides the refresh rate of the monitor
+   * if it is greater than zero. It is ignored in the other modes.
+   */
+  void set_frame_pacing(FramePacing mode, double fps = 0.);
+
+  /**
+   * @brief Returns the current frame pacing mode.
+   */
+  FramePacing frame_pacing() const { return pacing_; }
+
+  /**
+   * @brief Returns timing statistics for the most recent frames.
+   */
+  const FrameStats& frame_stats() const { return frame_stats_; }
+
+  /**
+   * @brief Sets the rate at which Layer::update is called. If the rate is
+   * zero (the default), update is called once per frame with the frame time.
+   * @param hz Number of updates per second.
+   */
+  void set_update_rate(double hz) {
+    update_rate_ = hz > 0. ? hz : 0.;
+    update_accumulator_ = 0.;
+  }
+
+  /**
+   * @brief Returns the rate at which Layer::update is called, or zero if it is
+   * called once per frame.
+   */
+  double update_rate() const { return update_rate_; }
+
+  /**
+   * @brief Sets where the layers are updated. The default is
+   * UpdateMode::MainThread.
+   * @param mode New update mode.
+   */
+  void set_update_mode(UpdateMode mode) { update_mode_ = mode; }
+
+  /**
+   * @brief Returns the current update mode.
+   */
+  UpdateMode update_mode() const { return update_mode_; }
+
+  /**
+   * @brief Sets the maximum number of fixed-rate updates which are executed
+   * for a single frame. If rendering falls further behind, the extra time is
+   * dropped instead of trying to catch up. The default is 8.
+   * @param n Maximum number of updates per frame.
+   */
+  void set_max_updates_per_frame(std::uint32_t n) {
+    max_updates_per_frame_ = n > 0 ? n : 1;
+  }
+
+  /**
+   * @brief Returns the fraction of an update step which has elapsed since the
+   * last fixed-rate update, in [0,1). This may be used in render to
+   * interpolate between states. It is always zero without an update rate.
+   */
+  double update_alpha() const {
+    return update_rate_ > 0. ? update_accumulator_ * update_rate_ : 0.;
+  }
+
+  /**
+   * @brief Writes the draw data of the next frames to a capture file, which
+   * may be replayed with the imapp_replay benchmark. Only the main viewport
+   * is captured. Starting a new capture ends any capture in progress. An
+   * std::runtime_error is thrown if the file can't be created.
+   * @param fname Path to the capture file.
+   * @param n_frames Number of frames to capture.
+   */
+  void capture_frames(const std::filesystem::path& fname,
+                      std::uint32_t n_frames);
+
+  /**
+   * @brief Returns true if frames are currently being captured.
+   */
+  bool capturing() const { return capture_ != nullptr; }
+
+  /**
+   * @brief Starts recording all input events which the window feeds to
+   * ImGui, along with the frame in which they arrived, until
+   * stop_recording_input is called or the App is destroyed. A recording made
+   * from the start of run can be replayed with play_input. An
+   * std::runtime_error is thrown if the file can't be created.
+   * @param fname Path to the recording file.
+   */
+  void record_input(const std::filesystem::path& fname);
+
+  /**
+   * @brief Stops the current input recording, if there is one.
+   */
+  void stop_recording_input();
+
+  /**
+   * @brief Returns true if input is currently being recorded.
+   */
+  bool recording_input() const { return input_recorder_ != nullptr; }
+
+  /**
+   * @brief Replays an input recording, starting with the next frame. Each
+   * frame receives exactly the events of the corresponding recorded frame,
+   * and real input is ignored until the playback has finished. ImGui and
+   * Layer::update advance by a fixed time step, so that a playback started
+   * before run drives the application identically every time. Combined with
+   * FramePacing::Uncapped, this turns a recorded session into a repeatable
+   * benchmark. An std::runtime_error is thrown if the file can't be read.
+   * @param fname Path to the recording file.
+   * @param timing_fname If not empty, the frame and work time of every
+   * played frame are written to this file as JSON, with summary statistics.
+   * @param delta_time Time step of every frame, in seconds.
+   * @param close_when_done If true, the window is closed once the playback
+   * has finished, ending App::run.
+   */
+  void play_input(const std::filesystem::path& fname,
+                  const std::filesystem::path& timing_fname = {},
+                  double delta_time = 1. / 60., bool close_when_done = true);
+
+  /**
+   * @brief Returns true if an input recording is currently being played.
+   */
+  bool playing_input() const { return input_player_ != nullptr; }
+
   /**
    * @brief Returns the current DPI scale for the application.
    */
@@ -457,7 +600,57 @@ class App {
   ImGuiIO* io_;
   ImGuiStyle* style_;
   std::vector<std::unique_ptr<Layer>> layers_;
+  // Layers added or removed while running, applied at the next frame.
+  std::vector<std::pair<std::unique_ptr<Layer>, Layer*>> layer_changes_;
+  // Layers which take part in the updates which are currently running.
+  std::vector<Layer*> updating_;
+  bool running_;
+  std::unique_ptr<JobSystem> jobs_;
+  std::unique_ptr<TextureUploader> uploader_;
+  MPSCQueue<std::function<void()>> commands_;
+  std::thread::id main_thread_;
+  double main_thread_budget_ms_;
+  UpdateMode update_mode_;
+  double update_rate_;
+  double update_accumulator_;
+  std::uint32_t max_updates_per_frame_;
+  std::optional<double> last_update_time_;
+  JobHandle background_update_;
+  bool background_pending_;
+  FramePacing pacing_;
+  double target_fps_;
+  std::chrono::steady_clock::time_point next_frame_;
+  std::chrono::steady_clock::time_point last_swap_;
+  FrameStats frame_stats_;
+  std::chrono::steady_clock::time_point startup_begin_;
+  std::vector<StartupPhase> startup_phases_;
+  std::chrono::steady_clock::time_point first_frame_time_;
+  std::unique_ptr<ImFontAtlas> fonts_;
+  bool first_frame_;
+  std::unique_ptr<DrawDataWriter> capture_;
+  std::uint32_t capture_frames_;
+  std::unique_ptr<InputRecorder> input_recorder_;
+  double input_record_begin_;
+  std::unique_ptr<InputPlayer> input_player_;
+  std::filesystem::path input_timing_fname_;
+  bool close_after_playback_;
   float dpi_scale_;
+
+  void process_commands();
+  void wait_for_job(const JobHandle& handle);
+  void attach_layer(std::unique_ptr<Layer> layer);
+  void detach_layer(Layer* layer);
+  void apply_layer_changes();
+  void finish_updates();
+  void update_layers();
+  double frame_period() const;
+  void pace_frame();
+  void record_frame(std::chrono::steady_clock::time_point input_time,
+                    std::chrono::steady_clock::time_point work_end);
+  void handle_input();
+  void finish_playback();
+  void end_startup_phase(const char* name,
+                         std::chrono::steady_clock::time_point& begin);
 };
 
 }  // namespace ImApp
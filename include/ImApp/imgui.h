@@ -780,6 +780,9 @@ namespace ImGui
     //    - If you are using tables as a sort of grid, where every column is holding the same type of contents,
     //      you may prefer using TableNextColumn() instead of TableNextRow() + TableSetColumnIndex().
     //      TableNextColumn() will automatically wrap-around into the next row if needed.
+    //    - For very wide tables (e.g. thousands of columns with ImGuiTableFlags_ScrollX), use TableNextRow() + a
+    //      'while (TableNextVisibleColumn())' loop: clipped and hidden columns are skipped without being visited,
+    //      so a row costs as much as its visible cells. Frozen columns are visited like other visible columns.
     //    - IMPORTANT: Comparatively to the old Columns() API, we need to call TableNextColumn() for the first column!
     //    - Summary of possible call flow:
     //        - TableNextRow() -> TableSetColumnIndex(0) -> Text("Hello 0") -> TableSetColumnIndex(1) -> Text("Hello 1")  // OK
@@ -792,6 +795,7 @@ namespace ImGui
     IMGUI_API void          TableNextRow(ImGuiTableRowFlags row_flags = 0, float min_row_height = 0.0f); // append into the first cell of a new row.
     IMGUI_API bool          TableNextColumn();                                  // append into the next column (or first column of next row if currently in last column). Return true when column is visible.
     IMGUI_API bool          TableSetColumnIndex(int column_n);                  // append into the specified column. Return true when column is visible.
+    IMGUI_API bool          TableNextVisibleColumn();                           // append into the next visible column of the current row, skipping clipped/hidden columns. Return false (without wrapping) after the last one. Use TableGetColumnIndex() to tell which column.
 
     // Tables: Headers & Columns declaration
     // - Use TableSetupColumn() to specify label, resizing policy, default width/weight, id, various other flags etc.
@@ -2587,6 +2591,8 @@ struct ImGuiTextBuffer
 // - You want to manipulate the open/close state of a particular sub-tree in your interface (tree node uses Int 0/1 to store their state).
 // - You want to store custom debug data easily without adding or editing structures in your code (probably not efficient, but convenient)
 // Types are NOT stored, so it is up to you to make sure your Key don't collide with different types.
+// With IMGUI_STORAGE_HASH_INDEX defined, Data is kept in insertion order instead of sorted, and large storages are indexed
+// by an open addressing hash table, so that insertion is O(1) instead of O(N). Data may still be iterated as before.
 struct ImGuiStorage
 {
     // [Internal]
@@ -2600,11 +2606,22 @@ struct ImGuiStorage
     };
 
     ImVector<ImGuiStoragePair>      Data;
+#ifdef IMGUI_STORAGE_HASH_INDEX
+    ImVector<ImU8>                  IndexCtrl;      // [Internal] Control byte of each slot of the index (empty, or 7 bits of the hash of its key), followed by a copy of the first 15
+    ImVector<int>                   IndexSlots;     // [Internal] Position in Data of the pair in each slot of the index
+    int                             IndexedCount;   // [Internal] Number of pairs in the index. The index is rebuilt when this doesn't match Data.Size
+
+    ImGuiStorage()                  { IndexedCount = 0; }
+#endif
 
     // - Get***() functions find pair, never add/allocate. Pairs are sorted so a query is O(log N)
     // - Set***() functions find pair, insertion on demand if missing.
     // - Sorted insertion is costly, paid once. A typical frame shouldn't need to insert any new pair.
+#ifdef IMGUI_STORAGE_HASH_INDEX
+    void                Clear() { Data.clear(); IndexCtrl.clear(); IndexSlots.clear(); IndexedCount = 0; }
+#else
     void                Clear() { Data.clear(); }
+#endif
     IMGUI_API int       GetInt(ImGuiID key, int default_val = 0) const;
     IMGUI_API void      SetInt(ImGuiID key, int val);
     IMGUI_API bool      GetBool(ImGuiID key, bool default_val = false) const;
@@ -0,0 +1,306 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_JOB_SYSTEM_H
+#define IMAPP_JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.hpp"
+
+namespace ImApp {
+
+class JobSystem;
+class TaskGraph;
+
+namespace detail {
+/**
+ * @brief Shared completion state for one or more jobs. The state is complete
+ * once the pending counter reaches zero.
+ */
+struct JobState {
+  explicit JobState(std::size_t n) : pending(n) {}
+
+  std::atomic<std::size_t> pending;
+  std::mutex mutex;
+  bool finished = false;
+  std::exception_ptr error = nullptr;
+  std::vector<std::function<void()>> continuations;
+};
+}  // namespace detail
+
+/**
+ * @brief A handle to work which has been submitted to a JobSystem. Handles
+ * are cheap to copy, and may be used to wait on the work, or to attach
+ * continuations to it. A default constructed handle is always done.
+ */
+class JobHandle {
+ public:
+  JobHandle() : state_(nullptr) {}
+
+  /**
+   * @brief Returns true if all of the work associated with the handle has
+   * finished executing.
+   */
+  bool done() const {
+    return !state_ || state_->pending.load(std::memory_order_acquire) == 0;
+  }
+
+ private:
+  std::shared_ptr<detail::JobState> state_;
+
+  explicit JobHandle(std::shared_ptr<detail::JobState> state)
+      : state_(std::move(state)) {}
+
+  friend JobSystem;
+  friend TaskGraph;
+};
+
+/**
+ * @brief A work-stealing pool of worker threads. By default, the pool is
+ * sized to the hardware concurrency minus one, so that a core remains
+ * reserved for the render thread. Each worker owns a queue of jobs, and idle
+ * workers steal jobs from the queues of busy workers. An ImApp::App owns a
+ * JobSystem, which Layers can access through app()->jobs(). The thread which
+ * constructs the pool is taken to be the main thread.
+ */
+class JobSystem {
+ public:
+  /**
+   * @brief Starts a pool with the specified number of worker threads.
+   * @param n_workers Number of worker threads. If zero, the value of
+   * JobSystem::default_worker_count() is used.
+   */
+  explicit JobSystem(std::size_t n_workers = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  /**
+   * @brief Returns the default number of workers, which is one less than the
+   * hardware concurrency, leaving one core for the render thread.
+   */
+  static std::size_t default_worker_count();
+
+  /**
+   * @brief Returns the number of worker threads in the pool.
+   */
+  std::size_t size() const { return workers_.size(); }
+
+  /**
+   * @brief Queues a job for execution on one of the worker threads.
+   * @param job Function to be executed.
+   */
+  JobHandle submit(std::function<void()> job);
+
+  /**
+   * @brief Blocks until the work associated with the handle has finished. A
+   * worker executes other queued jobs while waiting. Any other thread only
+   * helps with the jobs which belong to the handle, so that it is never held
+   * up by unrelated work, and the main thread also runs its queued
+   * continuations. If any of the jobs threw an exception, the first exception
+   * is rethrown here.
+   * @param handle Handle to the work which should be waited on.
+   */
+  void wait(const JobHandle& handle);
+
+  /**
+   * @brief Waits like JobSystem::wait, but gives up once the timeout has
+   * passed. If the work finished with an exception, the first exception is
+   * rethrown here.
+   * @param handle Handle to the work which should be waited on.
+   * @param timeout_ms Maximum time to wait in milliseconds.
+   * @return True if the work has finished, and false on a timeout.
+   */
+  bool wait_for(const JobHandle& handle, double timeout_ms);
+
+  /**
+   * @brief Blocks until all queued jobs have been executed.
+   */
+  void wait_idle();
+
+  /**
+   * @brief Returns true if there are no jobs queued or being executed.
+   */
+  bool idle() const { return in_flight_.load(std::memory_order_acquire) == 0; }
+
+  /**
+   * @brief Splits the range [begin,end) into chunks which are executed in
+   * parallel, and blocks until all chunks have been processed. The calling
+   * thread participates in the work.
+   * @param begin First index of the range.
+   * @param end One past the last index of the range.
+   * @param body Function called as body(chunk_begin, chunk_end) for each
+   * chunk of the range.
+   * @param grain Minimum number of indices in a chunk. If zero, a grain size
+   * is chosen based on the number of workers.
+   */
+  void parallel_for(std::size_t begin, std::size_t end,
+                    const std::function<void(std::size_t, std::size_t)>& body,
+                    std::size_t grain = 0);
+
+  /**
+   * @brief Queues a function to be executed on the main thread, the next time
+   * that the main-thread continuations are drained by ImApp::App::run.
+   * @param fn Function to be executed on the main thread.
+   */
+  void run_on_main(std::function<void()> fn);
+
+  /**
+   * @brief Queues a function to be executed on the main thread once the work
+   * associated with a handle has finished.
+   * @param handle Handle to the work which must finish first.
+   * @param fn Function to be executed on the main thread.
+   */
+  void continue_on_main(const JobHandle& handle, std::function<void()> fn);
+
+  /**
+   * @brief Executes queued main-thread continuations until either the queue
+   * is empty, or the time budget has been exceeded. At least one continuation
+   * is always executed if the queue is not empty. This should only be called
+   * from the main thread, and is called once per frame by ImApp::App::run.
+   * @param budget_ms Time budget in milliseconds.
+   * @return Number of continuations which were executed.
+   */
+  std::size_t drain_main(double budget_ms);
+
+  /**
+   * @brief Sets a function which is called whenever a main-thread
+   * continuation is queued, which may be used to wake up the main thread if
+   * it is waiting for events. The function may be called from any thread.
+   * This must be set before any continuations are queued.
+   * @param wakeup Function used to wake up the main thread.
+   */
+  void set_main_wakeup(std::function<void()> wakeup) {
+    main_wakeup_ = std::move(wakeup);
+  }
+
+ private:
+  struct Job {
+    std::function<void()> fn;
+    std::shared_ptr<detail::JobState> state;
+    // The state of the submission, parallel_for or graph run which the job
+    // belongs to. Threads outside of the pool only help with their own group.
+    const detail::JobState* group = nullptr;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  std::vector<std::thread> workers_;
+  // One queue per worker, plus a final queue for jobs which are submitted
+  // from threads which do not belong to the pool.
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::atomic<std::size_t> queued_;
+  std::atomic<std::size_t> in_flight_;
+  bool stop_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::mutex done_mutex_;
+  std::condition_variable done_cv_;
+  MPSCQueue<std::function<void()>> main_queue_;
+  std::function<void()> main_wakeup_;
+  std::thread::id main_thread_;
+
+  void worker_loop(std::size_t index);
+  void push(Job job);
+  bool try_pop(Job& job);
+  bool try_pop_group(const detail::JobState* group, Job& job);
+  bool run_one();
+  bool run_one_of(const detail::JobState* group);
+  void execute(Job& job);
+  void finish(detail::JobState& state);
+
+  friend TaskGraph;
+};
+
+/**
+ * @brief A set of tasks with dependencies between them. When the graph is
+ * run, every task is executed on the JobSystem once all of the tasks which
+ * precede it have finished. A graph may be run any number of times.
+ */
+class TaskGraph {
+ public:
+  using Node = std::size_t;
+
+  /**
+   * @brief Adds a task to the graph, returning its node index.
+   * @param fn Function to be executed for the task.
+   */
+  Node add(std::function<void()> fn);
+
+  /**
+   * @brief Adds a dependency to the graph, so that the task after will only
+   * be executed once the task before has finished.
+   * @param before Node which must finish first.
+   * @param after Node which depends on before.
+   */
+  void precede(Node before, Node after);
+
+  /**
+   * @brief Returns the number of tasks in the graph.
+   */
+  std::size_t size() const { return tasks_.size(); }
+
+  /**
+   * @brief Schedules all tasks of the graph on a JobSystem. The tasks are
+   * copied, so the graph may be modified or destroyed while it is running. An
+   * std::runtime_error is thrown if the graph contains a cycle.
+   * @param jobs JobSystem on which the tasks are executed.
+   * @return Handle which is done once all tasks have finished.
+   */
+  JobHandle run(JobSystem& jobs) const;
+
+ private:
+  struct Run;
+
+  std::vector<std::function<void()>> tasks_;
+  std::vector<std::vector<Node>> successors_;
+
+  static void schedule(JobSystem& jobs, const std::shared_ptr<Run>& run,
+                       Node node);
+};
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,115 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_MPSC_QUEUE_H
+#define IMAPP_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace ImApp {
+
+/**
+ * @brief A lock-free, unbounded, multi-producer single-consumer queue. Any
+ * thread may push values, but only a single thread may pop them at a time.
+ * Pushing never blocks, and only requires a single atomic exchange. The value
+ * type must be default constructible and move assignable.
+ */
+template <typename T>
+class MPSCQueue {
+ public:
+  MPSCQueue() : head_(new Node()), tail_(head_.load()) {}
+
+  ~MPSCQueue() {
+    T value;
+    while (this->pop(value)) {
+    }
+    delete tail_;
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  /**
+   * @brief Adds a value to the back of the queue. This method may be called
+   * from any thread.
+   * @param value Value to be added.
+   */
+  void push(T value) {
+    Node* node = new Node();
+    node->value = std::move(value);
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /**
+   * @brief Removes the value at the front of the queue. This method may only
+   * be called by the consumer thread. A push which is still in progress on
+   * another thread may not be visible yet, in which case the queue briefly
+   * appears empty.
+   * @param value Reference where the value will be moved if one is available.
+   * @return True if a value was popped, and false if the queue was empty.
+   */
+  bool pop(T& value) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) return false;
+
+    value = std::move(next->value);
+    next->value = T();
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+  /**
+   * @brief Returns true if there are no values visible to the consumer. This
+   * method may only be called by the consumer thread.
+   */
+  bool empty() const {
+    return tail_->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    T value{};
+  };
+
+  // Producers and the consumer work on opposite ends of the list, so we keep
+  // the two pointers on separate cache lines.
+  alignas(64) std::atomic<Node*> head_;
+  alignas(64) Node* tail_;
+};
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,218 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_PIXEL_ALLOCATOR_H
+#define IMAPP_PIXEL_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace ImApp {
+
+/**
+ * @brief Alignment in bytes of every pixel buffer, which is the size of a
+ * cache line, and is enough for any SIMD load.
+ */
+inline constexpr std::size_t pixel_alignment = 64;
+
+/**
+ * @brief Interface for the memory which stores the pixels of an image.
+ * Allocators must be thread safe, as images are often created and destroyed
+ * on JobSystem workers. Every allocation must be aligned to pixel_alignment.
+ */
+class PixelAllocator {
+ public:
+  virtual ~PixelAllocator() = default;
+
+  /**
+   * @brief Allocates a buffer of at least the given size. An std::bad_alloc
+   * exception is thrown if the memory can't be allocated.
+   * @param bytes Size of the buffer in bytes, which is never zero.
+   */
+  virtual void* allocate(std::size_t bytes) = 0;
+
+  /**
+   * @brief Returns a buffer to the allocator.
+   * @param ptr Pointer returned by allocate.
+   * @param bytes Size which was passed to allocate.
+   */
+  virtual void deallocate(void* ptr, std::size_t bytes) noexcept = 0;
+};
+
+/**
+ * @brief Returns the allocator used by images which are not given one. It
+ * allocates from the heap with the alignment of pixel_alignment.
+ */
+std::shared_ptr<PixelAllocator> default_pixel_allocator();
+
+/**
+ * @brief An allocator which keeps freed buffers, and hands them out again
+ * when a buffer of the same size is requested. Streaming many frames of the
+ * same size, such as from a camera or a video, then only allocates for the
+ * first few frames.
+ */
+class PoolAllocator : public PixelAllocator {
+ public:
+  /**
+   * @brief Creates a pool.
+   * @param max_cached_bytes Maximum total size of the buffers kept for
+   * reuse. Buffers which would exceed it are released to the upstream
+   * allocator.
+   * @param upstream Allocator which provides the buffers. If null, the
+   * default allocator is used.
+   */
+  explicit PoolAllocator(std::size_t max_cached_bytes = 256 << 20,
+                         std::shared_ptr<PixelAllocator> upstream = nullptr);
+  ~PoolAllocator() override;
+
+  PoolAllocator(const PoolAllocator&) = delete;
+  PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+  void* allocate(std::size_t bytes) override;
+  void deallocate(void* ptr, std::size_t bytes) noexcept override;
+
+  /**
+   * @brief Releases all cached buffers to the upstream allocator.
+   */
+  void release();
+
+  /**
+   * @brief Returns the total size of the buffers waiting to be reused.
+   */
+  std::size_t cached_bytes() const;
+
+  /**
+   * @brief Returns the number of allocations served from the cache.
+   */
+  std::size_t hits() const;
+
+  /**
+   * @brief Returns the number of allocations which went to the upstream
+   * allocator.
+   */
+  std::size_t misses() const;
+
+ private:
+  std::shared_ptr<PixelAllocator> upstream_;
+  std::size_t max_cached_bytes_;
+  std::size_t cached_bytes_;
+  std::size_t hits_, misses_;
+  std::multimap<std::size_t, void*> cache_;
+  mutable std::mutex mutex_;
+};
+
+/**
+ * @brief An allocator which maps every buffer directly from the operating
+ * system. Large images then don't fragment the heap, and their memory is
+ * returned to the system as soon as they are destroyed. On Linux, the
+ * buffers can be backed by transparent huge pages, which reduces TLB misses
+ * when large images are traversed. Where mapping is not available, the
+ * default allocator is used instead.
+ */
+class MappedAllocator : public PixelAllocator {
+ public:
+  /**
+   * @brief Creates a mapped allocator.
+   * @param huge_pages If true, the kernel is advised to back the buffers
+   * with huge pages. This is only a hint, which may be ignored.
+   */
+  explicit MappedAllocator(bool huge_pages = false)
+      : huge_pages_(huge_pages) {}
+
+  void* allocate(std::size_t bytes) override;
+  void deallocate(void* ptr, std::size_t bytes) noexcept override;
+
+ private:
+  bool huge_pages_;
+};
+
+namespace detail {
+/**
+ * @brief An owning, untyped buffer of pixel memory, which remembers the
+ * allocator it came from. Copies allocate from the same allocator.
+ */
+class PixelBuffer {
+ public:
+  PixelBuffer() : allocator_(nullptr), data_(nullptr), bytes_(0) {}
+
+  PixelBuffer(std::size_t bytes, std::shared_ptr<PixelAllocator> allocator)
+      : allocator_(allocator ? std::move(allocator)
+                             : default_pixel_allocator()),
+        data_(nullptr),
+        bytes_(bytes) {
+    if (bytes_) data_ = allocator_->allocate(bytes_);
+  }
+
+  PixelBuffer(const PixelBuffer& other)
+      : PixelBuffer(other.bytes_, other.allocator_) {
+    if (bytes_) std::memcpy(data_, other.data_, bytes_);
+  }
+
+  PixelBuffer(PixelBuffer&& other) noexcept
+      : allocator_(std::move(other.allocator_)),
+        data_(std::exchange(other.data_, nullptr)),
+        bytes_(std::exchange(other.bytes_, 0)) {}
+
+  PixelBuffer& operator=(PixelBuffer other) noexcept {
+    this->swap(other);
+    return *this;
+  }
+
+  ~PixelBuffer() {
+    if (data_) allocator_->deallocate(data_, bytes_);
+  }
+
+  void swap(PixelBuffer& other) noexcept {
+    std::swap(allocator_, other.allocator_);
+    std::swap(data_, other.data_);
+    std::swap(bytes_, other.bytes_);
+  }
+
+  void* data() const { return data_; }
+  std::size_t bytes() const { return bytes_; }
+  const std::shared_ptr<PixelAllocator>& allocator() const {
+    return allocator_;
+  }
+
+ private:
+  std::shared_ptr<PixelAllocator> allocator_;
+  void* data_;
+  std::size_t bytes_;
+};
+}  // namespace detail
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,138 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_RESAMPLE_H
+#define IMAPP_RESAMPLE_H
+
+#include <ImApp/image.hpp>
+#include <ImApp/job_system.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ImApp {
+
+/**
+ * @brief The filter used to compute the value of a resampled pixel.
+ */
+enum class ResampleFilter {
+  Box,      /**< Averages the pixels within half a pixel. Nearest neighbor
+               when enlarging. */
+  Bilinear, /**< Linear interpolation, widened when shrinking. */
+  Lanczos,  /**< Three lobed Lanczos window, which is the sharpest. */
+  Area      /**< Weights every pixel by the area it covers. Best suited to
+               shrinking, where it avoids moire patterns. */
+};
+
+/**
+ * @brief Resamples a view of an image to a new size. The filter is applied
+ * separably, first along the rows and then along the columns, with the
+ * channels of a pixel processed together in SIMD registers. Colors are
+ * weighted by their alpha, so transparent pixels do not bleed into their
+ * neighbors. An std::invalid_argument exception is thrown if the view is
+ * empty while the new size is not.
+ * @param src View of the pixels to be resampled.
+ * @param height Height of the new image.
+ * @param width Width of the new image.
+ * @param filter Filter which is used.
+ * @param jobs If not null, the rows are divided among the workers of this
+ * JobSystem.
+ */
+template <typename P>
+BasicImage<P> resample(BasicImageView<const P> src, std::uint32_t height,
+                       std::uint32_t width,
+                       ResampleFilter filter = ResampleFilter::Lanczos,
+                       JobSystem* jobs = nullptr);
+
+/**
+ * @brief Resamples an image to a new size. See the overload for views.
+ */
+template <typename P>
+BasicImage<P> resample(const BasicImage<P>& src, std::uint32_t height,
+                       std::uint32_t width,
+                       ResampleFilter filter = ResampleFilter::Lanczos,
+                       JobSystem* jobs = nullptr) {
+  return resample<P>(src.view(), height, width, filter, jobs);
+}
+
+/**
+ * @brief Shrinks a view of an image by an integer factor, where each new
+ * pixel is the average of a block of factor x factor pixels. This is much
+ * faster than resample, and is what mipmaps and thumbnails are built from.
+ * The new size is the old size divided by the factor, but at least one
+ * pixel. Pixels left over at the right and bottom edges are averaged into
+ * the last column and row. An std::invalid_argument exception is thrown if
+ * the factor is zero.
+ * @param src View of the pixels to be shrunk.
+ * @param factor Number of pixels along each side of a block.
+ * @param jobs If not null, the rows are divided among the workers of this
+ * JobSystem.
+ */
+template <typename P>
+BasicImage<P> downscale(BasicImageView<const P> src, std::uint32_t factor,
+                        JobSystem* jobs = nullptr);
+
+/**
+ * @brief Shrinks an image by an integer factor. See the overload for views.
+ */
+template <typename P>
+BasicImage<P> downscale(const BasicImage<P>& src, std::uint32_t factor,
+                        JobSystem* jobs = nullptr) {
+  return downscale<P>(src.view(), factor, jobs);
+}
+
+/**
+ * @brief Builds a pyramid of images, where each level is half the size of
+ * the previous one, as is done for mipmaps and zoomable thumbnails.
+ * @param src Image at the base of the pyramid. Its pixels are shared by the
+ * first level through BasicImage::share, and not copied.
+ * @param levels Maximum number of levels, including the base. If zero, levels
+ * are added until the image is a single pixel.
+ * @param jobs If not null, the rows of every level are divided among the
+ * workers of this JobSystem.
+ */
+template <typename P>
+std::vector<BasicImage<P>> build_pyramid(BasicImage<P>& src,
+                                         std::uint32_t levels = 0,
+                                         JobSystem* jobs = nullptr) {
+  std::vector<BasicImage<P>> pyramid;
+  pyramid.push_back(src.share());
+  while ((levels == 0 || pyramid.size() < levels) &&
+         (pyramid.back().height() > 1 || pyramid.back().width() > 1)) {
+    const BasicImage<P>& top = pyramid.back();
+    pyramid.push_back(downscale<P>(top.view(), 2, jobs));
+  }
+  return pyramid;
+}
+
+}  // namespace ImApp
+#endif
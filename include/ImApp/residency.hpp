@@ -0,0 +1,185 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_RESIDENCY_H
+#define IMAPP_RESIDENCY_H
+
+#include <ImApp/imgui.h>
+#include <ImApp/texture.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace ImApp {
+
+/**
+ * @brief Keeps track of how much GPU memory is used by the textures of
+ * images, and keeps it within a budget. Every frame, the App reports which
+ * textures were drawn, by looking at the texture IDs in the draw data of all
+ * viewports. Once the textures use more than the budget, the unused textures
+ * of the TexturePool are deleted first, and then the ones which were drawn
+ * least recently, down to the budget. Textures which were
+ * drawn in the current frame are never evicted, so the budget may be
+ * exceeded when more textures are on screen than fit in it.
+ *
+ * An image whose texture was evicted keeps its pixels, and is sent to the
+ * GPU again by BasicImage::texture_id. Images which may be evicted should
+ * therefore be drawn with the ID returned by texture_id in every frame, and
+ * not with one which was stored earlier. All methods must be called on the
+ * thread which owns the OpenGL context.
+ */
+class ResidencyManager {
+ public:
+  ResidencyManager();
+  ~ResidencyManager();
+
+  ResidencyManager(const ResidencyManager&) = delete;
+  ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+  /**
+   * @brief Returns the manager which tracks the textures of all images.
+   */
+  static ResidencyManager& global();
+
+  /**
+   * @brief Sets the number of bytes which the tracked textures may use. The
+   * budget is enforced at the end of every frame. A budget of zero, which is
+   * the default, means that textures are never evicted.
+   * @param bytes New budget in bytes.
+   */
+  void set_budget(std::size_t bytes);
+
+  /**
+   * @brief Returns the budget in bytes, or zero if there is no budget.
+   */
+  std::size_t budget() const;
+
+  /**
+   * @brief Returns the number of bytes used by all tracked textures.
+   */
+  std::size_t resident_bytes() const;
+
+  /**
+   * @brief Returns the number of tracked textures.
+   */
+  std::size_t texture_count() const;
+
+  /**
+   * @brief Returns the number of textures which have been evicted so far.
+   */
+  std::uint64_t evictions() const;
+
+  /**
+   * @brief Starts tracking a texture, which may then be evicted. If the
+   * texture is already tracked, its size is updated. The texture counts as
+   * drawn in the current frame.
+   * @param texture Texture to be tracked, which must not be empty. The
+   * texture may be moved, but only its owner can upload it again, so only
+   * textures which belong to an image should be tracked.
+   * @param bytes Number of bytes of GPU memory used by the texture.
+   */
+  void track(Texture& texture, std::size_t bytes);
+
+  /**
+   * @brief Stops tracking a texture, without deleting it.
+   * @param texture Texture which is no longer tracked.
+   */
+  void untrack(Texture& texture);
+
+  /**
+   * @brief Marks a texture as drawn in the current frame. Textures which are
+   * not tracked are ignored.
+   * @param id Texture ID of the texture.
+   */
+  void touch(ImTextureID id);
+
+  /**
+   * @brief Marks every texture which is used by the draw data as drawn in
+   * the current frame.
+   * @param draw_data Draw data of a viewport, after ImGui::Render.
+   */
+  void mark_used(const ImDrawData& draw_data);
+
+  /**
+   * @brief Enforces the budget, and starts a new frame. This is called by
+   * the App once all viewports have been rendered.
+   * @return Number of bytes which were evicted.
+   */
+  std::size_t end_frame();
+
+  /**
+   * @brief Evicts the least recently drawn textures until no more than a
+   * number of bytes are used. Textures which were drawn in the current frame
+   * are kept.
+   * @param target Number of bytes which may remain in use.
+   * @return Number of bytes which were evicted.
+   */
+  std::size_t trim(std::size_t target);
+
+  /**
+   * @brief Asks the driver how much video memory is currently available,
+   * using the GL_NVX_gpu_memory_info or GL_ATI_meminfo extensions. This can
+   * be used to pick a budget on machines which are shared with other
+   * applications.
+   * @return Available memory in bytes, or nothing if the driver can't tell.
+   */
+  static std::optional<std::size_t> available_vram();
+
+ private:
+  struct Entry {
+    std::uint32_t id;
+    std::size_t bytes;
+    std::uint64_t last_used;
+    Texture* owner;
+  };
+
+  mutable std::mutex mutex_;
+  // Ordered from the most to the least recently drawn texture.
+  std::list<Entry> lru_;
+  std::unordered_map<std::uint32_t, std::list<Entry>::iterator> entries_;
+  std::size_t budget_;
+  std::size_t resident_;
+  std::uint64_t evictions_;
+  std::uint64_t frame_;
+
+  void touch_locked(std::uint32_t id);
+  std::size_t trim_locked(std::size_t target);
+
+  friend void detail::move_tracked_texture(Texture& texture) noexcept;
+};
+
+}  // namespace ImApp
+#endif
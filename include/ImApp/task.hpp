@@ -0,0 +1,371 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_TASK_H
+#define IMAPP_TASK_H
+
+#include <ImApp/imapp.hpp>
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "ImApp/task.hpp requires C++20 coroutines (see IMAPP_ENABLE_COROUTINES)."
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ImApp {
+
+template <typename T = void>
+class Task;
+
+inline void spawn(App& app, Task<void> task);
+
+namespace detail {
+class TaskPromiseBase {
+ public:
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename P>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<P> handle) noexcept {
+      TaskPromiseBase& promise = handle.promise();
+      if (promise.continuation_) return promise.continuation_;
+
+      if (promise.detached_) {
+        // Nobody will ever observe the result of a detached task, so we hand
+        // any error to the App, where it is rethrown from App::run.
+        std::exception_ptr error = promise.error_;
+        App* app = promise.app_;
+        handle.destroy();
+        if (error && app) app->post([error] { std::rethrow_exception(error); });
+      }
+
+      return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  FinalAwaiter final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() { error_ = std::current_exception(); }
+
+ protected:
+  std::coroutine_handle<> continuation_ = nullptr;
+  std::exception_ptr error_ = nullptr;
+  App* app_ = nullptr;
+  bool detached_ = false;
+
+  void rethrow_if_error() const {
+    if (error_) std::rethrow_exception(error_);
+  }
+
+  template <typename U>
+  friend class ImApp::Task;
+  friend void ImApp::spawn(App& app, Task<void> task);
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+ public:
+  Task<T> get_return_object() noexcept;
+
+  template <typename U>
+  void return_value(U&& value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T result() {
+    this->rethrow_if_error();
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+
+  void return_void() noexcept {}
+
+  void result() { this->rethrow_if_error(); }
+};
+}  // namespace detail
+
+/**
+ * @brief A lazily started coroutine which produces a value of type T. The
+ * coroutine does not start executing until it is awaited with co_await, or is
+ * handed to ImApp::spawn. Inside the coroutine, the awaiters resume_on_pool,
+ * next_frame, upload_to_gpu, and read_file move the work between the
+ * JobSystem and the main thread, without ever blocking the render loop.
+ */
+template <typename T>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) handle_.destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  /**
+   * @brief Returns true if the coroutine has run to completion.
+   */
+  bool done() const { return !handle_ || handle_.done(); }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      bool await_ready() noexcept { return !handle || handle.done(); }
+
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation_ = awaiting;
+        return handle;
+      }
+
+      decltype(auto) await_resume() { return handle.promise().result(); }
+    };
+
+    return Awaiter{handle_};
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  friend promise_type;
+  friend void spawn(App& app, Task<void> task);
+};
+
+namespace detail {
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+}  // namespace detail
+
+/**
+ * @brief Starts a task on the main thread at the start of the next frame.
+ * The task owns itself, and is destroyed once it finishes. If the task ends
+ * with an exception, the exception is rethrown from App::run.
+ * @param app App which schedules the task.
+ * @param task Task to be started.
+ */
+inline void spawn(App& app, Task<void> task) {
+  auto handle = std::exchange(task.handle_, {});
+  if (!handle) return;
+
+  handle.promise().app_ = &app;
+  handle.promise().detached_ = true;
+  app.post([handle] { handle.resume(); });
+}
+
+/**
+ * @brief Awaiter which resumes the coroutine on a JobSystem worker thread.
+ */
+class ResumeOnPool {
+ public:
+  explicit ResumeOnPool(App& app) : app_(app) {}
+
+  bool await_ready() noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    app_.jobs().submit([handle] { handle.resume(); });
+  }
+  void await_resume() noexcept {}
+
+ private:
+  App& app_;
+};
+
+/**
+ * @brief Returns an awaiter which resumes the coroutine on one of the
+ * workers of the App JobSystem.
+ * @param app App which owns the JobSystem.
+ */
+inline ResumeOnPool resume_on_pool(App& app) { return ResumeOnPool(app); }
+
+/**
+ * @brief Awaiter which resumes the coroutine on the main thread, at the start
+ * of the next frame.
+ */
+class NextFrame {
+ public:
+  explicit NextFrame(App& app) : app_(app) {}
+
+  bool await_ready() noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    app_.post([handle] { handle.resume(); });
+  }
+  void await_resume() noexcept {}
+
+ private:
+  App& app_;
+};
+
+/**
+ * @brief Returns an awaiter which resumes the coroutine on the main thread at
+ * the start of the next frame. This may be awaited from any thread, and is
+ * how a coroutine gets back to the main thread after working on the pool.
+ * @param app App whose main thread resumes the coroutine.
+ */
+inline NextFrame next_frame(App& app) { return NextFrame(app); }
+
+/**
+ * @brief Awaiter which sends an image to the GPU through the App
+ * TextureUploader, and resumes the coroutine on the main thread once the
+ * texture is ready to be drawn.
+ */
+template <typename P>
+class GpuUpload {
+ public:
+  GpuUpload(App& app, BasicImage<P>& image) : app_(app), image_(image) {}
+
+  bool await_ready() noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    app_.uploader().upload(image_, [this, handle](Texture texture) {
+      image_.set_texture(std::move(texture));
+      handle.resume();
+    });
+  }
+  void await_resume() noexcept {}
+
+ private:
+  App& app_;
+  BasicImage<P>& image_;
+};
+
+/**
+ * @brief Returns an awaiter which uploads an image to the GPU without
+ * blocking the render thread, resuming the coroutine on the main thread once
+ * the texture has been given to the image. The pixels are shared with the
+ * upload, so they must not be modified by other code until the coroutine
+ * resumes, and the image itself must outlive the awaiter.
+ * @param app App whose TextureUploader performs the upload.
+ * @param image Image to be uploaded.
+ */
+template <typename P>
+GpuUpload<P> upload_to_gpu(App& app, BasicImage<P>& image) {
+  return GpuUpload<P>(app, image);
+}
+
+/**
+ * @brief Awaiter which reads the contents of a file on a JobSystem worker, and
+ * resumes the coroutine on that worker.
+ */
+class FileRead {
+ public:
+  FileRead(App& app, std::filesystem::path fname)
+      : app_(app), fname_(std::move(fname)), data_(), error_() {}
+
+  bool await_ready() noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    app_.jobs().submit([this, handle] {
+      try {
+        this->read();
+      } catch (...) {
+        error_ = std::current_exception();
+      }
+      handle.resume();
+    });
+  }
+  std::vector<char> await_resume() {
+    if (error_) std::rethrow_exception(error_);
+    return std::move(data_);
+  }
+
+ private:
+  App& app_;
+  std::filesystem::path fname_;
+  std::vector<char> data_;
+  std::exception_ptr error_;
+
+  void read() {
+    std::ifstream file(fname_, std::ios::binary);
+    if (!file) {
+      std::string mssg = "ImApp::read_file: Could not open file \"";
+      mssg += fname_.string() + "\".";
+      throw std::runtime_error(mssg);
+    }
+
+    data_.resize(static_cast<std::size_t>(std::filesystem::file_size(fname_)));
+    file.read(data_.data(), static_cast<std::streamsize>(data_.size()));
+    data_.resize(static_cast<std::size_t>(file.gcount()));
+  }
+};
+
+/**
+ * @brief Returns an awaiter which reads the entire contents of a file on a
+ * worker thread. The coroutine is resumed on that worker, and may await
+ * next_frame to return to the main thread.
+ * @param app App which owns the JobSystem.
+ * @param fname Path to the file to be read.
+ */
+inline FileRead read_file(App& app, std::filesystem::path fname) {
+  return FileRead(app, std::move(fname));
+}
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,350 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_TEXT_EDITOR_H
+#define IMAPP_TEXT_EDITOR_H
+
+#include <ImApp/imgui.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ImApp {
+
+/**
+ * @brief A piece table for editing large documents. The text is never
+ * copied as a whole. It is described by a sequence of pieces, each of which
+ * refers to a range of either the original text or of an append only buffer
+ * holding all inserted text. The pieces are kept in a balanced tree (a
+ * treap), where each node also stores the length and the number of newlines
+ * of its subtree, and both buffers have an index of their newlines. Edits,
+ * and conversions between offsets and lines, are therefore O(log n) in the
+ * number of pieces, independent of the size of the text. Offsets are in
+ * bytes, and the text is expected to be UTF-8.
+ */
+class TextBuffer {
+ public:
+  /**
+   * @brief Creates a buffer holding some text.
+   * @param text Initial text of the buffer.
+   */
+  explicit TextBuffer(std::string text = std::string());
+
+  /**
+   * @brief Loads a buffer from a file, which is read as is.
+   * @param fname Name of the file.
+   */
+  static TextBuffer from_file(const std::filesystem::path& fname);
+
+  /**
+   * @brief Writes the text of the buffer to a file.
+   * @param fname Name of the file.
+   */
+  void save(const std::filesystem::path& fname) const;
+
+  /**
+   * @brief Returns the length of the text in bytes.
+   */
+  std::size_t size() const { return nodes_[root_].sub_length; }
+
+  /**
+   * @brief Returns true if the buffer holds no text.
+   */
+  bool empty() const { return size() == 0; }
+
+  /**
+   * @brief Returns the number of lines, which is one more than the number of
+   * newlines in the text.
+   */
+  std::size_t line_count() const { return nodes_[root_].sub_newlines + 1; }
+
+  /**
+   * @brief Returns the number of pieces describing the text.
+   */
+  std::size_t piece_count() const { return nodes_.size() - free_.size() - 1; }
+
+  /**
+   * @brief Returns the offset of the first character of a line.
+   * @param line Index of the line. Lines after the last line start at the
+   * end of the text.
+   */
+  std::size_t line_start(std::size_t line) const;
+
+  /**
+   * @brief Returns the offset of the end of a line, which is the offset of
+   * its newline, or the end of the text for the last line.
+   * @param line Index of the line.
+   */
+  std::size_t line_end(std::size_t line) const;
+
+  /**
+   * @brief Returns the index of the line containing an offset.
+   * @param offset Offset into the text, which is clamped to the size.
+   */
+  std::size_t line_of(std::size_t offset) const;
+
+  /**
+   * @brief Returns the byte at an offset.
+   * @param offset Offset into the text, which must be less than size().
+   */
+  char at(std::size_t offset) const;
+
+  /**
+   * @brief Returns a copy of part of the text.
+   * @param offset Offset of the first byte, which is clamped to the size.
+   * @param count Maximum number of bytes to copy.
+   */
+  std::string substr(std::size_t offset, std::size_t count) const;
+
+  /**
+   * @brief Returns a copy of the whole text.
+   */
+  std::string str() const { return substr(0, size()); }
+
+  /**
+   * @brief Inserts text at an offset.
+   * @param offset Offset at which the text is inserted, which must not be
+   * greater than size().
+   * @param text Text to insert.
+   */
+  void insert(std::size_t offset, std::string_view text);
+
+  /**
+   * @brief Removes part of the text.
+   * @param offset Offset of the first byte to remove, which must not be
+   * greater than size().
+   * @param count Number of bytes to remove, which is clamped to the end of
+   * the text.
+   */
+  void erase(std::size_t offset, std::size_t count);
+
+ private:
+  // Text which pieces refer to, and the offsets of its newlines.
+  struct Buffer {
+    std::string text;
+    std::vector<std::size_t> newlines;
+
+    void index(std::size_t from);
+    void append(std::string_view str);
+    std::size_t count_newlines(std::size_t begin, std::size_t end) const;
+  };
+
+  // Node 0 is an empty sentinel, which stands in for missing children.
+  struct Node {
+    std::size_t start;
+    std::size_t length;
+    std::size_t newlines;
+    std::size_t sub_length;
+    std::size_t sub_newlines;
+    std::uint32_t left;
+    std::uint32_t right;
+    std::uint32_t priority;
+    bool added;
+  };
+
+  Buffer original_;
+  Buffer added_;
+  std::vector<Node> nodes_;
+  std::vector<std::uint32_t> free_;
+  std::uint32_t root_;
+  std::uint32_t seed_;
+
+  const Buffer& buffer(const Node& node) const {
+    return node.added ? added_ : original_;
+  }
+  std::uint32_t make_node(bool added, std::size_t start, std::size_t length);
+  void free_nodes(std::uint32_t n);
+  void update(std::uint32_t n);
+  std::uint32_t merge(std::uint32_t a, std::uint32_t b);
+  void split(std::uint32_t n, std::size_t pos, std::uint32_t& a,
+             std::uint32_t& b);
+  void append_range(std::uint32_t n, std::size_t base, std::size_t begin,
+                    std::size_t end, std::string& out) const;
+};
+
+/**
+ * @brief A text editor widget for large documents, such as logs, scripts, or
+ * configuration files of hundreds of megabytes. The text is held in a
+ * TextBuffer, and only the lines which are on screen are read and laid out,
+ * using an ImGuiListClipper, so the cost of a frame and of an edit does not
+ * depend on the size of the document. Lines longer than
+ * TextEditor::max_line_display bytes are truncated on screen.
+ */
+class TextEditor {
+ public:
+  /**
+   * @brief Maximum number of bytes of a line which are displayed.
+   */
+  static constexpr std::size_t max_line_display = 64 * 1024;
+
+  /**
+   * @brief Creates an editor for a buffer.
+   * @param buffer Document to be edited.
+   */
+  explicit TextEditor(TextBuffer buffer = TextBuffer());
+
+  /**
+   * @brief Replaces the document with the contents of a file, and clears
+   * the undo history.
+   * @param fname Name of the file.
+   */
+  void open(const std::filesystem::path& fname);
+
+  /**
+   * @brief Writes the document to a file, and marks it as unmodified.
+   * @param fname Name of the file.
+   */
+  void save(const std::filesystem::path& fname);
+
+  /**
+   * @brief Replaces the document, and clears the undo history.
+   * @param text New text of the document.
+   */
+  void set_text(std::string text);
+
+  /**
+   * @brief Returns the document.
+   */
+  const TextBuffer& buffer() const { return buffer_; }
+
+  /**
+   * @brief Draws the editor in a child window. It takes keyboard input while
+   * the child window is focused.
+   * @param str_id ID of the child window.
+   * @param size Size of the child window. Zero uses the remaining space.
+   * @return True if the text was changed.
+   */
+  bool draw(const char* str_id, const ImVec2& size = ImVec2(0.f, 0.f));
+
+  /**
+   * @brief Returns true if the text was changed since it was loaded or last
+   * saved.
+   */
+  bool modified() const { return modified_; }
+
+  /**
+   * @brief Sets whether the text may be edited by the user.
+   */
+  void set_read_only(bool read_only) { read_only_ = read_only; }
+
+  /**
+   * @brief Returns true if the text may not be edited by the user.
+   */
+  bool read_only() const { return read_only_; }
+
+  /**
+   * @brief Returns the offset of the cursor.
+   */
+  std::size_t cursor() const { return cursor_; }
+
+  /**
+   * @brief Moves the cursor, clearing the selection, and scrolls to it.
+   * @param offset New offset of the cursor, which is clamped to the size.
+   */
+  void set_cursor(std::size_t offset);
+
+  /**
+   * @brief Selects a range of the text, and scrolls to its end.
+   * @param begin Offset at which the selection starts.
+   * @param end Offset at which the selection ends, where the cursor is.
+   */
+  void select(std::size_t begin, std::size_t end);
+
+  /**
+   * @brief Returns a copy of the selected text.
+   */
+  std::string selected_text() const;
+
+  /**
+   * @brief Replaces the selection with some text, which is recorded in the
+   * undo history.
+   * @param text Text to insert.
+   */
+  void insert(std::string_view text);
+
+  /**
+   * @brief Undoes the last edit.
+   * @return False if there was nothing to undo.
+   */
+  bool undo();
+
+  /**
+   * @brief Redoes the last edit which was undone.
+   * @return False if there was nothing to redo.
+   */
+  bool redo();
+
+ private:
+  // An edit replaced the removed text at offset with the inserted text.
+  struct Edit {
+    std::size_t offset;
+    std::string removed;
+    std::string inserted;
+    bool typing;
+  };
+
+  TextBuffer buffer_;
+  std::size_t cursor_;
+  std::size_t anchor_;
+  float preferred_x_;
+  float content_width_;
+  bool read_only_;
+  bool modified_;
+  bool changed_;
+  bool selecting_;
+  bool scroll_to_cursor_;
+  std::vector<Edit> undo_;
+  std::vector<Edit> redo_;
+
+  std::size_t selection_begin() const { return std::min(cursor_, anchor_); }
+  std::size_t selection_end() const { return std::max(cursor_, anchor_); }
+  void reset();
+  void replace(std::size_t offset, std::size_t count, std::string_view text,
+               bool typing);
+  void move_to(std::size_t offset, bool extend);
+  std::size_t next_char(std::size_t offset) const;
+  std::size_t prev_char(std::size_t offset) const;
+  std::size_t next_word(std::size_t offset) const;
+  std::size_t prev_word(std::size_t offset) const;
+  std::string line_text(std::size_t line) const;
+  float x_of(std::size_t offset) const;
+  std::size_t offset_at(std::size_t line, float x) const;
+  void handle_keyboard(float page_lines);
+};
+
+}  // namespace ImApp
+#endif
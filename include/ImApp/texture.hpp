@@ -0,0 +1,175 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_TEXTURE_H
+#define IMAPP_TEXTURE_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace ImApp {
+
+template <typename P>
+class BasicImage;
+
+class Texture;
+
+namespace detail {
+// Tells the ResidencyManager that a tracked texture has a new owner, or that
+// it is about to be deleted or released.
+void move_tracked_texture(Texture& texture) noexcept;
+void untrack_texture(Texture& texture) noexcept;
+}  // namespace detail
+
+/**
+ * @brief Owns an OpenGL texture, which is deleted when the Texture is
+ * destroyed. Textures can be moved but not copied, so there is always exactly
+ * one owner. When several owners are needed, such as a texture which is drawn
+ * by many layers, the texture can be shared with Texture::share. Textures
+ * must only be created and destroyed on the thread which owns the OpenGL
+ * context. Textures which belong to an image are tracked by the
+ * ResidencyManager, and may be deleted by it when they have not been drawn
+ * for a while.
+ */
+class Texture {
+ public:
+  /**
+   * @brief Creates an empty handle, which owns no texture.
+   */
+  Texture() noexcept : id_(0), height_(0), width_(0), tracked_(false) {}
+
+  /**
+   * @brief Takes ownership of an existing OpenGL texture.
+   * @param id OpenGL name of the texture.
+   * @param height Height of the storage of the texture.
+   * @param width Width of the storage of the texture.
+   */
+  Texture(std::uint32_t id, std::uint32_t height, std::uint32_t width) noexcept
+      : id_(id), height_(height), width_(width), tracked_(false) {}
+
+  Texture(const Texture&) = delete;
+  Texture& operator=(const Texture&) = delete;
+
+  Texture(Texture&& other) noexcept
+      : id_(std::exchange(other.id_, 0)),
+        height_(std::exchange(other.height_, 0)),
+        width_(std::exchange(other.width_, 0)),
+        tracked_(std::exchange(other.tracked_, false)) {
+    if (tracked_) detail::move_tracked_texture(*this);
+  }
+
+  Texture& operator=(Texture&& other) noexcept {
+    if (this != &other) {
+      this->reset();
+      id_ = std::exchange(other.id_, 0);
+      height_ = std::exchange(other.height_, 0);
+      width_ = std::exchange(other.width_, 0);
+      tracked_ = std::exchange(other.tracked_, false);
+      if (tracked_) detail::move_tracked_texture(*this);
+    }
+    return *this;
+  }
+
+  ~Texture() { this->reset(); }
+
+  /**
+   * @brief Creates a new OpenGL texture with linear filtering, and leaves it
+   * bound to GL_TEXTURE_2D. No storage is allocated for it.
+   */
+  static Texture generate();
+
+  /**
+   * @brief Returns the OpenGL name of the texture, or zero if the handle is
+   * empty.
+   */
+  std::uint32_t id() const { return id_; }
+
+  /**
+   * @brief Returns the height of the storage of the texture.
+   */
+  std::uint32_t height() const { return height_; }
+
+  /**
+   * @brief Returns the width of the storage of the texture.
+   */
+  std::uint32_t width() const { return width_; }
+
+  /**
+   * @brief Returns true if the handle owns a texture.
+   */
+  explicit operator bool() const { return id_ != 0; }
+
+  /**
+   * @brief Deletes the texture, leaving the handle empty.
+   */
+  void reset() noexcept;
+
+  /**
+   * @brief Returns true if the texture is tracked by the ResidencyManager.
+   */
+  bool tracked() const { return tracked_; }
+
+  /**
+   * @brief Gives up ownership of the texture without deleting it. The
+   * texture is no longer tracked by the ResidencyManager.
+   * @return OpenGL name of the texture, which the caller must delete.
+   */
+  std::uint32_t release() noexcept {
+    if (tracked_) detail::untrack_texture(*this);
+    height_ = 0;
+    width_ = 0;
+    return std::exchange(id_, 0);
+  }
+
+  /**
+   * @brief Moves the texture into a reference counted handle, which deletes
+   * the texture once the last copy is destroyed.
+   */
+  std::shared_ptr<Texture> share() && {
+    return std::make_shared<Texture>(std::move(*this));
+  }
+
+ private:
+  std::uint32_t id_;
+  std::uint32_t height_, width_;
+  bool tracked_;
+
+  template <typename P>
+  friend class BasicImage;
+  friend class TextureUploader;
+  friend class ResidencyManager;
+  friend class TexturePool;
+};
+
+}  // namespace ImApp
+#endif
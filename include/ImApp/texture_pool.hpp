@@ -0,0 +1,189 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_TEXTURE_POOL_H
+#define IMAPP_TEXTURE_POOL_H
+
+#include <ImApp/texture.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ImApp {
+
+/**
+ * @brief Recycles OpenGL textures, so that images which are created and
+ * destroyed every frame with the same size don't allocate new storage every
+ * time. Textures are kept by their height, width, and internal format, and
+ * new textures are given immutable storage with glTexStorage2D when it is
+ * available. Images take their textures from the global pool in
+ * BasicImage::send_to_gpu, and give them back in BasicImage::delete_from_gpu
+ * and on destruction. Unused textures are kept up to a capacity, beyond
+ * which the ones which were given back first are deleted. Textures must only
+ * be acquired and deleted on the thread which owns the OpenGL context.
+ */
+class TexturePool {
+ public:
+  /**
+   * @brief Creates an empty pool.
+   * @param capacity Number of bytes which unused textures may occupy.
+   */
+  explicit TexturePool(std::size_t capacity = 64 * 1024 * 1024);
+  ~TexturePool();
+
+  TexturePool(const TexturePool&) = delete;
+  TexturePool& operator=(const TexturePool&) = delete;
+
+  /**
+   * @brief Returns the pool which is used by all images.
+   */
+  static TexturePool& global();
+
+  /**
+   * @brief Returns a texture with storage for the given size and format,
+   * which is left bound to GL_TEXTURE_2D. The contents of the texture are
+   * undefined. Single channel formats are displayed in gray.
+   * @param height Height of the texture.
+   * @param width Width of the texture.
+   * @param internal_format Sized OpenGL internal format, such as GL_RGBA8.
+   */
+  Texture acquire(std::uint32_t height, std::uint32_t width,
+                  std::int32_t internal_format);
+
+  /**
+   * @brief Gives a texture back to the pool, so that it can be handed out
+   * again by acquire. Empty textures are ignored.
+   * @param texture Texture which is no longer used.
+   * @param internal_format Internal format of the texture.
+   */
+  void recycle(Texture texture, std::int32_t internal_format);
+
+  /**
+   * @brief Sets the number of bytes which unused textures may occupy, and
+   * deletes unused textures until they fit.
+   * @param bytes New capacity in bytes.
+   */
+  void set_capacity(std::size_t bytes);
+
+  /**
+   * @brief Returns the number of bytes which unused textures may occupy.
+   */
+  std::size_t capacity() const;
+
+  /**
+   * @brief Deletes the unused textures which were given back first, until
+   * they occupy no more than a number of bytes.
+   * @param target Number of bytes which may remain in the pool.
+   * @return Number of bytes which were deleted.
+   */
+  std::size_t trim(std::size_t target);
+
+  /**
+   * @brief Deletes all unused textures. This is called by the App before
+   * its OpenGL context is destroyed.
+   */
+  void clear() { this->trim(0); }
+
+  /**
+   * @brief Returns the number of bytes occupied by unused textures.
+   */
+  std::size_t bytes() const;
+
+  /**
+   * @brief Returns the number of unused textures.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Returns the number of calls to acquire which reused a texture.
+   */
+  std::uint64_t hits() const;
+
+  /**
+   * @brief Returns the number of calls to acquire which created a texture.
+   */
+  std::uint64_t misses() const;
+
+  /**
+   * @brief Returns the number of bytes of GPU memory used by a texture.
+   * @param height Height of the texture.
+   * @param width Width of the texture.
+   * @param internal_format Sized OpenGL internal format of the texture.
+   */
+  static std::size_t texture_bytes(std::uint32_t height, std::uint32_t width,
+                                   std::int32_t internal_format);
+
+ private:
+  struct Key {
+    std::uint32_t height, width;
+    std::int32_t internal_format;
+
+    bool operator==(const Key& other) const {
+      return height == other.height && width == other.width &&
+             internal_format == other.internal_format;
+    }
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      std::uint64_t h = (std::uint64_t(key.height) << 32) | key.width;
+      h ^= std::uint64_t(std::uint32_t(key.internal_format)) *
+           0x9E3779B97F4A7C15ull;
+      return static_cast<std::size_t>(h ^ (h >> 29));
+    }
+  };
+
+  struct Entry {
+    Key key;
+    std::uint32_t id;
+    std::size_t bytes;
+  };
+
+  mutable std::mutex mutex_;
+  // Unused textures, from the most to the least recently given back.
+  std::list<Entry> free_;
+  std::unordered_map<Key, std::vector<std::list<Entry>::iterator>, KeyHash>
+      by_key_;
+  std::size_t capacity_;
+  std::size_t bytes_;
+  std::uint64_t hits_;
+  std::uint64_t misses_;
+
+  std::size_t trim_locked(std::size_t target);
+};
+
+}  // namespace ImApp
+#endif
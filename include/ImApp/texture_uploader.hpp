@@ -0,0 +1,207 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_TEXTURE_UPLOADER_H
+#define IMAPP_TEXTURE_UPLOADER_H
+
+#include <ImApp/image.hpp>
+#include <ImApp/texture.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+
+namespace ImApp {
+
+namespace detail {
+/**
+ * @brief The pixels of an image, described independently of their pixel
+ * type, together with the OpenGL format of the texture which holds them.
+ */
+struct UploadSource {
+  std::shared_ptr<const void> keep_alive;
+  const unsigned char* pixels = nullptr;
+  std::uint32_t height = 0, width = 0;
+  std::size_t row_bytes = 0;
+  std::size_t stride_bytes = 0;
+  std::int32_t internal_format = 0;
+  std::uint32_t format = 0, type = 0;
+  bool gray = false;
+};
+
+/**
+ * @brief Describes the pixels of an image for an upload. The pixels are
+ * shared, not copied, so the image may be destroyed afterwards.
+ */
+template <typename P>
+UploadSource upload_source(const BasicImage<P>& image);
+
+/**
+ * @brief Returns true if single channel textures can be displayed in gray.
+ * The first call must be made while an OpenGL context is current.
+ */
+bool texture_swizzle_supported();
+}  // namespace detail
+
+/**
+ * @brief Uploads images to the GPU without blocking the render thread. The
+ * uploader owns a hidden window whose OpenGL context shares textures with
+ * the main window, and a thread which makes that context current. The thread
+ * copies the pixels into pixel buffer objects, uploads them to new textures,
+ * and places a fence after each texture. Once a fence has been passed, the
+ * texture is handed back to the render thread at the start of a frame. The
+ * number of bytes uploaded per frame is limited, and large images are
+ * uploaded in bands of rows over several frames, so that uploads never
+ * compete with rendering for a whole frame. If a shared context can't be
+ * created, the same bands are uploaded on the render thread instead. An
+ * ImApp::App owns an uploader, which can be accessed through
+ * app()->uploader().
+ */
+class TextureUploader {
+ public:
+  /**
+   * @brief Function which receives a finished texture on the render thread.
+   */
+  using Callback = std::function<void(Texture)>;
+
+  /**
+   * @brief Creates the uploader. Must be called on the main thread, while the
+   * context of the main window is current.
+   * @param main_window Window whose context the textures are shared with.
+   * @param frame_budget Maximum number of bytes uploaded per frame.
+   */
+  explicit TextureUploader(GLFWwindow* main_window,
+                           std::size_t frame_budget = 16 << 20);
+  ~TextureUploader();
+
+  TextureUploader(const TextureUploader&) = delete;
+  TextureUploader& operator=(const TextureUploader&) = delete;
+
+  /**
+   * @brief Queues an image for upload. This may be called from any thread.
+   * The pixels are shared with the image, not copied, so the image may be
+   * destroyed right away, but its pixels must not be modified until on_ready
+   * has been called. Upload a copy to keep modifying the image.
+   * @param image Image to be uploaded.
+   * @param on_ready Called on the render thread with the finished texture,
+   * at the start of a frame. Images without pixels produce an empty texture.
+   */
+  template <typename P>
+  void upload(const BasicImage<P>& image, Callback on_ready) {
+    this->enqueue(detail::upload_source(image), std::move(on_ready));
+  }
+
+  /**
+   * @brief Starts a new frame of uploads, and hands the finished textures to
+   * their callbacks. This is called by App::run at the start of every frame,
+   * on the render thread.
+   */
+  void begin_frame();
+
+  /**
+   * @brief Returns true if uploads happen on a background thread, and false
+   * if they happen on the render thread in begin_frame.
+   */
+  bool asynchronous() const { return context_ != nullptr; }
+
+  /**
+   * @brief Returns the number of uploads whose callbacks have not yet been
+   * called.
+   */
+  std::size_t pending() const {
+    return outstanding_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Returns the maximum number of bytes uploaded per frame.
+   */
+  std::size_t frame_budget() const;
+
+  /**
+   * @brief Sets the maximum number of bytes uploaded per frame. At least one
+   * row of an image is uploaded in every frame, even if it is larger.
+   * @param bytes Maximum number of bytes per frame.
+   */
+  void set_frame_budget(std::size_t bytes);
+
+ private:
+  struct Request {
+    detail::UploadSource source;
+    Callback on_ready;
+    Texture texture;
+    std::uint32_t next_row = 0;
+  };
+
+  struct Finished {
+    Texture texture;
+    Callback on_ready;
+    void* fence = nullptr;
+  };
+
+  // Entry points of the OpenGL functions which are newer than 1.1
+  struct GLFunctions;
+
+  GLFWwindow* context_;
+  std::unique_ptr<GLFunctions> gl_;
+  std::uint32_t pbo_;
+  std::vector<unsigned char> scratch_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> queue_;
+  std::optional<Request> current_;
+  std::vector<Finished> finished_;
+  std::size_t frame_budget_;
+  std::size_t credit_;
+  std::atomic<std::size_t> outstanding_;
+  bool stop_;
+  std::thread thread_;
+
+  void enqueue(detail::UploadSource source, Callback on_ready);
+  void run(int gl_major, bool gl_sync);
+  bool next_band(std::size_t& rows);
+  void upload_rows(Request& request, std::size_t rows);
+  void retire(std::vector<Finished>& in_flight);
+};
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,201 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_TREE_VIEW_H
+#define IMAPP_TREE_VIEW_H
+
+#include <ImApp/imgui.h>
+#include <ImApp/job_system.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ImApp {
+
+/**
+ * @brief A node of a TreeView, as returned by its loader.
+ */
+struct TreeItem {
+  std::uint64_t id;  /**< Identifier which is passed back to the loader. */
+  std::string label; /**< Text which is displayed for the node. */
+  bool has_children; /**< True if the node can be expanded. */
+};
+
+/**
+ * @brief A tree widget for very large hierarchies, such as file systems or
+ * symbol tables. Instead of submitting a tree node for every open node, the
+ * open part of the tree is kept as a flat array of rows, which is updated
+ * when a node is expanded or collapsed, and only the rows which are on
+ * screen are drawn, with an ImGuiListClipper. The children of a node are
+ * requested from a loader the first time that the node is expanded. When the
+ * tree has a JobSystem, the loader runs on a worker thread, and the children
+ * appear once the main thread has drained its continuations. Otherwise, the
+ * children are loaded right away. All methods must be called on the main
+ * thread.
+ */
+class TreeView {
+ public:
+  /**
+   * @brief Function which returns the children of the node with an id. It
+   * may be called on several worker threads at once. If it throws, the node
+   * is shown as failed, and is loaded again the next time it is expanded.
+   */
+  using Loader = std::function<std::vector<TreeItem>(std::uint64_t id)>;
+
+  /**
+   * @brief Creates a tree whose top level nodes are the children of root.
+   * @param loader Function which loads the children of a node.
+   * @param jobs JobSystem on which children are loaded. If nullptr, they
+   * are loaded on the main thread, when a node is expanded.
+   * @param root Identifier which is passed to the loader for the top level.
+   */
+  explicit TreeView(Loader loader, JobSystem* jobs = nullptr,
+                    std::uint64_t root = 0);
+  ~TreeView();
+
+  TreeView(const TreeView&) = delete;
+  TreeView& operator=(const TreeView&) = delete;
+
+  /**
+   * @brief Draws the tree in a child window. Clicking a node selects it, and
+   * clicking its arrow or double clicking it expands or collapses it. The
+   * left and right arrow keys collapse and expand the selected node.
+   * @param str_id ID of the child window.
+   * @param size Size of the child window. Zero uses the remaining space.
+   * @return True if the selection changed.
+   */
+  bool draw(const char* str_id, const ImVec2& size = ImVec2(0.f, 0.f));
+
+  /**
+   * @brief Returns the number of rows, which is the number of nodes whose
+   * ancestors are all expanded.
+   */
+  std::size_t row_count() const { return rows_.size(); }
+
+  /**
+   * @brief Returns the item which is displayed in a row.
+   * @param row Row of the item, which must be less than row_count().
+   */
+  const TreeItem& item(std::size_t row) const;
+
+  /**
+   * @brief Returns the depth of the node in a row, which is zero for the
+   * top level nodes.
+   * @param row Row of the node, which must be less than row_count().
+   */
+  std::uint32_t depth(std::size_t row) const;
+
+  /**
+   * @brief Returns true if the node in a row is expanded.
+   * @param row Row of the node, which must be less than row_count().
+   */
+  bool is_open(std::size_t row) const;
+
+  /**
+   * @brief Expands the node in a row, loading its children if they haven't
+   * been loaded yet. Nodes without children are ignored.
+   * @param row Row of the node, which must be less than row_count().
+   */
+  void expand(std::size_t row);
+
+  /**
+   * @brief Collapses the node in a row. Its children stay loaded, and keep
+   * their own state, so expanding it again is cheap.
+   * @param row Row of the node, which must be less than row_count().
+   */
+  void collapse(std::size_t row);
+
+  /**
+   * @brief Returns the row of the selected node, if a node is selected and
+   * all of its ancestors are expanded.
+   */
+  std::optional<std::size_t> selected_row() const;
+
+  /**
+   * @brief Returns the item of the selected node, if a node is selected.
+   */
+  const TreeItem* selected() const;
+
+  /**
+   * @brief Returns the number of nodes whose children are being loaded.
+   */
+  std::size_t loading() const { return loading_; }
+
+  /**
+   * @brief Discards all nodes and loads the top level again. Loads which are
+   * still running are ignored once they finish.
+   */
+  void refresh();
+
+ private:
+  enum class State : std::uint8_t { Unloaded, Loading, Loaded, Failed };
+
+  static constexpr std::uint32_t npos = 0xFFFFFFFF;
+
+  // The children of a node are loaded together, so they are contiguous.
+  struct Node {
+    TreeItem item;
+    std::uint32_t parent;
+    std::uint32_t first_child;
+    std::uint32_t child_count;
+    std::uint32_t depth;
+    State state;
+    bool open;
+  };
+
+  Loader loader_;
+  JobSystem* jobs_;
+  std::uint64_t root_id_;
+  std::vector<Node> nodes_;
+  // Index into nodes_ of the node in each row.
+  std::vector<std::uint32_t> rows_;
+  State root_state_;
+  std::uint32_t selected_;
+  std::size_t loading_;
+  std::uint64_t generation_;
+  // Loads which finish after the tree was destroyed see an expired pointer.
+  std::shared_ptr<TreeView*> self_;
+
+  void load(std::uint32_t node);
+  void finish_load(std::uint32_t node,
+                   std::optional<std::vector<TreeItem>> children);
+  void append_open_children(std::uint32_t node,
+                            std::vector<std::uint32_t>& out) const;
+  std::optional<std::size_t> row_of(std::uint32_t node) const;
+};
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,750 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <ImApp/codec.hpp>
+#include <climits>
+#include <csetjmp>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#ifdef IMAPP_USE_LIBJPEG
+#include <cstdio>  // jpeglib.h needs FILE
+#include <jpeglib.h>
+#endif
+
+#ifdef IMAPP_USE_LIBPNG
+#include <png.h>
+#endif
+
+#ifdef IMAPP_USE_LIBWEBP
+#include <webp/decode.h>
+#endif
+
+namespace ImApp {
+
+ImageFormat detect_format(const unsigned char* data, std::size_t size) {
+  auto starts_with = [data, size](const char* magic, std::size_t n,
+                                  std::size_t offset = 0) {
+    return size >= offset + n && std::memcmp(data + offset, magic, n) == 0;
+  };
+
+  if (starts_with("\x89PNG\r\n\x1A\n", 8)) return ImageFormat::PNG;
+  if (starts_with("\xFF\xD8\xFF", 3)) return ImageFormat::JPEG;
+  if (starts_with("RIFF", 4) && starts_with("WEBP", 4, 8))
+    return ImageFormat::WebP;
+  if (starts_with("GIF8", 4)) return ImageFormat::GIF;
+  if (starts_with("BM", 2)) return ImageFormat::BMP;
+  if (starts_with("8BPS", 4)) return ImageFormat::PSD;
+  if (starts_with("#?RADIANCE", 10) || starts_with("#?RGBE", 6))
+    return ImageFormat::HDR;
+  if (starts_with("P5", 2) || starts_with("P6", 2)) return ImageFormat::PNM;
+  if (starts_with("\x53\x80\xF6\x34", 4)) return ImageFormat::PIC;
+  return ImageFormat::Unknown;
+}
+
+namespace {
+// Converts a row of gray, RGB, or RGBA pixels with 8 or 16 bit channels to
+// the layout of a sink. Color is reduced to gray with the same weights as
+// stb_image, and 8-bit values are widened to 16 bits by repeating the byte.
+template <typename T>
+void convert_row(const T* in, int in_channels, std::uint32_t width,
+                 const DecodeSink& sink, unsigned char* out) {
+  constexpr std::uint32_t max = sizeof(T) == 1 ? 0xFF : 0xFFFF;
+  const int out_channels = sink.channels();
+  const bool wide = sink.bit_depth() == 16;
+  for (std::uint32_t x = 0; x < width; x++, in += in_channels) {
+    std::uint32_t c[4];
+    if (in_channels >= 3) {
+      c[0] = in[0];
+      c[1] = in[1];
+      c[2] = in[2];
+    } else {
+      c[0] = c[1] = c[2] = in[0];
+    }
+    c[3] = in_channels == 4 || in_channels == 2 ? in[in_channels - 1] : max;
+    if (out_channels <= 2) {
+      c[0] = (c[0] * 77 + c[1] * 150 + c[2] * 29) >> 8;
+      c[1] = c[3];
+    }
+
+    for (int k = 0; k < out_channels; k++) {
+      if (wide) {
+        const std::uint16_t v =
+            static_cast<std::uint16_t>(sizeof(T) == 1 ? c[k] * 257 : c[k]);
+        std::memcpy(out, &v, 2);
+        out += 2;
+      } else {
+        *out++ = static_cast<unsigned char>(sizeof(T) == 1 ? c[k] : c[k] >> 8);
+      }
+    }
+  }
+}
+
+// stb_image reads streams through these callbacks.
+int stb_read(void* user, char* data, int size) {
+  std::istream* stream = static_cast<std::istream*>(user);
+  stream->read(data, size);
+  return static_cast<int>(stream->gcount());
+}
+
+void stb_skip(void* user, int n) {
+  std::istream* stream = static_cast<std::istream*>(user);
+  stream->clear();
+  stream->seekg(n, std::ios::cur);
+}
+
+int stb_eof(void* user) {
+  std::istream* stream = static_cast<std::istream*>(user);
+  return stream->peek() == std::char_traits<char>::eof();
+}
+
+class StbDecoder final : public ImageDecoder {
+ public:
+  const char* name() const override { return "stb"; }
+
+  bool supports(ImageFormat format) const override {
+    return format != ImageFormat::WebP;
+  }
+
+  bool decode(const unsigned char* data, std::size_t size, DecodeSink& sink,
+              std::string& error) override {
+    if (size > static_cast<std::size_t>(INT_MAX)) {
+      error = "Image is too large.";
+      return false;
+    }
+
+    int width = 0, height = 0;
+    void* pixels = nullptr;
+    if (sink.bit_depth() == 16) {
+      pixels = stbi_load_16_from_memory(data, static_cast<int>(size), &width,
+                                        &height, nullptr, sink.channels());
+    } else {
+      pixels = stbi_load_from_memory(data, static_cast<int>(size), &width,
+                                     &height, nullptr, sink.channels());
+    }
+    return finish(pixels, height, width, sink, error);
+  }
+
+  bool decode_stream(std::istream& stream, DecodeSink& sink,
+                     std::string& error) override {
+    // The file is read as it is decoded, but stb only hands out the pixels
+    // once all of them are done.
+    const stbi_io_callbacks callbacks = {stb_read, stb_skip, stb_eof};
+    int width = 0, height = 0;
+    void* pixels = nullptr;
+    if (sink.bit_depth() == 16) {
+      pixels = stbi_load_16_from_callbacks(&callbacks, &stream, &width,
+                                           &height, nullptr, sink.channels());
+    } else {
+      pixels = stbi_load_from_callbacks(&callbacks, &stream, &width, &height,
+                                        nullptr, sink.channels());
+    }
+    return finish(pixels, height, width, sink, error);
+  }
+
+ private:
+  static bool finish(void* pixels, int height, int width, DecodeSink& sink,
+                     std::string& error) {
+    if (pixels == nullptr) {
+      error = stbi_failure_reason();
+      return false;
+    }
+
+    const std::uint32_t h = static_cast<std::uint32_t>(height);
+    sink.begin(h, static_cast<std::uint32_t>(width));
+    const std::size_t row_bytes = sink.row_bytes();
+    const unsigned char* in = static_cast<const unsigned char*>(pixels);
+    for (std::uint32_t y = 0; y < h; y++) {
+      std::memcpy(sink.row(y), in + y * row_bytes, row_bytes);
+    }
+    stbi_image_free(pixels);
+    sink.rows_ready(0, h);
+    return true;
+  }
+};
+
+#ifdef IMAPP_USE_LIBJPEG
+struct JpegError {
+  jpeg_error_mgr mgr;
+  std::jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+void on_jpeg_error(j_common_ptr cinfo) {
+  JpegError* err = reinterpret_cast<JpegError*>(cinfo->err);
+  (*cinfo->err->format_message)(cinfo, err->message);
+  std::longjmp(err->jump, 1);
+}
+
+void on_jpeg_message(j_common_ptr) {}
+
+// A libjpeg source which reads a stream one buffer at a time.
+struct JpegStream {
+  jpeg_source_mgr mgr;
+  std::istream* stream;
+  std::vector<unsigned char>* buffer;
+};
+
+void jpeg_init_stream(j_decompress_ptr) {}
+
+boolean jpeg_fill_stream(j_decompress_ptr cinfo) {
+  JpegStream* src = reinterpret_cast<JpegStream*>(cinfo->src);
+  unsigned char* buffer = src->buffer->data();
+  src->stream->read(reinterpret_cast<char*>(buffer),
+                    static_cast<std::streamsize>(src->buffer->size()));
+  std::size_t n = static_cast<std::size_t>(src->stream->gcount());
+  if (n == 0) {
+    // Insert a fake end of image marker, as the sources of libjpeg do, so
+    // truncated files still give the rows which were decoded.
+    buffer[0] = 0xFF;
+    buffer[1] = JPEG_EOI;
+    n = 2;
+  }
+  src->mgr.next_input_byte = buffer;
+  src->mgr.bytes_in_buffer = n;
+  return TRUE;
+}
+
+void jpeg_skip_stream(j_decompress_ptr cinfo, long n) {
+  JpegStream* src = reinterpret_cast<JpegStream*>(cinfo->src);
+  if (n <= 0) return;
+  while (static_cast<std::size_t>(n) > src->mgr.bytes_in_buffer) {
+    n -= static_cast<long>(src->mgr.bytes_in_buffer);
+    jpeg_fill_stream(cinfo);
+  }
+  src->mgr.next_input_byte += n;
+  src->mgr.bytes_in_buffer -= static_cast<std::size_t>(n);
+}
+
+void jpeg_term_stream(j_decompress_ptr) {}
+
+// Where read_jpeg takes its input from, either memory or a stream.
+struct JpegInput {
+  const unsigned char* data;
+  std::size_t size;
+  JpegStream* stream;
+};
+
+// Kept free of objects with destructors, as libjpeg reports errors with
+// longjmp. The scratch row is only needed when the sink has a layout which
+// libjpeg can't produce itself. When max_preview is given, the image is
+// decoded at the smallest of the 1/2, 1/4, and 1/8 scales which is still
+// max_preview pixels along its longer side, which costs a fraction of a
+// full decode.
+bool read_jpeg(const JpegInput& input, DecodeSink& sink,
+               std::vector<unsigned char>& scratch, std::string& error,
+               std::uint32_t max_preview = 0) {
+  jpeg_decompress_struct cinfo;
+  JpegError err;
+  cinfo.err = jpeg_std_error(&err.mgr);
+  err.mgr.error_exit = on_jpeg_error;
+  err.mgr.output_message = on_jpeg_message;
+  if (setjmp(err.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    error = err.message;
+    return false;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  if (input.stream) {
+    cinfo.src = &input.stream->mgr;
+  } else {
+    jpeg_mem_src(&cinfo, input.data, static_cast<unsigned long>(input.size));
+  }
+  jpeg_read_header(&cinfo, TRUE);
+
+  if (max_preview > 0) {
+    const std::uint32_t longest =
+        std::max(cinfo.image_width, cinfo.image_height);
+    unsigned int denom = 1;
+    while (denom < 8 && longest / (denom * 2) >= max_preview) denom *= 2;
+    if (denom == 1) {
+      jpeg_destroy_decompress(&cinfo);
+      error = "Image is too small for a preview.";
+      return false;
+    }
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = denom;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+  }
+
+  const int channels = sink.channels();
+  const bool wide = sink.bit_depth() == 16;
+  if (channels <= 2) {
+    cinfo.out_color_space = JCS_GRAYSCALE;
+#ifdef JCS_EXTENSIONS
+  } else if (channels == 4) {
+    cinfo.out_color_space = JCS_EXT_RGBA;
+#endif
+  } else {
+    cinfo.out_color_space = JCS_RGB;
+  }
+  jpeg_start_decompress(&cinfo);
+
+  const std::uint32_t width = cinfo.output_width;
+  const bool direct = !wide && cinfo.output_components == channels;
+  if (!direct) {
+    scratch.resize(static_cast<std::size_t>(width) *
+                   static_cast<std::size_t>(cinfo.output_components));
+  }
+
+  sink.begin(cinfo.output_height, width);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    const std::uint32_t y = cinfo.output_scanline;
+    JSAMPROW row = direct ? sink.row(y) : scratch.data();
+    jpeg_read_scanlines(&cinfo, &row, 1);
+    if (!direct) {
+      convert_row<unsigned char>(scratch.data(), cinfo.output_components,
+                                 width, sink, sink.row(y));
+    }
+    sink.rows_ready(y, y + 1);
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
+class JpegDecoder final : public ImageDecoder {
+ public:
+  const char* name() const override { return "libjpeg"; }
+
+  bool supports(ImageFormat format) const override {
+    return format == ImageFormat::JPEG;
+  }
+
+  bool decode(const unsigned char* data, std::size_t size, DecodeSink& sink,
+              std::string& error) override {
+    std::vector<unsigned char> scratch;
+    return read_jpeg({data, size, nullptr}, sink, scratch, error);
+  }
+
+  bool decode_stream(std::istream& stream, DecodeSink& sink,
+                     std::string& error) override {
+    std::vector<unsigned char> buffer(stream_buffer_size), scratch;
+    JpegStream src = make_source(stream, buffer);
+    return read_jpeg({nullptr, 0, &src}, sink, scratch, error);
+  }
+
+  bool preview(std::istream& stream, DecodeSink& sink, std::uint32_t max_size,
+               std::string& error) override {
+    std::vector<unsigned char> buffer(stream_buffer_size), scratch;
+    JpegStream src = make_source(stream, buffer);
+    return read_jpeg({nullptr, 0, &src}, sink, scratch, error,
+                     std::max(max_size, 1u));
+  }
+
+ private:
+  static constexpr std::size_t stream_buffer_size = 64 * 1024;
+
+  static JpegStream make_source(std::istream& stream,
+                                std::vector<unsigned char>& buffer) {
+    JpegStream src;
+    src.mgr.next_input_byte = nullptr;
+    src.mgr.bytes_in_buffer = 0;
+    src.mgr.init_source = jpeg_init_stream;
+    src.mgr.fill_input_buffer = jpeg_fill_stream;
+    src.mgr.skip_input_data = jpeg_skip_stream;
+    src.mgr.resync_to_restart = jpeg_resync_to_restart;
+    src.mgr.term_source = jpeg_term_stream;
+    src.stream = &stream;
+    src.buffer = &buffer;
+    return src;
+  }
+};
+#endif
+
+#ifdef IMAPP_USE_LIBPNG
+// Where read_png takes its input from, either memory or a stream.
+struct PngSource {
+  const unsigned char* data;
+  std::size_t size;
+  std::size_t offset;
+  std::istream* stream;
+  char message[256];
+};
+
+void on_png_read(png_structp png, png_bytep out, png_size_t n) {
+  PngSource* src = static_cast<PngSource*>(png_get_io_ptr(png));
+  if (src->stream) {
+    src->stream->read(reinterpret_cast<char*>(out),
+                      static_cast<std::streamsize>(n));
+    if (static_cast<png_size_t>(src->stream->gcount()) != n)
+      png_error(png, "Truncated PNG file.");
+    return;
+  }
+
+  if (n > src->size - src->offset) png_error(png, "Truncated PNG file.");
+  std::memcpy(out, src->data + src->offset, n);
+  src->offset += n;
+}
+
+void on_png_error(png_structp png, png_const_charp message) {
+  PngSource* src = static_cast<PngSource*>(png_get_error_ptr(png));
+  std::strncpy(src->message, message, sizeof(src->message) - 1);
+  src->message[sizeof(src->message) - 1] = '\0';
+  png_longjmp(png, 1);
+}
+
+void on_png_warning(png_structp, png_const_charp) {}
+
+// Like read_jpeg, this is kept free of objects with destructors, as libpng
+// reports errors with longjmp. Color images are reduced to gray by
+// convert_row, from the scratch buffer, so that the result matches stb.
+bool read_png(PngSource& src, DecodeSink& sink,
+              std::vector<unsigned char>& scratch, std::string& error) {
+  png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &src,
+                                           on_png_error, on_png_warning);
+  if (png == nullptr) {
+    error = "Could not create PNG reader.";
+    return false;
+  }
+  png_infop info = png_create_info_struct(png);
+  if (info == nullptr) {
+    png_destroy_read_struct(&png, nullptr, nullptr);
+    error = "Could not create PNG reader.";
+    return false;
+  }
+  if (setjmp(png_jmpbuf(png))) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    error = src.message;
+    return false;
+  }
+
+  png_set_read_fn(png, &src, on_png_read);
+  png_read_info(png, info);
+
+  const int color_type = png_get_color_type(png, info);
+  const int bit_depth = png_get_bit_depth(png, info);
+  const bool trns = png_get_valid(png, info, PNG_INFO_tRNS) != 0;
+  const bool wide = sink.bit_depth() == 16;
+  const bool want_color = sink.channels() >= 3;
+  const bool want_alpha = sink.channels() == 2 || sink.channels() == 4;
+  const bool has_color = (color_type & PNG_COLOR_MASK_COLOR) != 0;
+  const bool has_alpha = (color_type & PNG_COLOR_MASK_ALPHA) != 0 || trns;
+
+  // Expand palettes, low bit depths, and transparency to whole channels
+  if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+  if (!has_color && bit_depth < 8) png_set_expand_gray_1_2_4_to_8(png);
+  if (trns) png_set_tRNS_to_alpha(png);
+
+  if (bit_depth == 16 && !wide) png_set_strip_16(png);
+  if (bit_depth < 16 && wide) png_set_expand_16(png);
+  if (wide) {
+    // PNG is big endian, and the sink wants native byte order
+    const std::uint16_t one = 1;
+    if (*reinterpret_cast<const unsigned char*>(&one) == 1) png_set_swap(png);
+  }
+
+  const bool to_gray = has_color && !want_color;
+  if (!has_color && want_color) png_set_gray_to_rgb(png);
+  if (has_alpha && !want_alpha && !to_gray) png_set_strip_alpha(png);
+  if (!has_alpha && want_alpha && !to_gray)
+    png_set_add_alpha(png, wide ? 0xFFFF : 0xFF, PNG_FILLER_AFTER);
+
+  const int passes = png_set_interlace_handling(png);
+  png_read_update_info(png, info);
+
+  const std::uint32_t height = png_get_image_height(png, info);
+  const std::uint32_t width = png_get_image_width(png, info);
+  const std::size_t row_bytes = png_get_rowbytes(png, info);
+  const int channels = png_get_channels(png, info);
+  sink.begin(height, width);
+  if (!to_gray && row_bytes != sink.row_bytes())
+    png_error(png, "Unexpected PNG row layout.");
+
+  // Interlaced images are read once per pass, with every pass adding its
+  // pixels to the rows already read, so they need all rows in scratch.
+  const std::size_t scratch_rows = passes > 1 ? height : 1;
+  if (to_gray) scratch.resize(scratch_rows * row_bytes);
+  auto to_sink = [&](std::uint32_t y, const unsigned char* row) {
+    if (wide) {
+      convert_row(reinterpret_cast<const std::uint16_t*>(row), channels,
+                  width, sink, sink.row(y));
+    } else {
+      convert_row(row, channels, width, sink, sink.row(y));
+    }
+  };
+
+  // Rows are only finished by the last pass of an interlaced image.
+  for (int pass = 0; pass < passes; pass++) {
+    const bool last = pass + 1 == passes;
+    for (std::uint32_t y = 0; y < height; y++) {
+      if (!to_gray) {
+        png_read_row(png, sink.row(y), nullptr);
+      } else {
+        unsigned char* row =
+            scratch.data() + (passes > 1 ? y : 0) * row_bytes;
+        png_read_row(png, row, nullptr);
+        if (last) to_sink(y, row);
+      }
+      if (last) sink.rows_ready(y, y + 1);
+    }
+  }
+
+  png_read_end(png, nullptr);
+  png_destroy_read_struct(&png, &info, nullptr);
+  return true;
+}
+
+class PngDecoder final : public ImageDecoder {
+ public:
+  const char* name() const override { return "libpng"; }
+
+  bool supports(ImageFormat format) const override {
+    return format == ImageFormat::PNG;
+  }
+
+  bool decode(const unsigned char* data, std::size_t size, DecodeSink& sink,
+              std::string& error) override {
+    PngSource src{data, size, 0, nullptr, {}};
+    std::vector<unsigned char> scratch;
+    return read_png(src, sink, scratch, error);
+  }
+
+  bool decode_stream(std::istream& stream, DecodeSink& sink,
+                     std::string& error) override {
+    PngSource src{nullptr, 0, 0, &stream, {}};
+    std::vector<unsigned char> scratch;
+    return read_png(src, sink, scratch, error);
+  }
+};
+#endif
+
+#ifdef IMAPP_USE_LIBWEBP
+class WebpDecoder final : public ImageDecoder {
+ public:
+  const char* name() const override { return "libwebp"; }
+
+  bool supports(ImageFormat format) const override {
+    return format == ImageFormat::WebP;
+  }
+
+  bool decode(const unsigned char* data, std::size_t size, DecodeSink& sink,
+              std::string& error) override {
+    int width = 0, height = 0;
+    if (!WebPGetInfo(data, size, &width, &height)) {
+      error = "Not a valid WebP file.";
+      return false;
+    }
+
+    const std::uint32_t h = static_cast<std::uint32_t>(height);
+    const std::uint32_t w = static_cast<std::uint32_t>(width);
+    sink.begin(h, w);
+    const bool rgb8 = sink.bit_depth() == 8 && sink.channels() >= 3;
+    if (rgb8 && h > 0) {
+      // Decode straight into the rows of the sink
+      const int stride = static_cast<int>(sink.stride());
+      const std::size_t bytes = sink.stride() * (h - 1) + sink.row_bytes();
+      const std::uint8_t* out =
+          sink.channels() == 4
+              ? WebPDecodeRGBAInto(data, size, sink.row(0), bytes, stride)
+              : WebPDecodeRGBInto(data, size, sink.row(0), bytes, stride);
+      if (out == nullptr) {
+        error = "Could not decode WebP file.";
+        return false;
+      }
+      sink.rows_ready(0, h);
+      return true;
+    }
+
+    std::vector<unsigned char> rgba(static_cast<std::size_t>(w) * h * 4);
+    if (WebPDecodeRGBAInto(data, size, rgba.data(), rgba.size(),
+                           static_cast<int>(w * 4)) == nullptr) {
+      error = "Could not decode WebP file.";
+      return false;
+    }
+    for (std::uint32_t y = 0; y < h; y++) {
+      convert_row<unsigned char>(
+          rgba.data() + static_cast<std::size_t>(y) * w * 4, 4, w, sink,
+          sink.row(y));
+    }
+    sink.rows_ready(0, h);
+    return true;
+  }
+};
+#endif
+}  // namespace
+
+CodecRegistry& CodecRegistry::global() {
+  static CodecRegistry registry;
+  return registry;
+}
+
+CodecRegistry::CodecRegistry() : mutex_(), decoders_() {
+#ifdef IMAPP_USE_LIBJPEG
+  decoders_.push_back(std::make_shared<JpegDecoder>());
+#endif
+#ifdef IMAPP_USE_LIBPNG
+  decoders_.push_back(std::make_shared<PngDecoder>());
+#endif
+#ifdef IMAPP_USE_LIBWEBP
+  decoders_.push_back(std::make_shared<WebpDecoder>());
+#endif
+  decoders_.push_back(std::make_shared<StbDecoder>());
+}
+
+void CodecRegistry::add(std::shared_ptr<ImageDecoder> decoder) {
+  if (!decoder) {
+    throw std::invalid_argument("ImApp::CodecRegistry::add: decoder is null.");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  decoders_.insert(decoders_.begin(), std::move(decoder));
+}
+
+bool CodecRegistry::remove(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = decoders_.begin(); it != decoders_.end(); it++) {
+    if (name == (*it)->name()) {
+      decoders_.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::shared_ptr<ImageDecoder> CodecRegistry::find(
+    const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& decoder : decoders_) {
+    if (name == decoder->name()) return decoder;
+  }
+  return nullptr;
+}
+
+std::vector<std::shared_ptr<ImageDecoder>> CodecRegistry::decoders() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return decoders_;
+}
+
+bool ImageDecoder::decode_stream(std::istream& stream, DecodeSink& sink,
+                                 std::string& error) {
+  const std::vector<char> data((std::istreambuf_iterator<char>(stream)),
+                               std::istreambuf_iterator<char>());
+  return this->decode(reinterpret_cast<const unsigned char*>(data.data()),
+                      data.size(), sink, error);
+}
+
+bool ImageDecoder::preview(std::istream&, DecodeSink&, std::uint32_t,
+                           std::string& error) {
+  error = "Previews are not supported.";
+  return false;
+}
+
+void CodecRegistry::decode(const unsigned char* data, std::size_t size,
+                           DecodeSink& sink) const {
+  // Decoding runs without the lock, so that images can be decoded on many
+  // threads at once.
+  const ImageFormat format = detect_format(data, size);
+  std::string mssg = "ImApp::CodecRegistry::decode: Could not decode image.";
+  bool tried = false;
+  for (const auto& decoder : this->decoders()) {
+    if (!decoder->supports(format)) continue;
+
+    tried = true;
+    std::string error;
+    if (decoder->decode(data, size, sink, error)) return;
+    mssg += "\n";
+    mssg += decoder->name();
+    mssg += ": " + error;
+  }
+
+  if (!tried) mssg += "\nNo decoder supports the format of the image.";
+  throw std::runtime_error(mssg);
+}
+
+namespace {
+// Detects the format from the start of a stream, leaving it where it was.
+ImageFormat detect_stream_format(std::istream& stream) {
+  const std::streampos start = stream.tellg();
+  unsigned char head[16];
+  stream.read(reinterpret_cast<char*>(head), sizeof(head));
+  const std::size_t n = static_cast<std::size_t>(stream.gcount());
+  stream.clear();
+  stream.seekg(start);
+  return detect_format(head, n);
+}
+}  // namespace
+
+void CodecRegistry::decode(std::istream& stream, DecodeSink& sink) const {
+  // Every decoder starts from the same place, so a failed attempt does not
+  // disturb the next one.
+  const std::streampos start = stream.tellg();
+  const ImageFormat format = detect_stream_format(stream);
+  std::string mssg = "ImApp::CodecRegistry::decode: Could not decode image.";
+  bool tried = false;
+  for (const auto& decoder : this->decoders()) {
+    if (!decoder->supports(format)) continue;
+
+    tried = true;
+    stream.clear();
+    stream.seekg(start);
+    std::string error;
+    if (decoder->decode_stream(stream, sink, error)) return;
+    mssg += "\n";
+    mssg += decoder->name();
+    mssg += ": " + error;
+  }
+
+  if (!tried) mssg += "\nNo decoder supports the format of the image.";
+  throw std::runtime_error(mssg);
+}
+
+bool CodecRegistry::preview(std::istream& stream, DecodeSink& sink,
+                            std::uint32_t max_size) const {
+  const std::streampos start = stream.tellg();
+  const ImageFormat format = detect_stream_format(stream);
+  bool done = false;
+  for (const auto& decoder : this->decoders()) {
+    if (!decoder->supports(format)) continue;
+
+    stream.clear();
+    stream.seekg(start);
+    std::string error;
+    if (decoder->preview(stream, sink, max_size, error)) {
+      done = true;
+      break;
+    }
+  }
+
+  stream.clear();
+  stream.seekg(start);
+  return done;
+}
+
+}  // namespace ImApp
@@ -0,0 +1,306 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <ImApp/draw_capture.hpp>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace ImApp {
+
+namespace {
+// File layout, all values in native byte order:
+//   header : magic[8], version, sizeof(ImDrawVert), sizeof(ImDrawIdx)
+//   frame  : display_pos[2], display_size[2], fb_scale[2], n_lists
+//   list   : n_cmds, n_vtx, n_idx, cmds[n_cmds], vtx[n_vtx], idx[n_idx]
+//   cmd    : clip_rect[4], texture, flags, vtx_offset, idx_offset, elem_count
+constexpr char capture_magic[8] = {'I', 'M', 'D', 'R', 'A', 'W', '0', '1'};
+constexpr std::uint32_t capture_version = 1;
+
+// Size of a command in the file.
+constexpr std::uint64_t cmd_bytes = 4 * sizeof(float) + sizeof(std::uint64_t) +
+                                    4 * sizeof(std::uint32_t);
+
+constexpr std::uint32_t cmd_font_texture = 1u << 0;
+constexpr std::uint32_t cmd_reset_render_state = 1u << 1;
+
+template <typename T>
+void write_value(std::ofstream& file, const T& value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::ifstream& file, T& value) {
+  file.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return static_cast<std::size_t>(file.gcount()) == sizeof(T);
+}
+
+void write_vec2(std::ofstream& file, const ImVec2& v) {
+  write_value(file, v.x);
+  write_value(file, v.y);
+}
+
+bool read_vec2(std::ifstream& file, ImVec2& v) {
+  return read_value(file, v.x) && read_value(file, v.y);
+}
+
+[[noreturn]] void truncated() {
+  throw std::runtime_error("ImApp::DrawDataReader: Truncated capture file.");
+}
+
+[[noreturn]] void corrupt() {
+  throw std::runtime_error("ImApp::DrawDataReader: Corrupt capture file.");
+}
+}  // namespace
+
+DrawDataWriter::DrawDataWriter(const std::filesystem::path& fname)
+    : file_(fname, std::ios::binary), frames_(0) {
+  if (!file_) {
+    std::string mssg = "ImApp::DrawDataWriter: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  file_.write(capture_magic, sizeof(capture_magic));
+  write_value(file_, capture_version);
+  write_value(file_, static_cast<std::uint32_t>(sizeof(ImDrawVert)));
+  write_value(file_, static_cast<std::uint32_t>(sizeof(ImDrawIdx)));
+}
+
+void DrawDataWriter::write(const ImDrawData& draw_data,
+                           ImTextureID font_texture) {
+  write_vec2(file_, draw_data.DisplayPos);
+  write_vec2(file_, draw_data.DisplaySize);
+  write_vec2(file_, draw_data.FramebufferScale);
+  write_value(file_, static_cast<std::uint32_t>(draw_data.CmdListsCount));
+
+  std::vector<const ImDrawCmd*> cmds;
+  for (int l = 0; l < draw_data.CmdListsCount; l++) {
+    const ImDrawList* list = draw_data.CmdLists[l];
+
+    cmds.clear();
+    for (const ImDrawCmd& cmd : list->CmdBuffer) {
+      if (cmd.UserCallback != nullptr &&
+          cmd.UserCallback != ImDrawCallback_ResetRenderState)
+        continue;
+      cmds.push_back(&cmd);
+    }
+
+    write_value(file_, static_cast<std::uint32_t>(cmds.size()));
+    write_value(file_, static_cast<std::uint32_t>(list->VtxBuffer.Size));
+    write_value(file_, static_cast<std::uint32_t>(list->IdxBuffer.Size));
+
+    for (const ImDrawCmd* cmd : cmds) {
+      std::uint32_t flags = 0;
+      if (cmd->TextureId == font_texture) flags |= cmd_font_texture;
+      if (cmd->UserCallback == ImDrawCallback_ResetRenderState)
+        flags |= cmd_reset_render_state;
+
+      write_value(file_, cmd->ClipRect.x);
+      write_value(file_, cmd->ClipRect.y);
+      write_value(file_, cmd->ClipRect.z);
+      write_value(file_, cmd->ClipRect.w);
+      write_value(file_, static_cast<std::uint64_t>(
+                             reinterpret_cast<std::uintptr_t>(cmd->TextureId)));
+      write_value(file_, flags);
+      write_value(file_, static_cast<std::uint32_t>(cmd->VtxOffset));
+      write_value(file_, static_cast<std::uint32_t>(cmd->IdxOffset));
+      write_value(file_, static_cast<std::uint32_t>(cmd->ElemCount));
+    }
+
+    file_.write(reinterpret_cast<const char*>(list->VtxBuffer.Data),
+                static_cast<std::streamsize>(list->VtxBuffer.size_in_bytes()));
+    file_.write(reinterpret_cast<const char*>(list->IdxBuffer.Data),
+                static_cast<std::streamsize>(list->IdxBuffer.size_in_bytes()));
+  }
+
+  if (!file_) {
+    throw std::runtime_error("ImApp::DrawDataWriter: Could not write frame.");
+  }
+  frames_++;
+}
+
+void CapturedFrame::remap_textures(
+    const std::function<ImTextureID(std::uint64_t, bool)>& map) {
+  for (auto& ref : textures_) ref.cmd->TextureId = map(ref.id, ref.is_font);
+}
+
+DrawDataReader::DrawDataReader(const std::filesystem::path& fname)
+    : file_(fname, std::ios::binary), size_(0) {
+  if (!file_) {
+    std::string mssg = "ImApp::DrawDataReader: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  // Every count in the file is checked against the size of the file, before
+  // anything is allocated for it.
+  file_.seekg(0, std::ios::end);
+  size_ = static_cast<std::uint64_t>(file_.tellg());
+  file_.seekg(0, std::ios::beg);
+
+  char magic[sizeof(capture_magic)];
+  file_.read(magic, sizeof(magic));
+  if (!file_ || std::memcmp(magic, capture_magic, sizeof(magic)) != 0) {
+    std::string mssg = "ImApp::DrawDataReader: File \"";
+    mssg += fname.string() + "\" is not a draw data capture.";
+    throw std::runtime_error(mssg);
+  }
+
+  std::uint32_t version, vtx_size, idx_size;
+  if (!read_value(file_, version) || !read_value(file_, vtx_size) ||
+      !read_value(file_, idx_size))
+    truncated();
+
+  if (version != capture_version) {
+    throw std::runtime_error(
+        "ImApp::DrawDataReader: Unsupported capture version.");
+  }
+
+  if (vtx_size != sizeof(ImDrawVert) || idx_size != sizeof(ImDrawIdx)) {
+    throw std::runtime_error(
+        "ImApp::DrawDataReader: Capture was made with a different ImDrawVert "
+        "or ImDrawIdx layout.");
+  }
+}
+
+std::uint64_t DrawDataReader::remaining() {
+  const std::streamoff pos = file_.tellg();
+  if (pos < 0 || static_cast<std::uint64_t>(pos) > size_) return 0;
+  return size_ - static_cast<std::uint64_t>(pos);
+}
+
+bool DrawDataReader::read(CapturedFrame& frame) {
+  ImVec2 display_pos;
+  if (!read_vec2(file_, display_pos)) return false;
+
+  ImDrawData& dd = frame.draw_data_;
+  dd.Clear();
+  frame.lists_.clear();
+  frame.textures_.clear();
+
+  dd.DisplayPos = display_pos;
+  std::uint32_t n_lists;
+  if (!read_vec2(file_, dd.DisplaySize) ||
+      !read_vec2(file_, dd.FramebufferScale) || !read_value(file_, n_lists))
+    truncated();
+  if (n_lists > remaining() / (3 * sizeof(std::uint32_t))) truncated();
+
+  for (std::uint32_t l = 0; l < n_lists; l++) {
+    std::uint32_t n_cmds, n_vtx, n_idx;
+    if (!read_value(file_, n_cmds) || !read_value(file_, n_vtx) ||
+        !read_value(file_, n_idx))
+      truncated();
+
+    // The counts are used to size the buffers, so they must be backed by
+    // data in the file, and fit in an ImVector.
+    constexpr std::uint32_t max_count = std::numeric_limits<int>::max();
+    if (n_cmds > max_count || n_vtx > max_count || n_idx > max_count)
+      corrupt();
+    const std::uint64_t list_bytes = n_cmds * cmd_bytes +
+                                     std::uint64_t(n_vtx) * sizeof(ImDrawVert) +
+                                     std::uint64_t(n_idx) * sizeof(ImDrawIdx);
+    if (list_bytes > remaining()) truncated();
+
+    // The lists are never drawn into, so they need no shared data.
+    auto list = std::make_unique<ImDrawList>(nullptr);
+    list->CmdBuffer.resize(static_cast<int>(n_cmds));
+    list->VtxBuffer.resize(static_cast<int>(n_vtx));
+    list->IdxBuffer.resize(static_cast<int>(n_idx));
+
+    for (ImDrawCmd& cmd : list->CmdBuffer) {
+      std::uint64_t texture;
+      std::uint32_t flags, vtx_offset, idx_offset, elem_count;
+      if (!read_value(file_, cmd.ClipRect.x) ||
+          !read_value(file_, cmd.ClipRect.y) ||
+          !read_value(file_, cmd.ClipRect.z) ||
+          !read_value(file_, cmd.ClipRect.w) ||
+          !read_value(file_, texture) || !read_value(file_, flags) ||
+          !read_value(file_, vtx_offset) || !read_value(file_, idx_offset) ||
+          !read_value(file_, elem_count))
+        truncated();
+
+      // Every command must only draw indices of its own list.
+      if (std::uint64_t(idx_offset) + elem_count > n_idx ||
+          (elem_count > 0 && vtx_offset >= n_vtx))
+        corrupt();
+
+      cmd.TextureId = reinterpret_cast<ImTextureID>(
+          static_cast<std::uintptr_t>(texture));
+      cmd.VtxOffset = vtx_offset;
+      cmd.IdxOffset = idx_offset;
+      cmd.ElemCount = elem_count;
+      cmd.UserCallback = (flags & cmd_reset_render_state)
+                             ? ImDrawCallback_ResetRenderState
+                             : nullptr;
+      cmd.UserCallbackData = nullptr;
+
+      frame.textures_.push_back(
+          {&cmd, texture, (flags & cmd_font_texture) != 0});
+    }
+
+    file_.read(reinterpret_cast<char*>(list->VtxBuffer.Data),
+               static_cast<std::streamsize>(list->VtxBuffer.size_in_bytes()));
+    file_.read(reinterpret_cast<char*>(list->IdxBuffer.Data),
+               static_cast<std::streamsize>(list->IdxBuffer.size_in_bytes()));
+    if (!file_) truncated();
+
+    // Indices are relative to the vertex offset of their command, and must
+    // refer to a vertex of the list.
+    for (const ImDrawCmd& cmd : list->CmdBuffer) {
+      for (unsigned int i = 0; i < cmd.ElemCount; i++) {
+        const std::uint64_t vtx =
+            std::uint64_t(cmd.VtxOffset) + list->IdxBuffer[cmd.IdxOffset + i];
+        if (vtx >= n_vtx) corrupt();
+      }
+    }
+
+    dd.CmdLists.push_back(list.get());
+    dd.TotalVtxCount += list->VtxBuffer.Size;
+    dd.TotalIdxCount += list->IdxBuffer.Size;
+    frame.lists_.push_back(std::move(list));
+  }
+
+  dd.CmdListsCount = dd.CmdLists.Size;
+  dd.Valid = true;
+  return true;
+}
+
+std::vector<CapturedFrame> DrawDataReader::read_all() {
+  std::vector<CapturedFrame> frames;
+  CapturedFrame frame;
+  while (this->read(frame)) frames.push_back(std::move(frame));
+  return frames;
+}
+
+}  // namespace ImApp
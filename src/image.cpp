@@ -0,0 +1,469 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+
+#include <GLFW/glfw3.h>
+
+#include <ImApp/codec.hpp>
+#include <ImApp/image.hpp>
+#include <ImApp/residency.hpp>
+#include <ImApp/texture_pool.hpp>
+#include <ImApp/texture_uploader.hpp>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+// If we found Zlib when running CMake, we define IMAPP_USE_ZLIB, to indicate
+// that we should use Zlib to perform compression for PNG images, instead of
+// the built-in stb compressor function. This should lead to much smaller
+// image sizes, and Zlib is available on most systems.
+#ifdef IMAPP_USE_ZLIB
+#include <zlib.h>
+unsigned char* zlib_compression_for_stbiw(unsigned char* data, int data_len,
+                                          int* out_len, int quality) {
+  uLongf bufSize = compressBound(data_len);
+  // note that buf will be free'd by stb_image_write.h
+  // with STBIW_FREE() (plain free() by default)
+  unsigned char* buf = reinterpret_cast<unsigned char*>(std::malloc(bufSize));
+  if (buf == NULL) return NULL;
+  if (compress2(buf, &bufSize, data, data_len, quality) != Z_OK) {
+    std::free(buf);
+    return NULL;
+  }
+  *out_len = bufSize;
+
+  return buf;
+}
+#define STBIW_ZLIB_COMPRESS zlib_compression_for_stbiw
+#endif
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+// The GL headers on some platforms only go up to OpenGL 1.1, so we define the
+// few newer constants which are needed for the texture formats.
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_R16
+#define GL_R16 0x822A
+#endif
+#ifndef GL_RG8
+#define GL_RG8 0x822B
+#endif
+#ifndef GL_R32F
+#define GL_R32F 0x822E
+#endif
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+
+namespace ImApp {
+
+namespace {
+struct GLFormat {
+  GLint internal_format;
+  GLenum format;
+  GLenum type;
+};
+
+template <typename P>
+constexpr GLFormat gl_format() {
+  constexpr PixelFormat format = PixelTraits<P>::format;
+  if constexpr (format == PixelFormat::R8) {
+    return {GL_R8, GL_RED, GL_UNSIGNED_BYTE};
+  } else if constexpr (format == PixelFormat::R16) {
+    return {GL_R16, GL_RED, GL_UNSIGNED_SHORT};
+  } else if constexpr (format == PixelFormat::R32F) {
+    return {GL_R32F, GL_RED, GL_FLOAT};
+  } else if constexpr (format == PixelFormat::RG8) {
+    return {GL_RG8, GL_RG, GL_UNSIGNED_BYTE};
+  } else if constexpr (format == PixelFormat::RGB8) {
+    return {GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE};
+  } else if constexpr (format == PixelFormat::RGBA8) {
+    return {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE};
+  } else {
+    return {GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT};
+  }
+}
+
+// Single channel textures are sampled as (r,0,0,1), so they are displayed in
+// gray with a texture swizzle. This needs OpenGL 3.3, or an extension.
+bool swizzle_supported() {
+  static const bool supported = [] {
+    int major = 0, minor = 0;
+    const char* version =
+        reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version && std::sscanf(version, "%d.%d", &major, &minor) == 2 &&
+        (major > 3 || (major == 3 && minor >= 3)))
+      return true;
+
+    return glfwExtensionSupported("GL_ARB_texture_swizzle") == GLFW_TRUE ||
+           glfwExtensionSupported("GL_EXT_texture_swizzle") == GLFW_TRUE;
+  }();
+  return supported;
+}
+
+// Pixel types which stb can read and write directly, with 8 bits per channel.
+template <typename P>
+constexpr bool is_8bit() {
+  return std::is_same_v<P, PixelR8> || std::is_same_v<P, PixelRG8> ||
+         std::is_same_v<P, PixelRGB8> || std::is_same_v<P, Pixel>;
+}
+
+// The 8-bit pixel type with the same number of channels as P.
+template <typename P>
+using Pixel8 = std::conditional_t<
+    PixelTraits<P>::channels == 1, PixelR8,
+    std::conditional_t<PixelTraits<P>::channels == 2, PixelRG8,
+                       std::conditional_t<PixelTraits<P>::channels == 3,
+                                          PixelRGB8, Pixel>>>;
+
+static_assert(sizeof(PixelR8) == 1 && sizeof(PixelRG8) == 2 &&
+                  sizeof(PixelRGB8) == 3 && sizeof(Pixel) == 4 &&
+                  sizeof(PixelR16) == 2 && sizeof(PixelRGBA16F) == 8,
+              "Pixel types must be tightly packed.");
+
+void check_exists(const std::filesystem::path& fname) {
+  if (std::filesystem::exists(fname) == false) {
+    std::string mssg = "ImApp::Image::from_file: File with name \"";
+    mssg += fname.string() + "\" does not exist.\n";
+    throw std::runtime_error(mssg);
+  }
+}
+}  // namespace
+
+template <typename P>
+BasicImage<P> BasicImage<P>::from_file(const std::filesystem::path& fname,
+                                       const ImageOptions& options) {
+  // Make sure file exists
+  check_exists(fname);
+
+  if constexpr (is_8bit<P>() || std::is_same_v<P, PixelR16>) {
+    std::ifstream file(fname, std::ios::binary);
+    if (!file) {
+      std::string mssg = "ImApp::Image::from_file: Could not open file \"";
+      mssg += fname.string() + "\".";
+      throw std::runtime_error(mssg);
+    }
+
+    // The file is decoded while it is read, so it never has to be in memory
+    // as a whole.
+    ImageDecodeSink<P> sink(options);
+    try {
+      CodecRegistry::global().decode(file, sink);
+    } catch (const std::runtime_error& err) {
+      std::string mssg = "ImApp::Image::from_file: Could not load \"";
+      mssg += fname.string() + "\".\n";
+      mssg += err.what();
+      throw std::runtime_error(mssg);
+    }
+    return sink.take();
+  } else {
+    // Float images are loaded as RGBA, and then converted.
+    return convert<P>(Image::from_file(fname), options);
+  }
+}
+
+template <typename P>
+BasicImage<P> BasicImage<P>::from_memory(const unsigned char* data,
+                                         std::size_t size,
+                                         const ImageOptions& options) {
+  if constexpr (is_8bit<P>() || std::is_same_v<P, PixelR16>) {
+    // The decoders convert the channels for us, and write straight into the
+    // rows of the image.
+    ImageDecodeSink<P> sink(options);
+    CodecRegistry::global().decode(data, size, sink);
+    return sink.take();
+  } else {
+    // Float images are loaded as RGBA, and then converted.
+    return convert<P>(Image::from_memory(data, size), options);
+  }
+}
+
+template <typename P>
+bool BasicImage<P>::save_png(const std::filesystem::path& fname) const {
+  return detail::write_png<P>(this->view(), fname);
+}
+
+template <typename P>
+bool BasicImage<P>::save_jpg(const std::filesystem::path& fname) const {
+  return detail::write_jpg<P>(this->view(), fname);
+}
+
+namespace {
+// Internal format of the texture which holds an image. Without swizzles, a
+// single channel would be displayed in red, so we fall back to storing the
+// image as RGBA.
+template <typename P>
+GLint texture_format() {
+  if (PixelTraits<P>::channels == 1 && !swizzle_supported()) {
+    return gl_format<Pixel>().internal_format;
+  }
+  return gl_format<P>().internal_format;
+}
+
+// Uploads a view into a rectangle of the bound texture. The rows are read in
+// place using GL_UNPACK_ROW_LENGTH, so sub-images are never copied.
+template <typename P>
+void upload_view(BasicImageView<const P> src, std::uint32_t y,
+                 std::uint32_t x) {
+  if (src.empty()) return;
+
+  GLFormat fmt = gl_format<P>();
+  const void* pixels = src.data();
+  std::size_t row_length = src.stride();
+
+  std::optional<Image> rgba;
+  if constexpr (PixelTraits<P>::channels == 1) {
+    if (!swizzle_supported()) {
+      rgba.emplace(convert<Pixel>(src));
+      fmt = gl_format<Pixel>();
+      pixels = rgba->data();
+      row_length = rgba->width();
+    }
+  }
+
+#if !defined(GL_UNPACK_ROW_LENGTH) || defined(__EMSCRIPTEN__)
+  // Without a row length, the rows must be packed together first.
+  std::vector<P> packed;
+  if (row_length != src.width()) {
+    packed.resize(static_cast<std::size_t>(src.height()) * src.width());
+    for (std::uint32_t h = 0; h < src.height(); h++) {
+      std::copy(src.row(h), src.row(h) + src.width(),
+                packed.data() + static_cast<std::size_t>(h) * src.width());
+    }
+    pixels = packed.data();
+  }
+#endif
+
+  // Rows of 1, 2, and 3 byte pixels are not always 4 byte aligned.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+#if defined(GL_UNPACK_ROW_LENGTH) && !defined(__EMSCRIPTEN__)
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(row_length));
+#endif
+  glTexSubImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(x),
+                  static_cast<GLint>(y), static_cast<GLsizei>(src.width()),
+                  static_cast<GLsizei>(src.height()), fmt.format, fmt.type,
+                  pixels);
+#if defined(GL_UNPACK_ROW_LENGTH) && !defined(__EMSCRIPTEN__)
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+}  // namespace
+
+template <typename P>
+void BasicImage<P>::send_to_gpu() {
+  this->send_to_gpu(0, 0, height_, width_);
+}
+
+template <typename P>
+void BasicImage<P>::send_to_gpu(std::uint32_t y, std::uint32_t x,
+                                std::uint32_t height, std::uint32_t width) {
+  const BasicImage& self = *this;
+  const_view_type region = self.view(y, x, height, width);
+
+  if (texture_ && texture_.height() == height_ && texture_.width() == width_) {
+    // Texture already exists on GPU. We just need to update it.
+    glBindTexture(GL_TEXTURE_2D, texture_.id());
+  } else {
+    // A new or resized texture needs storage of the new size, and all of its
+    // pixels. The storage may be immutable, so the old texture is given back
+    // to the pool, and one of the right size is taken from it.
+    const GLint internal_format = texture_format<P>();
+    TexturePool& pool = TexturePool::global();
+    pool.recycle(std::move(texture_), internal_format);
+    texture_ = pool.acquire(height_, width_, internal_format);
+    ResidencyManager::global().track(
+        texture_,
+        TexturePool::texture_bytes(height_, width_, internal_format));
+    region = self.view();
+    y = 0;
+    x = 0;
+  }
+
+  // Upload pixels into texture
+  upload_view<P>(region, y, x);
+}
+
+template <typename P>
+void BasicImage<P>::set_texture(Texture texture) {
+  this->delete_from_gpu();
+  texture_ = std::move(texture);
+  if (texture_) {
+    ResidencyManager::global().track(
+        texture_, TexturePool::texture_bytes(texture_.height(),
+                                             texture_.width(),
+                                             texture_format<P>()));
+  }
+}
+
+template <typename P>
+void BasicImage<P>::delete_from_gpu() {
+  // Images without a texture may be destroyed on threads without an OpenGL
+  // context, where the texture format can't be decided.
+  if (!texture_) return;
+  TexturePool::global().recycle(std::move(texture_), texture_format<P>());
+}
+
+namespace detail {
+bool texture_swizzle_supported() { return swizzle_supported(); }
+
+template <typename P>
+UploadSource upload_source(const BasicImage<P>& image) {
+  GLFormat fmt = gl_format<P>();
+
+  // Without swizzles, single channel images are uploaded as RGBA.
+  if constexpr (PixelTraits<P>::channels == 1) {
+    if (!swizzle_supported()) return upload_source(convert<Pixel>(image));
+  }
+
+  // The source keeps the pixels of the image alive, without copying them.
+  UploadSource src;
+  src.pixels = reinterpret_cast<const unsigned char*>(image.data());
+  src.height = image.height();
+  src.width = image.width();
+  src.row_bytes = static_cast<std::size_t>(image.width()) * sizeof(P);
+  src.stride_bytes = static_cast<std::size_t>(image.stride()) * sizeof(P);
+  src.internal_format = fmt.internal_format;
+  src.format = fmt.format;
+  src.type = fmt.type;
+  src.gray = fmt.format == GL_RED;
+  src.keep_alive = image.image_;
+  return src;
+}
+
+template <typename P>
+Image colormap(BasicImageView<const P> src, float min, float max,
+               ImPlotColormap cmap) {
+  // Sampling ImPlot for every pixel would be slow, so we build a table.
+  constexpr int LUT_SIZE = 256;
+  std::array<Pixel, LUT_SIZE> lut;
+  for (int i = 0; i < LUT_SIZE; i++) {
+    const ImVec4 c =
+        ImPlot::SampleColormap(static_cast<float>(i) / (LUT_SIZE - 1), cmap);
+    lut[i] = PixelTraits<Pixel>::from_rgba({c.x, c.y, c.z, c.w});
+  }
+
+  const float scale = max != min ? (LUT_SIZE - 1) / (max - min) : 0.f;
+  ImageOptions options;
+  options.initialize = false;
+  Image dst(src.height(), src.width(), options);
+  for (std::uint32_t h = 0; h < src.height(); h++) {
+    const P* in = src.row(h);
+    Pixel* out = &dst(h, 0);
+    for (std::uint32_t w = 0; w < src.width(); w++) {
+      const std::array<float, 4> c = PixelTraits<P>::to_rgba(in[w]);
+      const float value =
+          PixelTraits<P>::channels <= 2 ? c[0] : detail::luma(c);
+      const float t = std::clamp((value - min) * scale, 0.f, LUT_SIZE - 1.f);
+      out[w] = lut[static_cast<std::size_t>(t + 0.5f)];
+    }
+  }
+
+  return dst;
+}
+
+template <typename P>
+bool write_png(BasicImageView<const P> src,
+               const std::filesystem::path& fname) {
+  if constexpr (is_8bit<P>()) {
+    // stb takes a row stride, so views are written in place.
+    const unsigned char* data =
+        reinterpret_cast<const unsigned char*>(src.data());
+    const int width = static_cast<int>(src.width());
+    const int height = static_cast<int>(src.height());
+    const int channels = PixelTraits<P>::channels;
+    const int stride = static_cast<int>(src.stride() * sizeof(P));
+    const std::string fname_str = fname.string();
+    const int err =
+        stbi_write_png(fname_str.data(), width, height, channels, data, stride);
+    return err != 0;
+  } else {
+    return convert<Pixel8<P>>(src).save_png(fname);
+  }
+}
+
+template <typename P>
+bool write_jpg(BasicImageView<const P> src,
+               const std::filesystem::path& fname) {
+  if constexpr (is_8bit<P>()) {
+    // The JPG writer has no row stride, so the rows must be contiguous.
+    if (src.contiguous() == false) return BasicImage<P>(src).save_jpg(fname);
+
+    const unsigned char* data =
+        reinterpret_cast<const unsigned char*>(src.data());
+    const int width = static_cast<int>(src.width());
+    const int height = static_cast<int>(src.height());
+    const int channels = PixelTraits<P>::channels;
+    const std::string fname_str = fname.string();
+    const int err =
+        stbi_write_jpg(fname_str.data(), width, height, channels, data, 100);
+    return err != 0;
+  } else {
+    return convert<Pixel8<P>>(src).save_jpg(fname);
+  }
+}
+}  // namespace detail
+
+#define IMAPP_INSTANTIATE_IMAGE(P)                                        \
+  template class BasicImage<P>;                                           \
+  template detail::UploadSource detail::upload_source(                    \
+      const BasicImage<P>&);                                              \
+  template Image detail::colormap(BasicImageView<const P>, float, float,  \
+                                  ImPlotColormap);                        \
+  template bool detail::write_png(BasicImageView<const P>,                \
+                                  const std::filesystem::path&);          \
+  template bool detail::write_jpg(BasicImageView<const P>,                \
+                                  const std::filesystem::path&);
+
+IMAPP_INSTANTIATE_IMAGE(PixelR8)
+IMAPP_INSTANTIATE_IMAGE(PixelR16)
+IMAPP_INSTANTIATE_IMAGE(PixelR32F)
+IMAPP_INSTANTIATE_IMAGE(PixelRG8)
+IMAPP_INSTANTIATE_IMAGE(PixelRGB8)
+IMAPP_INSTANTIATE_IMAGE(Pixel)
+IMAPP_INSTANTIATE_IMAGE(PixelRGBA16F)
+
+#undef IMAPP_INSTANTIATE_IMAGE
+
+}  // namespace ImApp
@@ -33,57 +33,27 @@
 
 #include <GLFW/glfw3.h>
 
+#include <ImApp/draw_capture.hpp>
 #include <ImApp/imapp.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
 #include <filesystem>
+#include <future>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "fa6.cpp"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
+#include "input_recording.hpp"
 #include "roboto.cpp"
 
-#define STBI_NO_BMP
-#define STBI_NO_PSD
-#define STBI_NO_TGA
-#define STBI_NO_GIF
-#define STBI_NO_HDR
-#define STBI_NO_PIC
-#define STBI_NO_PNM
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
-// If we found Zlib when running CMake, we define IMAPP_USE_ZLIB, to indicate
-// that we should use Zlib to perform compression for PNG images, instead of
-// the built-in stb compressor function. This should lead to much smaller
-// image sizes, and Zlib is available on most systems.
-#ifdef IMAPP_USE_ZLIB
-#include <zlib.h>
-unsigned char* zlib_compression_for_stbiw(unsigned char* data, int data_len,
-                                          int* out_len, int quality) {
-  uLongf bufSize = compressBound(data_len);
-  // note that buf will be free'd by stb_image_write.h
-  // with STBIW_FREE() (plain free() by default)
-  unsigned char* buf = reinterpret_cast<unsigned char*>(std::malloc(bufSize));
-  if (buf == NULL) return NULL;
-  if (compress2(buf, &bufSize, data, data_len, quality) != Z_OK) {
-    std::free(buf);
-    return NULL;
-  }
-  *out_len = bufSize;
-
-  return buf;
-}
-#define STBIW_ZLIB_COMPRESS zlib_compression_for_stbiw
-#endif
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-
 // [Win32] Our example includes a copy of glfw3.lib pre-compiled with VS2010 to
 // maximize ease of testing and compatibility with old VS compilers. To link
 // with VS2010-era libraries, VS2015+ requires linking with
@@ -101,6 +71,67 @@ static void glfw_error_callback(int error, const char* description) {
 
 static const ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
+// Sleeps until the requested time. The OS may oversleep by a millisecond or
+// more, so we only sleep until shortly before the deadline, and then spin for
+// the remainder.
+static void sleep_until_precise(std::chrono::steady_clock::time_point t) {
+  using Clock = std::chrono::steady_clock;
+  constexpr auto SPIN_TIME = std::chrono::microseconds(1500);
+
+  if (t - Clock::now() > SPIN_TIME) {
+    std::this_thread::sleep_until(t - SPIN_TIME);
+  }
+  while (Clock::now() < t) std::this_thread::yield();
+}
+
+// Updates an exponential moving average.
+static double ema(double avg, double value, std::uint64_t n) {
+  constexpr double ALPHA = 0.1;
+  return n == 0 ? value : avg + ALPHA * (value - avg);
+}
+
+// Adds the Roboto and FontAwesome fonts to an atlas, and builds it. Every
+// allocation made by ImGui is recorded in the current context, so this may
+// only run on a worker thread while no context exists.
+static void load_fonts(ImFontAtlas* atlas, float dpi_scale) {
+  // TODO should determine these based on DPI
+  constexpr float FONT_SIZE = 18.;
+  constexpr float ICON_FONT_SIZE = 16.;
+
+  // Load Roboto font
+  atlas->AddFontFromMemoryCompressedTTF(RobotoRegular_compressed_data,
+                                        RobotoRegular_compressed_size,
+                                        FONT_SIZE * dpi_scale);
+
+  // Merge icons from FontAwesome Solid
+  static const ImWchar fa_icons_ranges[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
+  ImFontConfig fa_icons_config;
+  fa_icons_config.MergeMode = true;
+  fa_icons_config.PixelSnapH = true;
+  fa_icons_config.GlyphMinAdvanceX =
+      ICON_FONT_SIZE;  // Make the icon monospaced
+  atlas->AddFontFromMemoryCompressedTTF(
+      FASolid_compressed_data, FASolid_compressed_size, ICON_FONT_SIZE,
+      &fa_icons_config, fa_icons_ranges);
+
+  // Merge icons from FontAwesome Brands
+  static const ImWchar fab_icons_ranges[] = {ICON_MIN_FAB, ICON_MAX_16_FAB, 0};
+  ImFontConfig fab_icons_config;
+  fab_icons_config.MergeMode = true;
+  fab_icons_config.PixelSnapH = true;
+  fab_icons_config.GlyphMinAdvanceX =
+      ICON_FONT_SIZE;  // Make the icon monospaced
+  atlas->AddFontFromMemoryCompressedTTF(
+      FABrands_compressed_data, FABrands_compressed_size,
+      ICON_FONT_SIZE * dpi_scale, &fab_icons_config, fab_icons_ranges);
+
+  // Build the atlas and convert it to RGBA here, so that the renderer backend
+  // only has to upload it.
+  unsigned char* pixels = nullptr;
+  int width = 0, height = 0;
+  atlas->GetTexDataAsRGBA32(&pixels, &width, &height);
+}
+
 namespace ImApp {
 
 App::App(int w, int h, const char* name)
@@ -108,10 +139,64 @@ App::App(int w, int h, const char* name)
       io_(nullptr),
       style_(nullptr),
       layers_(),
+      layer_changes_(),
+      updating_(),
+      running_(false),
+      jobs_(std::make_unique<JobSystem>()),
+      uploader_(nullptr),
+      commands_(),
+      main_thread_(std::this_thread::get_id()),
+      main_thread_budget_ms_(2.),
+      update_mode_(UpdateMode::MainThread),
+      update_rate_(0.),
+      update_accumulator_(0.),
+      max_updates_per_frame_(8),
+      last_update_time_(std::nullopt),
+      background_update_(),
+      background_pending_(false),
+      pacing_(FramePacing::VSync),
+      target_fps_(0.),
+      next_frame_(),
+      last_swap_(),
+      frame_stats_(),
+      startup_begin_(std::chrono::steady_clock::now()),
+      startup_phases_(),
+      first_frame_time_(),
+      fonts_(std::make_unique<ImFontAtlas>()),
+      first_frame_(true),
+      capture_(nullptr),
+      capture_frames_(0),
+      input_recorder_(nullptr),
+      input_record_begin_(0.),
+      input_player_(nullptr),
+      input_timing_fname_(),
+      close_after_playback_(false),
       dpi_scale_(1.0f) {
+  auto phase_begin = startup_begin_;
+
   // Setup window
   glfwSetErrorCallback(glfw_error_callback);
   if (!glfwInit()) std::exit(1);
+  this->end_startup_phase("glfw_init", phase_begin);
+
+  // The window is not needed for the DPI scale, as it is placed on the
+  // primary monitor.
+  this->update_dpi_scale();
+
+  // Decompressing the fonts and rasterizing the atlas is the most expensive
+  // part of startup, so it is done in the background while the window is
+  // created. The atlas is built into our own ImFontAtlas, as the ImGui context
+  // must not exist until it is done.
+  ImFontAtlas* atlas = fonts_.get();
+  const float dpi_scale = dpi_scale_;
+  double fonts_build_ms = 0.;
+  JobHandle fonts_ready = jobs_->submit([atlas, dpi_scale, &fonts_build_ms] {
+    const auto begin = std::chrono::steady_clock::now();
+    load_fonts(atlas, dpi_scale);
+    const std::chrono::duration<double, std::milli> time =
+        std::chrono::steady_clock::now() - begin;
+    fonts_build_ms = time.count();
+  });
 
     // Decide GL+GLSL versions
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -142,52 +227,37 @@ App::App(int w, int h, const char* name)
   glfwMakeContextCurrent(window);
   glfwSwapInterval(1);  // Enable vsync
 
-  // Now we should be able to get the DPI scale
-  this->update_dpi_scale();
+  // Present a cleared frame right away, so that the window does not sit
+  // empty while the rest of the application is initialized.
+  glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w,
+               clear_color.z * clear_color.w, clear_color.w);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glfwSwapBuffers(window);
+  this->end_startup_phase("window", phase_begin);
+
+  // Wake up the main loop whenever a job hands work back to the main thread.
+  jobs_->set_main_wakeup([] { glfwPostEmptyEvent(); });
+
+  // The font atlas must be finished before the ImGui context is created, and
+  // is shared with the context, which does not take ownership of it.
+  jobs_->wait(fonts_ready);
+  this->end_startup_phase("font_wait", phase_begin);
+  startup_phases_.push_back({"fonts (background)", fonts_build_ms});
 
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
+  ImGui::CreateContext(fonts_.get());
   ImPlot::CreateContext();
   style_ = &(ImGui::GetStyle());
   io_ = &(ImGui::GetIO());
 
   // Enable Keyboard Controls
   this->enable_keyboard();
-
-  // TODO should determine these based on DPI
-  constexpr float FONT_SIZE = 18.;
-  constexpr float ICON_FONT_SIZE = 16.;
-
-  // Load Roboto font
-  io_->Fonts->AddFontFromMemoryCompressedTTF(RobotoRegular_compressed_data,
-                                             RobotoRegular_compressed_size,
-                                             FONT_SIZE * dpi_scale_);
-
-  // Merge icons from FontAwesome Solid
-  static const ImWchar fa_icons_ranges[] = {ICON_MIN_FA, ICON_MAX_16_FA, 0};
-  ImFontConfig fa_icons_config;
-  fa_icons_config.MergeMode = true;
-  fa_icons_config.PixelSnapH = true;
-  fa_icons_config.GlyphMinAdvanceX =
-      ICON_FONT_SIZE;  // Make the icon monospaced
-  io_->Fonts->AddFontFromMemoryCompressedTTF(
-      FASolid_compressed_data, FASolid_compressed_size, ICON_FONT_SIZE,
-      &fa_icons_config, fa_icons_ranges);
-
-  // Merge icons from FontAwesome Brands
-  static const ImWchar fab_icons_ranges[] = {ICON_MIN_FAB, ICON_MAX_16_FAB, 0};
-  ImFontConfig fab_icons_config;
-  fab_icons_config.MergeMode = true;
-  fab_icons_config.PixelSnapH = true;
-  fab_icons_config.GlyphMinAdvanceX =
-      ICON_FONT_SIZE;  // Make the icon monospaced
-  io_->Fonts->AddFontFromMemoryCompressedTTF(
-      FABrands_compressed_data, FABrands_compressed_size,
-      ICON_FONT_SIZE * dpi_scale_, &fab_icons_config, fab_icons_ranges);
+  this->end_startup_phase("imgui_context", phase_begin);
 
   // Setup style
   this->set_default_style();
+  this->end_startup_phase("style", phase_begin);
 
   // We enable docking and viewports here temporarily, so the functionality
   // loaded in ImGui_ImplGlfw_InitForOpenGL.
@@ -201,12 +271,54 @@ App::App(int w, int h, const char* name)
   // We can now disable docking and viewports by default here
   io_->ConfigFlags &= ~(ImGuiConfigFlags_DockingEnable);
   io_->ConfigFlags &= ~(ImGuiConfigFlags_ViewportsEnable);
+  this->end_startup_phase("backends", phase_begin);
+
+  // Create the hidden window and thread which upload textures.
+  uploader_ = std::make_unique<TextureUploader>(window);
+  this->end_startup_phase("uploader", phase_begin);
 }
 
 App::~App() {
+  // Wait for any updates or initializations which are still running in the
+  // background. The layers are being destroyed, so errors are ignored.
+  try {
+    this->wait_for_job(background_update_);
+  } catch (...) {
+  }
+  for (auto& layer : layers_) {
+    try {
+      this->wait_for_job(layer->init_);
+    } catch (...) {
+    }
+  }
+
   // Kill all layers first
   for (auto& layer : layers_) layer->on_kill();
 
+  // Finish any background work before tearing down ImGui, as jobs may still
+  // reference the layers or the ImGui context. Jobs may be blocked in
+  // post_and_wait, so we keep servicing the command queue until they are done.
+  // Errors from commands are ignored, as there is nobody left to report them.
+  while (jobs_->idle() == false) {
+    try {
+      this->process_commands();
+    } catch (...) {
+    }
+    jobs_->drain_main(main_thread_budget_ms_);
+    std::this_thread::yield();
+  }
+  jobs_.reset();
+  try {
+    this->process_commands();
+  } catch (...) {
+  }
+
+  // Textures which were never delivered are deleted with the main context.
+  uploader_.reset();
+
+  // Unused textures in the pool are deleted while the context is current.
+  TexturePool::global().clear();
+
   // Cleanup
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -218,7 +330,7 @@ App::~App() {
 }
 
 void App::update_dpi_scale() {
-  auto monitor = glfwGetWindowMonitor(window);
+  auto monitor = window ? glfwGetWindowMonitor(window) : nullptr;
   if (!monitor) monitor = glfwGetPrimaryMonitor();
 
   if (monitor) {
@@ -240,8 +352,18 @@ void App::run() {
     style_->Colors[ImGuiCol_WindowBg].w = 1.0f;
   }
 
+  // Layers pushed or popped from now on are handled between frames.
+  running_ = true;
+
+  next_frame_ = std::chrono::steady_clock::now();
+  last_swap_ = next_frame_;
+
   // Main loop
   while (!glfwWindowShouldClose(window)) {
+    // Wait until it is time to start the next frame
+    this->pace_frame();
+    const auto input_time = std::chrono::steady_clock::now();
+
     // Poll and handle events (inputs, window resize, etc.)
     // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to
     // tell if dear imgui wants to use your inputs.
@@ -253,16 +375,48 @@ void App::run() {
     // flags.
     glfwPollEvents();
 
+    // Execute all commands which have been posted to the main thread.
+    this->process_commands();
+
+    // Hand finished textures to their owners, and allow more uploads.
+    uploader_->begin_frame();
+
+    // Run continuations which background jobs have handed back to the main
+    // thread, within the per-frame budget.
+    jobs_->drain_main(main_thread_budget_ms_);
+
+    // Finish the updates from the last frame, and only then change the layer
+    // stack, as background updates may still be using the layers.
+    this->finish_updates();
+    this->apply_layer_changes();
+
+    // Advance the state of all layers
+    this->update_layers();
+
     // Start the Dear ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
+    this->handle_input();
     ImGui::NewFrame();
 
-    // Go through and render all layers
-    for (auto& layer : layers_) layer->render();
+    // Go through and render all layers. The stack may be changed from inside
+    // render, but those changes are deferred to the next frame.
+    for (auto& layer : layers_) {
+      if (layer->enabled_ == false) continue;
+
+      if (layer->ready_) {
+        layer->render();
+      } else {
+        layer->render_placeholder();
+      }
+    }
 
     // Rendering
     ImGui::Render();
+    if (capture_) {
+      capture_->write(*ImGui::GetDrawData(), io_->Fonts->TexID);
+      if (capture_->frames() >= capture_frames_) capture_.reset();
+    }
     int display_w, display_h;
     glfwGetFramebufferSize(window, &display_w, &display_h);
     glViewport(0, 0, display_w, display_h);
@@ -283,17 +437,419 @@ void App::run() {
       glfwMakeContextCurrent(backup_current_context);
     }
 
+    // Textures drawn in any viewport are kept, and the ones which have not
+    // been drawn for the longest are evicted if the VRAM budget is exceeded.
+    ResidencyManager& residency = ResidencyManager::global();
+    for (ImGuiViewport* viewport : ImGui::GetPlatformIO().Viewports) {
+      if (viewport->DrawData) residency.mark_used(*viewport->DrawData);
+    }
+    residency.end_frame();
+
+    const auto work_end = std::chrono::steady_clock::now();
     glfwSwapBuffers(window);
+    this->record_frame(input_time, work_end);
+
+    if (first_frame_) {
+      first_frame_ = false;
+      first_frame_time_ = last_swap_;
+      auto begin = input_time;
+      this->end_startup_phase("first_frame", begin);
+    }
+  }
+
+  // A playback which was cut short still reports the frames it played.
+  if (input_player_) this->finish_playback();
+
+  // Apply any remaining changes, so that popped layers are killed.
+  this->finish_updates();
+  running_ = false;
+  this->apply_layer_changes();
+}
+
+Layer* App::push_layer(std::unique_ptr<Layer> layer) {
+  Layer* ptr = layer.get();
+  if (ptr == nullptr) return nullptr;
+
+  if (running_) {
+    layer_changes_.emplace_back(std::move(layer), nullptr);
+  } else {
+    this->attach_layer(std::move(layer));
+  }
+
+  return ptr;
+}
+
+void App::pop_layer(Layer* layer) {
+  if (layer == nullptr) return;
+
+  if (running_) {
+    layer_changes_.emplace_back(nullptr, layer);
+  } else {
+    this->detach_layer(layer);
+  }
+}
+
+void App::attach_layer(std::unique_ptr<Layer> layer) {
+  layers_.push_back(std::move(layer));
+  Layer* ptr = layers_.back().get();
+  ptr->set_app_ptr(this);
+  ptr->on_push();
+
+  // Layers without async initialization are rendered from the next frame on,
+  // instead of showing a placeholder while an empty job runs.
+  if (ptr->has_async_init()) {
+    ptr->ready_ = false;
+    ptr->init_ = jobs_->submit([ptr] { ptr->on_push_async(); });
+  } else {
+    ptr->ready_ = true;
+  }
+}
+
+void App::detach_layer(Layer* layer) {
+  auto it = std::find_if(
+      layers_.begin(), layers_.end(),
+      [layer](const std::unique_ptr<Layer>& l) { return l.get() == layer; });
+  if (it == layers_.end()) {
+    throw std::runtime_error(
+        "ImApp::App::pop_layer: Layer is not in the rendering stack.");
+  }
+
+  // The layer can't be destroyed while it is still being initialized.
+  this->wait_for_job(layer->init_);
+  layer->on_kill();
+  layers_.erase(it);
+}
+
+void App::apply_layer_changes() {
+  // Layers pushed or popped from inside on_push or on_kill are queued again,
+  // and are handled at the next frame.
+  std::vector<std::pair<std::unique_ptr<Layer>, Layer*>> changes;
+  changes.swap(layer_changes_);
+  for (auto& change : changes) {
+    if (change.first) {
+      this->attach_layer(std::move(change.first));
+    } else {
+      this->detach_layer(change.second);
+    }
+  }
+
+  // Mark layers as ready once their async initialization has finished.
+  for (auto& layer : layers_) {
+    if (layer->ready_ == false && layer->init_.done()) {
+      jobs_->wait(layer->init_);
+      layer->ready_ = true;
+    }
+  }
+}
+
+void App::finish_updates() {
+  // Finish and publish any updates which ran while the last frame rendered.
+  // The flag is only cleared once the job has finished, as a command may
+  // throw while the updates are still running over updating_.
+  if (background_pending_) {
+    try {
+      this->wait_for_job(background_update_);
+    } catch (...) {
+      if (background_update_.done()) background_pending_ = false;
+      throw;
+    }
+    background_pending_ = false;
+    for (auto layer : updating_) layer->publish();
+  }
+}
+
+void App::update_layers() {
+  const double now = glfwGetTime();
+  double frame_dt = last_update_time_ ? now - *last_update_time_ : 0.;
+  last_update_time_ = now;
+  if (input_player_) frame_dt = input_player_->delta_time();
+
+  // Determine how many steps to take, and how large they are
+  std::uint32_t n_steps = 1;
+  double dt = frame_dt;
+  if (update_rate_ > 0.) {
+    dt = 1. / update_rate_;
+    update_accumulator_ += frame_dt;
+    n_steps = static_cast<std::uint32_t>(update_accumulator_ / dt);
+    if (n_steps > max_updates_per_frame_) {
+      // We are too far behind, and drop the time we can't catch up on.
+      n_steps = max_updates_per_frame_;
+      update_accumulator_ = 0.;
+    } else {
+      update_accumulator_ -= n_steps * dt;
+    }
+  }
+  if (n_steps == 0) return;
+
+  // Only enabled layers which have finished initializing are updated. We keep
+  // the list, as layers may be disabled while the updates are running.
+  updating_.clear();
+  for (auto& layer : layers_) {
+    if (layer->enabled_ && layer->ready_) updating_.push_back(layer.get());
+  }
+  if (updating_.empty()) return;
+
+  // Each layer takes all of its steps in order, but layers are independent
+  // of one another, so they may be updated in parallel.
+  auto body = [this, n_steps, dt](std::size_t b, std::size_t e) {
+    for (std::size_t i = b; i < e; i++) {
+      for (std::uint32_t s = 0; s < n_steps; s++) updating_[i]->update(dt);
+    }
+  };
+
+  switch (update_mode_) {
+    case UpdateMode::MainThread:
+      body(0, updating_.size());
+      for (auto layer : updating_) layer->publish();
+      break;
+
+    case UpdateMode::Parallel:
+    case UpdateMode::Background:
+      background_update_ = jobs_->submit(
+          [this, body] { jobs_->parallel_for(0, updating_.size(), body, 1); });
+      background_pending_ = true;
+      // Layers may hand work to post_and_wait, so the frame must wait while
+      // servicing the command queue, rather than block in parallel_for.
+      if (update_mode_ == UpdateMode::Parallel) this->finish_updates();
+      break;
+  }
+}
+
+void App::end_startup_phase(const char* name,
+                            std::chrono::steady_clock::time_point& begin) {
+  const auto now = std::chrono::steady_clock::now();
+  const std::chrono::duration<double, std::milli> time = now - begin;
+  startup_phases_.push_back({name, time.count()});
+  begin = now;
+}
+
+double App::time_to_first_frame_ms() const {
+  if (first_frame_) return 0.;
+  const std::chrono::duration<double, std::milli> time =
+      first_frame_time_ - startup_begin_;
+  return time.count();
+}
+
+void App::set_frame_pacing(FramePacing mode, double fps) {
+  pacing_ = mode;
+  target_fps_ = fps > 0. ? fps : 0.;
+  if (pacing_ == FramePacing::Capped && target_fps_ == 0.) target_fps_ = 60.;
+
+  // Only the synchronized modes wait for the display.
+  const bool vsync =
+      pacing_ == FramePacing::VSync || pacing_ == FramePacing::LowLatency;
+  glfwSwapInterval(vsync ? 1 : 0);
+
+  next_frame_ = std::chrono::steady_clock::now();
+}
+
+double App::frame_period() const {
+  if (target_fps_ > 0.) return 1. / target_fps_;
+
+  auto monitor = glfwGetWindowMonitor(window);
+  if (!monitor) monitor = glfwGetPrimaryMonitor();
+  const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+  if (mode && mode->refreshRate > 0) return 1. / mode->refreshRate;
+
+  return 1. / 60.;
+}
+
+void App::pace_frame() {
+  using Clock = std::chrono::steady_clock;
+  using Seconds = std::chrono::duration<double>;
+
+  switch (pacing_) {
+    case FramePacing::VSync:
+    case FramePacing::Uncapped:
+      break;
+
+    case FramePacing::Capped: {
+      const auto period =
+          std::chrono::duration_cast<Clock::duration>(Seconds(frame_period()));
+      next_frame_ += period;
+
+      // If we have fallen more than a frame behind, we start over from now,
+      // instead of rendering a burst of frames to catch up.
+      const auto now = Clock::now();
+      if (next_frame_ < now - period) next_frame_ = now;
+      sleep_until_precise(next_frame_);
+    } break;
+
+    case FramePacing::LowLatency: {
+      // The swap returns at about the time of the vertical blank, so the next
+      // deadline is one period after it. We start the frame as late as we can,
+      // while leaving a margin in case it takes longer than usual.
+      constexpr double MARGIN_MS = 1.;
+      const double work_ms = 1.25 * frame_stats_.work_time_ms + MARGIN_MS;
+      const double wait_ms = 1000. * frame_period() - work_ms;
+      if (wait_ms > 0.) {
+        const std::chrono::duration<double, std::milli> wait(wait_ms);
+        sleep_until_precise(last_swap_ +
+                            std::chrono::duration_cast<Clock::duration>(wait));
+      }
+    } break;
+  }
+}
+
+void App::record_frame(std::chrono::steady_clock::time_point input_time,
+                       std::chrono::steady_clock::time_point work_end) {
+  using Ms = std::chrono::duration<double, std::milli>;
+  const auto now = std::chrono::steady_clock::now();
+  const double frame_ms = Ms(now - last_swap_).count();
+  // The work time excludes the swap, which may block waiting for the display.
+  const double work_ms = Ms(work_end - input_time).count();
+  const double swap_ms = Ms(now - input_time).count();
+  last_swap_ = now;
+
+  // Input sampled at the start of the frame reaches the screen once the swap
+  // has finished, and the display has scanned out the image, which takes
+  // about half a refresh period on average.
+  const double scanout_ms = 500. * frame_period();
+
+  FrameStats& fs = frame_stats_;
+  fs.frame_time_ms = ema(fs.frame_time_ms, frame_ms, fs.frames);
+  fs.fps = fs.frame_time_ms > 0. ? 1000. / fs.frame_time_ms : 0.;
+  fs.work_time_ms = ema(fs.work_time_ms, work_ms, fs.frames);
+  fs.input_latency_ms =
+      ema(fs.input_latency_ms, swap_ms + scanout_ms, fs.frames);
+  fs.frames++;
+
+  if (input_player_) input_player_->add_timing(frame_ms, work_ms);
+}
+
+void App::capture_frames(const std::filesystem::path& fname,
+                         std::uint32_t n_frames) {
+  capture_.reset();
+  if (n_frames == 0) return;
+
+  capture_ = std::make_unique<DrawDataWriter>(fname);
+  capture_frames_ = n_frames;
+}
+
+void App::record_input(const std::filesystem::path& fname) {
+  input_recorder_.reset();
+
+  int w, h;
+  glfwGetWindowSize(window, &w, &h);
+  input_recorder_ = std::make_unique<InputRecorder>(
+      fname, *ImGui::GetCurrentContext(),
+      ImVec2(static_cast<float>(w), static_cast<float>(h)));
+  input_record_begin_ = glfwGetTime();
+}
+
+void App::stop_recording_input() { input_recorder_.reset(); }
+
+void App::play_input(const std::filesystem::path& fname,
+                     const std::filesystem::path& timing_fname,
+                     double delta_time, bool close_when_done) {
+  input_player_.reset();
+  input_player_ = std::make_unique<InputPlayer>(
+      fname, *ImGui::GetCurrentContext(), delta_time);
+  input_timing_fname_ = timing_fname;
+  close_after_playback_ = close_when_done;
+
+  // The layout of the windows depends on the size of the display, so we
+  // match the size of the window during the recording.
+  const ImVec2 size = input_player_->display_size();
+  if (size.x > 0.f && size.y > 0.f) {
+    glfwSetWindowSize(window, static_cast<int>(size.x),
+                      static_cast<int>(size.y));
+  }
+}
+
+void App::handle_input() {
+  ImGuiContext& ctx = *ImGui::GetCurrentContext();
+
+  if (input_player_ && input_player_->play(ctx) == false)
+    this->finish_playback();
+
+  if (input_recorder_)
+    input_recorder_->record(ctx, glfwGetTime() - input_record_begin_);
+}
+
+void App::finish_playback() {
+  auto player = std::move(input_player_);
+  if (input_timing_fname_.empty() == false)
+    player->write_timings(input_timing_fname_);
+
+  if (close_after_playback_) glfwSetWindowShouldClose(window, GLFW_TRUE);
+}
+
+void App::post(std::function<void()> cmd) {
+  commands_.push(std::move(cmd));
+
+  // The main loop might be waiting for events, so we send an empty event to
+  // make sure that the command is handled right away.
+  glfwPostEmptyEvent();
+}
+
+void App::post_and_wait(std::function<void()> cmd) {
+  if (this->on_main_thread()) {
+    cmd();
+    return;
+  }
+
+  std::promise<void> done;
+  std::future<void> result = done.get_future();
+  this->post([&cmd, &done] {
+    try {
+      cmd();
+      done.set_value();
+    } catch (...) {
+      done.set_exception(std::current_exception());
+    }
+  });
+
+  result.get();
+}
+
+void App::process_commands() {
+  // We only execute the commands which are already queued, so that commands
+  // which post new commands are picked up next frame, instead of keeping us
+  // here forever.
+  std::vector<std::function<void()>> batch;
+  std::function<void()> cmd;
+  while (commands_.pop(cmd)) batch.push_back(std::move(cmd));
+
+  // Every command in the batch must run, even if one of them throws, as the
+  // others may be resuming coroutines or unblocking a post_and_wait. The first
+  // error is rethrown once the batch is done.
+  std::exception_ptr error = nullptr;
+  for (auto& c : batch) {
+    try {
+      c();
+    } catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+void App::wait_for_job(const JobHandle& handle) {
+  // The job may be blocked in post_and_wait, which only returns once we have
+  // executed its command, so we keep servicing the queues while we wait.
+  // Between passes, we sleep until some work finishes, or briefly, so that
+  // newly posted commands are picked up. Any exception from the job is
+  // rethrown once it has finished.
+  while (true) {
+    this->process_commands();
+    jobs_->drain_main(main_thread_budget_ms_);
+    if (jobs_->wait_for(handle, 0.2)) return;
   }
 }
 
 void App::set_icon(const Image& image) {
+  // GLFW needs rows without padding, so padded images are copied first.
+  std::optional<Image> copy;
+  if (image.stride() != image.width()) copy.emplace(image.view());
+  const Image& packed = copy ? *copy : image;
+
   // Set program icon
   GLFWimage icon[1];
-  icon[0].width = static_cast<int>(image.width());
-  icon[0].height = static_cast<int>(image.height());
+  icon[0].width = static_cast<int>(packed.width());
+  icon[0].height = static_cast<int>(packed.height());
   icon[0].pixels = const_cast<unsigned char*>(
-      reinterpret_cast<const unsigned char*>(&image[0]));
+      reinterpret_cast<const unsigned char*>(packed.data()));
   glfwSetWindowIcon(window, 1, icon);
 }
 
@@ -437,113 +993,4 @@ void App::set_default_style() {
       0.1450980454683304f, 0.1450980454683304f, 0.1490196138620377f, 1.0f);
 }
 
-Image Image::from_file(const std::filesystem::path& fname) {
-  int img_width = 0;
-  int img_height = 0;
-
-  // Make sure file exists
-  if (std::filesystem::exists(fname) == false) {
-    std::string mssg = "ImApp::Image::from_file: File with name \"";
-    mssg += fname.string() + "\" does not exist.\n";
-    throw std::runtime_error(mssg);
-  }
-
-  // Get image data since file exists
-  const std::string fname_str = fname.string();
-  unsigned char* data =
-      stbi_load(fname_str.data(), &img_width, &img_height, NULL, 4);
-
-  if (data == NULL) {
-    // Loading failed. Throw exception.
-    std::string mssg = "ImApp::Image::from_file: stbi_load failure.\n";
-    mssg += "stbi_failure_reason: ";
-    mssg += std::string(stbi_failure_reason());
-    mssg += "\n";
-    throw std::runtime_error(mssg);
-  }
-
-  const std::uint32_t width = static_cast<std::uint32_t>(img_width);
-  const std::uint32_t height = static_cast<std::uint32_t>(img_height);
-  Pixel* pdata = reinterpret_cast<Pixel*>(data);
-
-  // Create image
-  Image img(height, width);
-
-  // Set all pixels
-  for (std::size_t i = 0; i < img.size(); i++) {
-    img[i] = pdata[i];
-  }
-
-  // Free stb_image data
-  stbi_image_free(data);
-
-  return img;
-}
-
-bool Image::save_png(const std::filesystem::path& fname) {
-  const unsigned char* data = reinterpret_cast<unsigned char*>(image_.data());
-  const int width = static_cast<int>(this->width());
-  const int height = static_cast<int>(this->height());
-  const int stride = 4 * width;
-  const std::string fname_str = fname.string();
-  const int err =
-      stbi_write_png(fname_str.data(), width, height, 4, data, stride);
-  return err != 0;
-}
-
-bool Image::save_jpg(const std::filesystem::path& fname) {
-  const unsigned char* data = reinterpret_cast<unsigned char*>(image_.data());
-  const int width = static_cast<int>(this->width());
-  const int height = static_cast<int>(this->height());
-  const std::string fname_str = fname.string();
-  const int err = stbi_write_jpg(fname_str.data(), width, height, 4, data, 100);
-  return err != 0;
-}
-
-void Image::send_to_gpu() {
-  if (ogl_texture_id_) {
-    // Texture already exists on GPU. We just need to update it.
-    glBindTexture(GL_TEXTURE_2D, ogl_texture_id_.value());
-
-    // For some reason it can't seem to find glTexSubImage2D, so for now I
-    // will just use glTexImage2D when updating the image.
-    // glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, 0, GL_RGBA,
-    // GL_UNSIGNED_BYTE, image_.data());
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, image_.data());
-  } else {
-    // Texture not on GPU yet. Need to do everything from scratch.
-
-    // Create a OpenGL texture identifier
-    std::uint32_t texture_id = 0;
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-
-    // Setup filtering parameters for display
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // The ImGui site said I should need these two lines for WebGL, but
-    // they weren't found by my loader so we will ignore them.
-    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // Upload pixels into texture
-#if defined(GL_UNPACK_ROW_LENGTH) && !defined(__EMSCRIPTEN__)
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-#endif
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, image_.data());
-
-    // Save texture id to object
-    ogl_texture_id_ = texture_id;
-  }
-}
-
-void Image::delete_from_gpu() {
-  if (ogl_texture_id_) {
-    glDeleteTextures(1, &ogl_texture_id_.value());
-    ogl_texture_id_ = std::nullopt;
-  }
-}
-
 }  // namespace ImApp
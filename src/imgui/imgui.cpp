@@ -1012,6 +1012,10 @@ CODE
 // System includes
 #include <stdio.h>      // vsnprintf, sscanf, printf
 #include <stdint.h>     // intptr_t
+#include <locale.h>     // localeconv, for ImFormatNumber()
+#if !defined(IMGUI_DISABLE_DEFAULT_FORMAT_FUNCTIONS) && ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+#include <charconv>     // std::to_chars, for ImFormatNumber() (which only uses it when __cpp_lib_to_chars is defined)
+#endif
 
 // [Windows] On non-Visual Studio compilers, we default to IMGUI_DISABLE_WIN32_DEFAULT_IME_FUNCTIONS unless explicitly enabled
 #if defined(_WIN32) && !defined(_MSC_VER) && !defined(IMGUI_ENABLE_WIN32_DEFAULT_IME_FUNCTIONS) && !defined(IMGUI_DISABLE_WIN32_DEFAULT_IME_FUNCTIONS)
@@ -2117,6 +2121,256 @@ void ImFormatStringToTempBufferV(const char** out_buf, const char** out_buf_end,
     }
 }
 
+// Copy the literal text of a format up to its next conversion (or end), unescaping '%%'.
+// Return NULL if the text doesn't fit in 'out', otherwise the position of the conversion.
+static const char* ImParseFormatSpecText(const char* fmt, char* out, int out_size, ImU8* out_len)
+{
+    int len = 0;
+    while (fmt[0] != 0 && !(fmt[0] == '%' && fmt[1] != '%'))
+    {
+        if (len == out_size - 1)
+            return NULL;
+        out[len++] = fmt[0];
+        fmt += (fmt[0] == '%') ? 2 : 1;
+    }
+    out[len] = 0;
+    *out_len = (ImU8)len;
+    return fmt;
+}
+
+static const char* ImParseFormatSpecNumber(const char* fmt, short* out_value, int max_value)
+{
+    int value = 0;
+    while (*fmt >= '0' && *fmt <= '9')
+    {
+        value = value * 10 + (*fmt++ - '0');
+        if (value > max_value)
+            return NULL;
+    }
+    *out_value = (short)value;
+    return fmt;
+}
+
+// Parse a format holding at most one conversion into 'out_spec'.
+// Leave out_spec->Fast to false for anything ImFormatNumber() needs to hand over to ImFormatString().
+bool ImParseFormatSpec(const char* fmt, ImFormatSpec* out_spec)
+{
+    ImFormatSpec* spec = out_spec;
+    *spec = ImFormatSpec();
+    spec->Width = spec->Precision = -1;
+    if ((fmt = ImParseFormatSpecText(fmt, spec->Prefix, IM_ARRAYSIZE(spec->Prefix), &spec->PrefixLen)) == NULL)
+        return false;
+    if (*fmt == '%')
+    {
+        fmt++;
+        for (;; fmt++)
+        {
+            if (*fmt == '-')        { spec->FlagLeft = true; }
+            else if (*fmt == '+')   { spec->FlagPlus = true; }
+            else if (*fmt == ' ')   { spec->FlagSpace = true; }
+            else if (*fmt == '0')   { spec->FlagZero = true; }
+            else if (*fmt == '#' || *fmt == '\'') { return false; }
+            else break;
+        }
+        if (*fmt >= '1' && *fmt <= '9')
+            if ((fmt = ImParseFormatSpecNumber(fmt, &spec->Width, 256)) == NULL)
+                return false;
+        if (*fmt == '.')
+            if ((fmt = ImParseFormatSpecNumber(fmt + 1, &spec->Precision, 64)) == NULL)
+                return false;
+
+        // Length modifiers. Without one, integer conversions read an 'int' which may be narrowed by 'h'/'hh'.
+        // Floating point conversions only accept 'l', which is a no-op for them.
+        int int_bits = 32, arg_bits = 32;
+        bool float_length = true;
+        if (fmt[0] == 'h' && fmt[1] == 'h')                         { int_bits = 8; float_length = false; fmt += 2; }
+        else if (fmt[0] == 'h')                                     { int_bits = 16; float_length = false; fmt += 1; }
+        else if (fmt[0] == 'l' && fmt[1] == 'l')                    { int_bits = arg_bits = 64; float_length = false; fmt += 2; }
+        else if (fmt[0] == 'l')                                     { int_bits = arg_bits = (int)sizeof(long) * 8; fmt += 1; }
+        else if (fmt[0] == 'j' || fmt[0] == 'q')                    { int_bits = arg_bits = 64; float_length = false; fmt += 1; }
+        else if (fmt[0] == 'z' || fmt[0] == 't')                    { int_bits = arg_bits = (int)sizeof(size_t) * 8; float_length = false; fmt += 1; }
+#ifdef _WIN32
+        else if (fmt[0] == 'I' && fmt[1] == '6' && fmt[2] == '4')   { int_bits = arg_bits = 64; float_length = false; fmt += 3; } // (glibc reads 'I' as a flag instead)
+        else if (fmt[0] == 'I' && fmt[1] == '3' && fmt[2] == '2')   { float_length = false; fmt += 3; }
+#endif
+
+        const char c = *fmt++;
+        if (c == 'd' || c == 'i' || c == 'u' || c == 'o' || c == 'x' || c == 'X')
+        {
+            spec->IntBits = (ImU8)int_bits;
+            spec->ArgBits = (ImU8)arg_bits;
+        }
+        else if (c != 'f' && c != 'F' && c != 'e' && c != 'E' && c != 'g' && c != 'G')
+        {
+            return false;
+        }
+        else if (!float_length)
+        {
+            return false;
+        }
+        spec->Conversion = c;
+        if ((fmt = ImParseFormatSpecText(fmt, spec->Suffix, IM_ARRAYSIZE(spec->Suffix), &spec->SuffixLen)) == NULL)
+            return false;
+        if (*fmt != 0) // More than one conversion
+            return false;
+    }
+    spec->Fast = true;
+    return true;
+}
+
+#ifdef __cpp_lib_to_chars
+
+// Return the parsed version of 'fmt' from the current context's cache, or NULL without a context or for long formats.
+static const ImFormatSpec* ImGetFormatSpec(const char* fmt)
+{
+    ImGuiContext* ctx = GImGui;
+    if (ctx == NULL)
+        return NULL;
+    const ImU64 slot = ((ImU64)(intptr_t)fmt * 0x9E3779B97F4A7C15ull) >> 58; // Fibonacci hashing into 64 slots
+    IM_STATIC_ASSERT(IM_ARRAYSIZE(ctx->FormatSpecCache) == 64);
+    ImFormatSpec* spec = &ctx->FormatSpecCache[slot];
+    if (spec->Key == fmt && strcmp(spec->Format, fmt) == 0)
+        return spec;
+    const size_t fmt_len = strlen(fmt);
+    if (fmt_len >= IM_ARRAYSIZE(spec->Format))
+        return NULL;
+    ImParseFormatSpec(fmt, spec);
+    spec->Key = fmt;
+    memcpy(spec->Format, fmt, fmt_len + 1);
+    return spec;
+}
+
+// Assemble prefix, padding, sign, digits and suffix the way printf() lays out a conversion.
+// Writes straight into 'buf' when the output fits, so only truncated outputs are copied.
+static int ImFormatNumberWrite(char* buf, size_t buf_size, const ImFormatSpec* spec, char sign, const char* digits, int digits_len, bool zero_pad)
+{
+    const int len = (sign ? 1 : 0) + digits_len;
+    const int pad = (spec->Width > len) ? spec->Width - len : 0;
+    const int total = spec->PrefixLen + pad + len + spec->SuffixLen;
+    if (buf == NULL)
+        return total;
+
+    char out[512];
+    char* p = (total < (int)buf_size) ? buf : out;
+    char* const p_begin = p;
+    if (spec->PrefixLen > 0) { memcpy(p, spec->Prefix, spec->PrefixLen); p += spec->PrefixLen; }
+    if (pad > 0 && !spec->FlagLeft && !zero_pad) { memset(p, ' ', pad); p += pad; }
+    if (sign) { *p++ = sign; }
+    if (pad > 0 && !spec->FlagLeft && zero_pad) { memset(p, '0', pad); p += pad; }
+    memcpy(p, digits, digits_len);
+    p += digits_len;
+    if (pad > 0 && spec->FlagLeft) { memset(p, ' ', pad); p += pad; }
+    if (spec->SuffixLen > 0) { memcpy(p, spec->Suffix, spec->SuffixLen); p += spec->SuffixLen; }
+    *p = 0;
+    if (p_begin == buf)
+        return total;
+
+    const int w = (int)buf_size - 1;
+    memcpy(buf, out, w);
+    buf[w] = 0;
+    return w;
+}
+
+static int ImFormatNumberInteger(char* buf, size_t buf_size, const ImFormatSpec* spec, ImS64 v)
+{
+    const char c = spec->Conversion;
+    if (c == 0)
+        return ImFormatNumberWrite(buf, buf_size, spec, 0, "", 0, false);
+
+    // Narrow the value the way printf() converts its argument
+    const ImU64 mask = (spec->IntBits == 64) ? ~(ImU64)0 : (((ImU64)1 << spec->IntBits) - 1);
+    ImU64 u = (ImU64)v & mask;
+    char sign = 0;
+    int base = 10;
+    if (c == 'd' || c == 'i')
+    {
+        if (spec->IntBits < 64 && ((u >> (spec->IntBits - 1)) & 1))
+            u |= ~mask;
+        if ((ImS64)u < 0)           { sign = '-'; u = (ImU64)0 - u; }
+        else if (spec->FlagPlus)    { sign = '+'; }
+        else if (spec->FlagSpace)   { sign = ' '; }
+    }
+    else if (c == 'o')
+    {
+        base = 8;
+    }
+    else if (c == 'x' || c == 'X')
+    {
+        base = 16;
+    }
+
+    // Precision is a minimum number of digits, and a zero precision prints nothing for a zero value
+    char digits[24 + 64];
+    int digits_len = 0;
+    if (u != 0 || spec->Precision != 0)
+    {
+        digits_len = (int)(std::to_chars(digits, digits + 24, u, base).ptr - digits);
+        if (spec->Precision > digits_len)
+        {
+            const int zeros = spec->Precision - digits_len;
+            memmove(digits + zeros, digits, digits_len);
+            memset(digits, '0', zeros);
+            digits_len += zeros;
+        }
+        if (c == 'X')
+            for (int n = 0; n < digits_len; n++)
+                digits[n] = ImToUpper(digits[n]);
+    }
+    return ImFormatNumberWrite(buf, buf_size, spec, sign, digits, digits_len, spec->FlagZero && spec->Precision < 0);
+}
+
+#endif // #ifdef __cpp_lib_to_chars
+
+int ImFormatNumber(char* buf, size_t buf_size, const char* fmt, double v)
+{
+#ifdef __cpp_lib_to_chars
+    const ImFormatSpec* spec = ImGetFormatSpec(fmt);
+    const char c = spec ? spec->Conversion : 0;
+    if (spec && spec->Fast && c == 0)
+        return ImFormatNumberWrite(buf, buf_size, spec, 0, "", 0, false);
+    if (spec && spec->Fast && spec->IntBits == 0 && isfinite(v) && GImGui->FormatDecimalPointIsDot)
+    {
+        // Without a precision, %f/%e/%g use 6 (std::to_chars() would otherwise give the shortest round-trip representation)
+        const std::chars_format chars_format = (c == 'f' || c == 'F') ? std::chars_format::fixed : (c == 'e' || c == 'E') ? std::chars_format::scientific : std::chars_format::general;
+        char digits[400];
+        const std::to_chars_result res = std::to_chars(digits, digits + IM_ARRAYSIZE(digits), v, chars_format, (spec->Precision < 0) ? 6 : spec->Precision);
+        if (res.ec == std::errc())
+        {
+            char* d = digits;
+            char sign = 0;
+            if (*d == '-')              { sign = '-'; d++; }
+            else if (spec->FlagPlus)    { sign = '+'; }
+            else if (spec->FlagSpace)   { sign = ' '; }
+            if (c == 'E' || c == 'G')
+                for (char* p = d; p < res.ptr; p++)
+                    *p = ImToUpper(*p);
+            return ImFormatNumberWrite(buf, buf_size, spec, sign, d, (int)(res.ptr - d), spec->FlagZero);
+        }
+    }
+#endif
+    return ImFormatString(buf, buf_size, fmt, v);
+}
+
+int ImFormatNumber(char* buf, size_t buf_size, const char* fmt, int v)
+{
+#ifdef __cpp_lib_to_chars
+    const ImFormatSpec* spec = ImGetFormatSpec(fmt);
+    if (spec && spec->Fast && (spec->Conversion == 0 || spec->ArgBits == 32))
+        return ImFormatNumberInteger(buf, buf_size, spec, v);
+#endif
+    return ImFormatString(buf, buf_size, fmt, v);
+}
+
+int ImFormatNumber(char* buf, size_t buf_size, const char* fmt, ImS64 v)
+{
+#ifdef __cpp_lib_to_chars
+    const ImFormatSpec* spec = ImGetFormatSpec(fmt);
+    if (spec && spec->Fast && (spec->Conversion == 0 || spec->ArgBits == 64))
+        return ImFormatNumberInteger(buf, buf_size, spec, v);
+#endif
+    return ImFormatString(buf, buf_size, fmt, v);
+}
+
 // CRC32 needs a 1KB lookup table (not cache friendly)
 // Although the code to generate the table is simple and shorter than the table itself, using a const table allows us to easily:
 // - avoid an unnecessary branch/memory tap, - keep the ImHashXXX functions usable by static constructors, - make it thread-safe.
@@ -2562,6 +2816,255 @@ void ImGui::ColorConvertHSVtoRGB(float h, float s, float v, float& out_r, float&
 // Helper: Key->value storage
 //-----------------------------------------------------------------------------
 
+#ifdef IMGUI_STORAGE_HASH_INDEX
+
+// With IMGUI_STORAGE_HASH_INDEX, Data is kept in insertion order, and indexed by an open addressing hash table in the
+// style of Swiss tables. Every slot of the index has a control byte, which is either empty or holds 7 bits of the hash
+// of its key. A lookup compares the control bytes of 16 consecutive slots at once, and only reads the keys of the slots
+// whose byte matches. Pairs are never removed, so the index needs no tombstones. Small storages are searched linearly.
+static const int    IM_STORAGE_INDEX_MIN_SIZE = 16;     // Storages with fewer pairs have no index
+static const int    IM_STORAGE_GROUP_SIZE = 16;         // Number of control bytes compared at once
+static const ImU8   IM_STORAGE_CTRL_EMPTY = 0x80;
+
+#if defined(IMGUI_ENABLE_SSE) && (defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define IM_STORAGE_USE_SSE2
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>     // _BitScanForward
+#endif
+
+// Keys are often small sequential integers (e.g. PushID(int)), so they are mixed first.
+static inline ImU32 StorageHash(ImGuiID key)
+{
+    ImU32 h = key * 0x9E3779B1u;
+    return h ^ (h >> 15);
+}
+
+// Returns a mask with a bit set for every slot of the group whose control byte is 'ctrl'.
+static inline ImU32 StorageMatchGroup(const ImU8* group, ImU8 ctrl)
+{
+#ifdef IM_STORAGE_USE_SSE2
+    const __m128i bytes = _mm_loadu_si128((const __m128i*)(const void*)group);
+    return (ImU32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)ctrl)));
+#else
+    ImU32 mask = 0;
+    for (int n = 0; n < IM_STORAGE_GROUP_SIZE; n++)
+        if (group[n] == ctrl)
+            mask |= 1u << n;
+    return mask;
+#endif
+}
+
+static inline int StorageLowestBit(ImU32 mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int n = 0;
+    while ((mask & 1) == 0) { mask >>= 1; n++; }
+    return n;
+#endif
+}
+
+// Places the pair at 'data_idx' into the first empty slot of its probe sequence. Probing advances by whole groups, with
+// triangular steps, which visit every group when the number of groups is a power of two.
+static void StorageIndexInsert(ImGuiStorage* storage, int data_idx)
+{
+    const int capacity = storage->IndexSlots.Size;
+    const ImU32 hash = StorageHash(storage->Data[data_idx].key);
+    int pos = (int)(hash >> 7) & (capacity - 1);
+    for (int step = IM_STORAGE_GROUP_SIZE; ; step += IM_STORAGE_GROUP_SIZE)
+    {
+        const ImU32 empty = StorageMatchGroup(storage->IndexCtrl.Data + pos, IM_STORAGE_CTRL_EMPTY);
+        if (empty != 0)
+        {
+            const int slot = (pos + StorageLowestBit(empty)) & (capacity - 1);
+            const ImU8 ctrl = (ImU8)(hash & 0x7F);
+            storage->IndexCtrl[slot] = ctrl;
+            if (slot < IM_STORAGE_GROUP_SIZE - 1)
+                storage->IndexCtrl[capacity + slot] = ctrl;     // Copy of the first slots, read by groups which wrap around
+            storage->IndexSlots[slot] = data_idx;
+            storage->IndexedCount++;
+            return;
+        }
+        pos = (pos + step) & (capacity - 1);
+    }
+}
+
+// Sizes the index for the pairs of Data, with a maximum load of 7/8, and inserts all of them.
+static void StorageIndexRebuild(ImGuiStorage* storage, int min_pairs)
+{
+    int capacity = IM_STORAGE_GROUP_SIZE;
+    while (capacity - capacity / 8 < min_pairs)
+        capacity *= 2;
+    storage->IndexCtrl.resize(capacity + IM_STORAGE_GROUP_SIZE - 1);
+    memset(storage->IndexCtrl.Data, IM_STORAGE_CTRL_EMPTY, (size_t)storage->IndexCtrl.Size);
+    storage->IndexSlots.resize(capacity);
+    storage->IndexedCount = 0;
+    for (int n = 0; n < storage->Data.Size; n++)
+        StorageIndexInsert(storage, n);
+}
+
+static ImGuiStorage::ImGuiStoragePair* StorageFind(const ImGuiStorage* storage_const, ImGuiID key)
+{
+    ImGuiStorage* storage = const_cast<ImGuiStorage*>(storage_const);
+    ImVector<ImGuiStorage::ImGuiStoragePair>& data = storage->Data;
+    if (data.Size < IM_STORAGE_INDEX_MIN_SIZE)
+    {
+        for (ImGuiStorage::ImGuiStoragePair& pair : data)
+            if (pair.key == key)
+                return &pair;
+        return NULL;
+    }
+
+    // Data may have been modified directly, e.g. with Clear() or push_back() followed by BuildSortByKey()
+    if (storage->IndexedCount != data.Size)
+        StorageIndexRebuild(storage, data.Size);
+
+    const int capacity = storage->IndexSlots.Size;
+    const ImU32 hash = StorageHash(key);
+    int pos = (int)(hash >> 7) & (capacity - 1);
+    for (int step = IM_STORAGE_GROUP_SIZE; ; step += IM_STORAGE_GROUP_SIZE)
+    {
+        const ImU8* group = storage->IndexCtrl.Data + pos;
+        for (ImU32 match = StorageMatchGroup(group, (ImU8)(hash & 0x7F)); match != 0; match &= match - 1)
+        {
+            ImGuiStorage::ImGuiStoragePair* pair = &data.Data[storage->IndexSlots.Data[(pos + StorageLowestBit(match)) & (capacity - 1)]];
+            if (pair->key == key)
+                return pair;
+        }
+        if (StorageMatchGroup(group, IM_STORAGE_CTRL_EMPTY) != 0)
+            return NULL;
+        pos = (pos + step) & (capacity - 1);
+    }
+}
+
+// The pair must not be in the storage yet.
+static ImGuiStorage::ImGuiStoragePair* StorageAdd(ImGuiStorage* storage, const ImGuiStorage::ImGuiStoragePair& pair)
+{
+    const bool index_valid = storage->IndexedCount == storage->Data.Size && storage->IndexSlots.Size > 0;
+    storage->Data.push_back(pair);
+    const int count = storage->Data.Size;
+    if (count >= IM_STORAGE_INDEX_MIN_SIZE)
+    {
+        const int capacity = storage->IndexSlots.Size;
+        if (index_valid && count <= capacity - capacity / 8)
+            StorageIndexInsert(storage, count - 1);
+        else
+            StorageIndexRebuild(storage, count * 2);    // Grow ahead, so that a burst of insertions doesn't rebuild often
+    }
+    return &storage->Data.back();
+}
+
+// For quicker full rebuild of a storage (instead of an incremental one), you may add all your contents and then sort once.
+// This isn't needed with an index, but the pairs are still sorted for code which expects it.
+void ImGuiStorage::BuildSortByKey()
+{
+    struct StaticFunc
+    {
+        static int IMGUI_CDECL PairComparerByID(const void* lhs, const void* rhs)
+        {
+            // We can't just do a subtraction because qsort uses signed integers and subtracting our ID doesn't play well with that.
+            if (((const ImGuiStoragePair*)lhs)->key > ((const ImGuiStoragePair*)rhs)->key) return +1;
+            if (((const ImGuiStoragePair*)lhs)->key < ((const ImGuiStoragePair*)rhs)->key) return -1;
+            return 0;
+        }
+    };
+    ImQsort(Data.Data, (size_t)Data.Size, sizeof(ImGuiStoragePair), StaticFunc::PairComparerByID);
+    IndexedCount = -1;  // Positions have changed
+}
+
+int ImGuiStorage::GetInt(ImGuiID key, int default_val) const
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    return it ? it->val_i : default_val;
+}
+
+bool ImGuiStorage::GetBool(ImGuiID key, bool default_val) const
+{
+    return GetInt(key, default_val ? 1 : 0) != 0;
+}
+
+float ImGuiStorage::GetFloat(ImGuiID key, float default_val) const
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    return it ? it->val_f : default_val;
+}
+
+void* ImGuiStorage::GetVoidPtr(ImGuiID key) const
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    return it ? it->val_p : NULL;
+}
+
+// References are only valid until a new value is added to the storage. Calling a Set***() function or a Get***Ref() function invalidates the pointer.
+int* ImGuiStorage::GetIntRef(ImGuiID key, int default_val)
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    if (!it)
+        it = StorageAdd(this, ImGuiStoragePair(key, default_val));
+    return &it->val_i;
+}
+
+bool* ImGuiStorage::GetBoolRef(ImGuiID key, bool default_val)
+{
+    return (bool*)GetIntRef(key, default_val ? 1 : 0);
+}
+
+float* ImGuiStorage::GetFloatRef(ImGuiID key, float default_val)
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    if (!it)
+        it = StorageAdd(this, ImGuiStoragePair(key, default_val));
+    return &it->val_f;
+}
+
+void** ImGuiStorage::GetVoidPtrRef(ImGuiID key, void* default_val)
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    if (!it)
+        it = StorageAdd(this, ImGuiStoragePair(key, default_val));
+    return &it->val_p;
+}
+
+void ImGuiStorage::SetInt(ImGuiID key, int val)
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    if (!it)
+        StorageAdd(this, ImGuiStoragePair(key, val));
+    else
+        it->val_i = val;
+}
+
+void ImGuiStorage::SetBool(ImGuiID key, bool val)
+{
+    SetInt(key, val ? 1 : 0);
+}
+
+void ImGuiStorage::SetFloat(ImGuiID key, float val)
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    if (!it)
+        StorageAdd(this, ImGuiStoragePair(key, val));
+    else
+        it->val_f = val;
+}
+
+void ImGuiStorage::SetVoidPtr(ImGuiID key, void* val)
+{
+    ImGuiStoragePair* it = StorageFind(this, key);
+    if (!it)
+        StorageAdd(this, ImGuiStoragePair(key, val));
+    else
+        it->val_p = val;
+}
+
+#else // #ifdef IMGUI_STORAGE_HASH_INDEX
+
 // std::lower_bound but without the bullshit
 static ImGuiStorage::ImGuiStoragePair* LowerBound(ImVector<ImGuiStorage::ImGuiStoragePair>& data, ImGuiID key)
 {
@@ -2693,6 +3196,8 @@ void ImGuiStorage::SetVoidPtr(ImGuiID key, void* val)
         it->val_p = val;
 }
 
+#endif // #ifdef IMGUI_STORAGE_HASH_INDEX
+
 void ImGuiStorage::SetAllInt(int v)
 {
     for (int i = 0; i < Data.Size; i++)
@@ -4849,6 +5354,10 @@ void ImGui::NewFrame()
     g.WindowsActiveCount = 0;
     g.MenusIdSubmittedThisFrame.resize(0);
 
+    // ImFormatNumber() writes '.' as decimal point, so it only formats floats itself while the C locale agrees
+    const char* decimal_point = localeconv()->decimal_point;
+    g.FormatDecimalPointIsDot = (decimal_point[0] == '.' && decimal_point[1] == 0);
+
     // Calculate frame-rate for the user, as a purely luxurious feature
     g.FramerateSecPerFrameAccum += g.IO.DeltaTime - g.FramerateSecPerFrame[g.FramerateSecPerFrameIdx];
     g.FramerateSecPerFrame[g.FramerateSecPerFrameIdx] = g.IO.DeltaTime;
@@ -410,6 +410,41 @@ IMGUI_API void          ImParseFormatSanitizeForPrinting(const char* fmt_in, cha
 IMGUI_API const char*   ImParseFormatSanitizeForScanning(const char* fmt_in, char* fmt_out, size_t fmt_out_size);
 IMGUI_API int           ImParseFormatPrecision(const char* format, int default_value);
 
+// Helpers: Number formatting
+// Format a single number with a printf-style format holding at most one conversion (e.g. "%.3f", "%5d", "%g ms", "%.0f%%").
+// The output is the same as ImFormatString() with the same argument, but common formats are parsed once into an ImFormatSpec
+// (cached in the context by format string) and written with std::to_chars(), bypassing vsnprintf()'s format parsing.
+// Formats which can't be handled this way (several conversions, '*' width, '#' or '\'' flags, %a/%s/%c..., formats longer
+// than ImFormatSpec::Format[]), non-finite values, calls without a current context, or builds without std::to_chars() fall
+// back on ImFormatString(). Floats also fall back when the C locale doesn't use '.' as decimal point (e.g. after
+// setlocale(LC_NUMERIC, "de_DE.UTF-8")), so that the output still reads back through ImAtof() and sscanf().
+// Integer arguments are passed the way printf() would receive them: 'int' for types up to 32-bit, 'ImS64' for 64-bit types.
+struct ImFormatSpec
+{
+    const char* Key;            // Format string this was parsed from, as a cache key (Format[] is compared too, as pointers get reused)
+    char        Format[48];     // Copy of the format string
+    char        Prefix[24];     // Text before the conversion, with '%%' unescaped
+    char        Suffix[24];     // Text after the conversion, with '%%' unescaped
+    ImU8        PrefixLen;
+    ImU8        SuffixLen;
+    char        Conversion;     // One of "diuoxXfFeEgG", or 0 when the format has no conversion
+    ImU8        IntBits;        // Integer conversions: width of the converted value (8, 16, 32 or 64, from the length modifier)
+    ImU8        ArgBits;        // Integer conversions: width of the argument printf() would read (32 or 64)
+    bool        FlagLeft;       // '-'
+    bool        FlagPlus;       // '+'
+    bool        FlagSpace;      // ' '
+    bool        FlagZero;       // '0'
+    bool        Fast;           // Can be written by ImFormatNumber() without going through ImFormatString()
+    short       Width;          // -1 if unspecified
+    short       Precision;      // -1 if unspecified
+
+    ImFormatSpec()              { memset(this, 0, sizeof(*this)); }
+};
+IMGUI_API bool          ImParseFormatSpec(const char* fmt, ImFormatSpec* out_spec);                 // return out_spec->Fast
+IMGUI_API int           ImFormatNumber(char* buf, size_t buf_size, const char* fmt, double v);
+IMGUI_API int           ImFormatNumber(char* buf, size_t buf_size, const char* fmt, int v);
+IMGUI_API int           ImFormatNumber(char* buf, size_t buf_size, const char* fmt, ImS64 v);
+
 // Helpers: UTF-8 <> wchar conversions
 IMGUI_API const char*   ImTextCharToUtf8(char out_buf[5], unsigned int c);                                                      // return out_buf
 IMGUI_API int           ImTextStrToUtf8(char* out_buf, int out_buf_size, const ImWchar* in_text, const ImWchar* in_text_end);   // return output UTF-8 bytes count
@@ -2455,6 +2490,8 @@ struct ImGuiContext
     int                     WantTextInputNextFrame;
     ImVector<char>          TempBuffer;                         // Temporary text buffer
     char                    TempKeychordName[64];
+    ImFormatSpec            FormatSpecCache[64];                // Parsed format strings for ImFormatNumber(), direct-mapped by format string address
+    bool                    FormatDecimalPointIsDot;            // C locale uses '.' as decimal point, so ImFormatNumber() may write floats itself. Updated by NewFrame().
 
     ImGuiContext(ImFontAtlas* shared_font_atlas)
     {
@@ -2662,6 +2699,7 @@ struct ImGuiContext
         FramerateSecPerFrameAccum = 0.0f;
         WantCaptureMouseNextFrame = WantCaptureKeyboardNextFrame = WantTextInputNextFrame = -1;
         memset(TempKeychordName, 0, sizeof(TempKeychordName));
+        FormatDecimalPointIsDot = false;
     }
 };
 
@@ -2954,11 +2992,14 @@ struct IMGUI_API ImGuiTabBar
 //-----------------------------------------------------------------------------
 
 #define IM_COL32_DISABLE                IM_COL32(0,0,0,1)   // Special sentinel code which cannot be used as a regular color.
-#define IMGUI_TABLE_MAX_COLUMNS         512                 // May be further lifted
+#ifndef IMGUI_TABLE_MAX_COLUMNS
+#define IMGUI_TABLE_MAX_COLUMNS         512                 // May be further lifted, up to 32765 (see below)
+#endif
 
 // Our current column maximum is 64 but we may raise that in the future.
 typedef ImS16 ImGuiTableColumnIdx;
 typedef ImU16 ImGuiTableDrawChannelIdx;
+IM_STATIC_ASSERT(IMGUI_TABLE_MAX_COLUMNS <= (65535 - 4) / 2); // Draw channels (up to 4 + columns * 2) must fit ImGuiTableDrawChannelIdx, where (ImU16)-1 means no channel.
 
 // [Internal] sizeof() ~ 112
 // We use the terminology "Enabled" to refer to a column that is not Hidden by user/api.
@@ -3064,6 +3105,7 @@ struct IMGUI_API ImGuiTable
     ImSpan<ImGuiTableColumn>    Columns;                    // Point within RawData[]
     ImSpan<ImGuiTableColumnIdx> DisplayOrderToIndex;        // Point within RawData[]. Store display order of columns (when not reordered, the values are 0...Count-1)
     ImSpan<ImGuiTableCellData>  RowCellData;                // Point within RawData[]. Store cells background requests for current row.
+    ImSpan<ImGuiTableColumnIdx> OutputColumns;              // Point within RawData[]. Index of columns requesting output this frame, in index order (OutputColumnsCount entries).
     ImBitArrayPtr               EnabledMaskByDisplayOrder;  // Column DisplayOrder -> IsEnabled map
     ImBitArrayPtr               EnabledMaskByIndex;         // Column Index -> IsEnabled map (== not hidden by user/api) in a format adequate for iterating column without touching cold data
     ImBitArrayPtr               VisibleMaskByIndex;         // Column Index -> IsVisibleX|IsVisibleY map (== not hidden by user/api && not hidden by scrolling/cliprect)
@@ -3146,6 +3188,8 @@ struct IMGUI_API ImGuiTable
     ImGuiTableColumnIdx         FreezeColumnsRequest;       // Requested frozen columns count
     ImGuiTableColumnIdx         FreezeColumnsCount;         // Actual frozen columns count (== FreezeColumnsRequest, or == 0 when no scrolling offset)
     ImGuiTableColumnIdx         RowCellDataCurrent;         // Index of current RowCellData[] entry in current row
+    ImGuiTableColumnIdx         OutputColumnsCount;         // Number of columns requesting output this frame (== size of OutputColumns[])
+    ImGuiTableColumnIdx         OutputColumnsNext;          // Index within OutputColumns[] of the next column visited by TableNextVisibleColumn() in current row
     ImGuiTableDrawChannelIdx    DummyDrawChannel;           // Redirect non-visible columns here.
     ImGuiTableDrawChannelIdx    Bg2DrawChannelCurrent;      // For Selectable() and other widgets drawing across columns after the freezing line. Index within DrawSplitter.Channels[]
     ImGuiTableDrawChannelIdx    Bg2DrawChannelUnfrozen;
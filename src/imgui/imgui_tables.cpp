@@ -630,12 +630,13 @@ void ImGui::TableBeginInitMemory(ImGuiTable* table, int columns_count)
 {
     // Allocate single buffer for our arrays
     const int columns_bit_array_size = (int)ImBitArrayGetStorageSizeInBytes(columns_count);
-    ImSpanAllocator<6> span_allocator;
+    ImSpanAllocator<7> span_allocator;
     span_allocator.Reserve(0, columns_count * sizeof(ImGuiTableColumn));
     span_allocator.Reserve(1, columns_count * sizeof(ImGuiTableColumnIdx));
     span_allocator.Reserve(2, columns_count * sizeof(ImGuiTableCellData), 4);
     for (int n = 3; n < 6; n++)
         span_allocator.Reserve(n, columns_bit_array_size);
+    span_allocator.Reserve(6, columns_count * sizeof(ImGuiTableColumnIdx));
     table->RawData = IM_ALLOC(span_allocator.GetArenaSizeInBytes());
     memset(table->RawData, 0, span_allocator.GetArenaSizeInBytes());
     span_allocator.SetArenaBasePtr(table->RawData);
@@ -645,6 +646,7 @@ void ImGui::TableBeginInitMemory(ImGuiTable* table, int columns_count)
     table->EnabledMaskByDisplayOrder = (ImU32*)span_allocator.GetSpanPtrBegin(3);
     table->EnabledMaskByIndex = (ImU32*)span_allocator.GetSpanPtrBegin(4);
     table->VisibleMaskByIndex = (ImU32*)span_allocator.GetSpanPtrBegin(5);
+    span_allocator.GetSpan(6, &table->OutputColumns);
 }
 
 // Apply queued resizing/reordering/hiding requests
@@ -1169,6 +1171,13 @@ void ImGui::TableUpdateLayout(ImGuiTable* table)
         table->Columns[table->LeftMostEnabledColumn].IsSkipItems = false;
     }
 
+    // List columns requesting output in index order. With thousands of columns and only a few in sight, this is what
+    // lets TableNextVisibleColumn(), TableHeadersRow() and TableSetupDrawChannels() only pay for visible columns.
+    table->OutputColumnsCount = 0;
+    for (int column_n = 0; column_n < table->ColumnsCount; column_n++)
+        if (table->Columns[column_n].IsRequestOutput)
+            table->OutputColumns[table->OutputColumnsCount++] = (ImGuiTableColumnIdx)column_n;
+
     // [Part 7] Detect/store when we are hovering the unused space after the right-most column (so e.g. context menus can react on it)
     // Clear Resizable flag if none of our column are actually resizable (either via an explicit _NoResize flag, either
     // because of using _WidthAuto/_WidthStretch). This will hide the resizing option from the context menu.
@@ -1865,6 +1874,7 @@ void ImGui::TableBeginRow(ImGuiTable* table)
     table->CurrentColumn = -1;
     table->RowBgColor[0] = table->RowBgColor[1] = IM_COL32_DISABLE;
     table->RowCellDataCurrent = -1;
+    table->OutputColumnsNext = 0;
     table->IsInsideRow = true;
 
     // Begin frozen rows
@@ -2096,6 +2106,34 @@ bool ImGui::TableNextColumn()
     return table->Columns[table->CurrentColumn].IsRequestOutput;
 }
 
+// [Public] Append into the next column requesting output in the current row, skipping over clipped and hidden columns.
+// Unlike TableNextColumn() this never wraps into the next row, so the typical loop is:
+//   TableNextRow(); while (TableNextVisibleColumn()) { int column_n = TableGetColumnIndex(); ... }
+bool ImGui::TableNextVisibleColumn()
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiTable* table = g.CurrentTable;
+    if (!table)
+        return false;
+
+    if (!table->IsInsideRow)
+        TableNextRow();
+
+    // Columns may also have been visited with TableSetColumnIndex(), skip the ones at or before the current one.
+    int output_n = table->OutputColumnsNext;
+    while (output_n < table->OutputColumnsCount && table->OutputColumns[output_n] <= table->CurrentColumn)
+        output_n++;
+    table->OutputColumnsNext = (ImGuiTableColumnIdx)output_n;
+    if (output_n == table->OutputColumnsCount)
+        return false;
+
+    if (table->CurrentColumn != -1)
+        TableEndCell(table);
+    TableBeginCell(table, table->OutputColumns[output_n]);
+    table->OutputColumnsNext++;
+    return true;
+}
+
 
 // [Internal] Called by TableSetColumnIndex()/TableNextColumn()
 // This is called very frequently, so we need to be mindful of unnecessary overhead.
@@ -2428,11 +2466,23 @@ void ImGui::TablePopBackgroundChannel()
 // - Clip                         --> 2+D+N channels
 // - FreezeRows                   --> 2+D+N*2 (unless scrolling value is zero)
 // - FreezeRows || FreezeColunns  --> 3+D+N*2 (unless scrolling value is zero)
-// Where D is 1 if any column is clipped or hidden (dummy channel) otherwise 0.
+// Where D is 1 if any column is clipped or hidden (dummy channel) otherwise 0, and N is the number of visible columns
+// (not the number of enabled columns, which would make wide scrolling tables split and merge thousands of channels).
 void ImGui::TableSetupDrawChannels(ImGuiTable* table)
 {
+    // Only visible columns get a channel (clipped/hidden ones share the dummy channel), so size for those.
+    // Visible columns are a subset of columns requesting output, so counting them only walks the latter. Assigning
+    // channels below still walks every column: the dummy channel index moves with the visible count, so clipped
+    // columns must be redirected to it each time.
+    int columns_visible_count = 0;
+    for (int output_n = 0; output_n < table->OutputColumnsCount; output_n++)
+    {
+        const ImGuiTableColumn* column = &table->Columns[table->OutputColumns[output_n]];
+        if (column->IsVisibleX && column->IsVisibleY)
+            columns_visible_count++;
+    }
     const int freeze_row_multiplier = (table->FreezeRowsCount > 0) ? 2 : 1;
-    const int channels_for_row = (table->Flags & ImGuiTableFlags_NoClip) ? 1 : table->ColumnsEnabledCount;
+    const int channels_for_row = (table->Flags & ImGuiTableFlags_NoClip) ? 1 : columns_visible_count;
     const int channels_for_bg = 1 + 1 * freeze_row_multiplier;
     const int channels_for_dummy = (table->ColumnsEnabledCount < table->ColumnsCount || (memcmp(table->VisibleMaskByIndex, table->EnabledMaskByIndex, ImBitArrayGetStorageSizeInBytes(table->ColumnsCount)) != 0)) ? +1 : 0;
     const int channels_total = channels_for_bg + (channels_for_row * freeze_row_multiplier) + channels_for_dummy;
@@ -3023,11 +3073,13 @@ void ImGui::TableHeadersRow()
     if (table->HostSkipItems) // Merely an optimization, you may skip in your own code.
         return;
 
+    // Only visit columns requesting output (TableSetColumnIndex() would return false for all others), which keeps
+    // the cost of this row proportional to visible columns on wide tables.
     const int columns_count = TableGetColumnCount();
-    for (int column_n = 0; column_n < columns_count; column_n++)
+    for (int output_n = 0; output_n < table->OutputColumnsCount; output_n++)
     {
-        if (!TableSetColumnIndex(column_n))
-            continue;
+        const int column_n = table->OutputColumns[output_n];
+        TableSetColumnIndex(column_n);
 
         // Push an id to allow unnamed labels (generally accidental, but let's behave nicely with them)
         // In your own code you may omit the PushID/PopID all-together, provided you know they won't collide.
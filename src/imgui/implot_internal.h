@@ -1631,18 +1631,19 @@ static inline double TransformInverse_Logit(double v, void*) {
 // [SECTION] Formatters
 //-----------------------------------------------------------------------------
 
+// Tick labels go through ImFormatNumber, which caches the parsed format and skips vsnprintf for common formats.
 static inline int Formatter_Default(double value, char* buff, int size, void* data) {
     char* fmt = (char*)data;
-    return ImFormatString(buff, size, fmt, value);
+    return ImFormatNumber(buff, size, fmt, value);
 }
 
 static inline int Formatter_Logit(double value, char* buff, int size, void*) {
     if (value == 0.5)
         return ImFormatString(buff,size,"1/2");
     else if (value < 0.5)
-        return ImFormatString(buff,size,"%g", value);
+        return ImFormatNumber(buff,size,"%g", value);
     else
-        return ImFormatString(buff,size,"1 - %g", 1 - value);
+        return ImFormatNumber(buff,size,"1 - %g", 1 - value);
 }
 
 struct Formatter_Time_Data {
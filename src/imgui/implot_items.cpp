@@ -2408,6 +2408,18 @@ struct GetterHeatmapColMaj {
     const ImPlotPoint HalfSize;
 };
 
+// Heatmap labels, passing values to ImFormatNumber as they would be pushed to ImFormatString (int up to 32-bit, 64-bit integers, double).
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, double value) { return ImFormatNumber(buff, size, fmt, value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, float value)  { return ImFormatNumber(buff, size, fmt, (double)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImS8 value)   { return ImFormatNumber(buff, size, fmt, (int)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImU8 value)   { return ImFormatNumber(buff, size, fmt, (int)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImS16 value)  { return ImFormatNumber(buff, size, fmt, (int)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImU16 value)  { return ImFormatNumber(buff, size, fmt, (int)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImS32 value)  { return ImFormatNumber(buff, size, fmt, (int)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImU32 value)  { return ImFormatNumber(buff, size, fmt, (int)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImS64 value)  { return ImFormatNumber(buff, size, fmt, (ImS64)value); }
+static inline int FormatHeatmapLabel(char* buff, int size, const char* fmt, ImU64 value)  { return ImFormatNumber(buff, size, fmt, (ImS64)value); }
+
 template <typename T>
 void RenderHeatmap(ImDrawList& draw_list, const T* values, int rows, int cols, double scale_min, double scale_max, const char* fmt, const ImPlotPoint& bounds_min, const ImPlotPoint& bounds_max, bool reverse_y, bool col_maj) {
     ImPlotContext& gp = *GImPlot;
@@ -2449,7 +2461,7 @@ void RenderHeatmap(ImDrawList& draw_list, const T* values, int rows, int cols, d
                     p.y = yref + ydir * (0.5*h + r*h);
                     ImVec2 px = transformer(p);
                     char buff[32];
-                    ImFormatString(buff, 32, fmt, values[i]);
+                    FormatHeatmapLabel(buff, 32, fmt, values[i]);
                     ImVec2 size = ImGui::CalcTextSize(buff);
                     double t = ImClamp(ImRemap01((double)values[i], scale_min, scale_max),0.0,1.0);
                     ImVec4 color = SampleColormap((float)t);
@@ -2467,7 +2479,7 @@ void RenderHeatmap(ImDrawList& draw_list, const T* values, int rows, int cols, d
                     p.y = yref + ydir * (0.5*h + r*h);
                     ImVec2 px = transformer(p);
                     char buff[32];
-                    ImFormatString(buff, 32, fmt, values[i]);
+                    FormatHeatmapLabel(buff, 32, fmt, values[i]);
                     ImVec2 size = ImGui::CalcTextSize(buff);
                     double t = ImClamp(ImRemap01((double)values[i], scale_min, scale_max),0.0,1.0);
                     ImVec4 color = SampleColormap((float)t);
@@ -0,0 +1,240 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include "input_recording.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace ImApp {
+
+namespace {
+// File layout, all values in native byte order:
+//   header : magic[8], version, IMGUI_VERSION_NUM, sizeof(ImGuiInputEvent),
+//            display_size[2]
+//   frame  : frame index, time, n_events, events[n_events]
+constexpr char input_magic[8] = {'I', 'M', 'I', 'N', 'P', 'U', 'T', '1'};
+constexpr std::uint32_t input_version = 1;
+
+template <typename T>
+void write_value(std::ofstream& file, const T& value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::ifstream& file, T& value) {
+  file.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return static_cast<std::size_t>(file.gcount()) == sizeof(T);
+}
+
+struct Summary {
+  double mean, p50, p95, p99, max;
+};
+
+Summary summarize(std::vector<double> values) {
+  if (values.empty()) return {0., 0., 0., 0., 0.};
+
+  std::sort(values.begin(), values.end());
+  double sum = 0.;
+  for (double v : values) sum += v;
+
+  auto percentile = [&values](double p) {
+    const std::size_t i =
+        static_cast<std::size_t>(p * static_cast<double>(values.size() - 1));
+    return values[i];
+  };
+
+  return {sum / static_cast<double>(values.size()), percentile(0.5),
+          percentile(0.95), percentile(0.99), values.back()};
+}
+
+void write_summary(std::ofstream& file, const char* name,
+                   const std::vector<double>& values) {
+  const Summary s = summarize(values);
+  file << "  \"" << name << "\": {\"mean\": " << s.mean
+       << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95
+       << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "},\n";
+}
+}  // namespace
+
+InputRecorder::InputRecorder(const std::filesystem::path& fname,
+                             const ImGuiContext& ctx, ImVec2 display_size)
+    : file_(fname, std::ios::binary),
+      frame_(0),
+      next_event_(ctx.InputEventsNextEventId) {
+  if (!file_) {
+    std::string mssg = "ImApp::InputRecorder: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  file_.write(input_magic, sizeof(input_magic));
+  write_value(file_, input_version);
+  write_value(file_, static_cast<std::uint32_t>(IMGUI_VERSION_NUM));
+  write_value(file_, static_cast<std::uint32_t>(sizeof(ImGuiInputEvent)));
+  write_value(file_, display_size.x);
+  write_value(file_, display_size.y);
+}
+
+void InputRecorder::record(const ImGuiContext& ctx, double time) {
+  // Events which were not consumed by the last NewFrame stay in the queue, so
+  // we only write the events which are newer than the ones already written.
+  std::uint32_t n_events = 0;
+  for (const ImGuiInputEvent& e : ctx.InputEventsQueue) {
+    if (e.EventId >= next_event_) n_events++;
+  }
+
+  write_value(file_, frame_);
+  write_value(file_, time);
+  write_value(file_, n_events);
+  for (const ImGuiInputEvent& e : ctx.InputEventsQueue) {
+    if (e.EventId >= next_event_) write_value(file_, e);
+  }
+
+  next_event_ = ctx.InputEventsNextEventId;
+  frame_++;
+}
+
+InputPlayer::InputPlayer(const std::filesystem::path& fname,
+                         const ImGuiContext& ctx, double delta_time)
+    : file_(fname, std::ios::binary),
+      size_(0),
+      display_size_(),
+      delta_time_(delta_time),
+      next_event_(ctx.InputEventsNextEventId),
+      events_(),
+      frame_ms_(),
+      work_ms_() {
+  if (!file_) {
+    std::string mssg = "ImApp::InputPlayer: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  // The number of events in a frame is checked against the size of the file,
+  // before anything is allocated for them.
+  file_.seekg(0, std::ios::end);
+  size_ = static_cast<std::uint64_t>(file_.tellg());
+  file_.seekg(0, std::ios::beg);
+
+  char magic[sizeof(input_magic)];
+  file_.read(magic, sizeof(magic));
+  if (!file_ || std::memcmp(magic, input_magic, sizeof(magic)) != 0) {
+    std::string mssg = "ImApp::InputPlayer: File \"";
+    mssg += fname.string() + "\" is not an input recording.";
+    throw std::runtime_error(mssg);
+  }
+
+  std::uint32_t version, imgui_version, event_size;
+  if (!read_value(file_, version) || !read_value(file_, imgui_version) ||
+      !read_value(file_, event_size) || !read_value(file_, display_size_.x) ||
+      !read_value(file_, display_size_.y)) {
+    throw std::runtime_error("ImApp::InputPlayer: Truncated input recording.");
+  }
+
+  if (version != input_version || imgui_version != IMGUI_VERSION_NUM ||
+      event_size != sizeof(ImGuiInputEvent)) {
+    throw std::runtime_error(
+        "ImApp::InputPlayer: Input recording was made with a different "
+        "version of ImApp or ImGui.");
+  }
+}
+
+std::uint64_t InputPlayer::remaining() {
+  const std::streamoff pos = file_.tellg();
+  if (pos < 0 || static_cast<std::uint64_t>(pos) > size_) return 0;
+  return size_ - static_cast<std::uint64_t>(pos);
+}
+
+bool InputPlayer::play(ImGuiContext& ctx) {
+  std::uint32_t frame, n_events;
+  double time;
+  if (!read_value(file_, frame) || !read_value(file_, time) ||
+      !read_value(file_, n_events))
+    return false;
+
+  if (n_events > remaining() / sizeof(ImGuiInputEvent))
+    throw std::runtime_error("ImApp::InputPlayer: Truncated input recording.");
+
+  events_.resize(n_events);
+  for (auto& e : events_) {
+    if (!read_value(file_, e)) return false;
+  }
+
+  // Discard everything the backend queued since the last injection. Events
+  // we injected before, which ImGui is still trickling, are kept.
+  auto& queue = ctx.InputEventsQueue;
+  const ImU32 first_new = next_event_;
+  auto end = std::remove_if(
+      queue.begin(), queue.end(),
+      [first_new](const ImGuiInputEvent& e) { return e.EventId >= first_new; });
+  queue.resize(static_cast<int>(end - queue.begin()));
+
+  for (auto& e : events_) {
+    e.EventId = ctx.InputEventsNextEventId++;
+    queue.push_back(e);
+  }
+  next_event_ = ctx.InputEventsNextEventId;
+
+  ctx.IO.DeltaTime = static_cast<float>(delta_time_);
+  return true;
+}
+
+void InputPlayer::add_timing(double frame_ms, double work_ms) {
+  frame_ms_.push_back(frame_ms);
+  work_ms_.push_back(work_ms);
+}
+
+void InputPlayer::write_timings(const std::filesystem::path& fname) const {
+  std::ofstream file(fname);
+  if (!file) {
+    std::string mssg = "ImApp::InputPlayer: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  file << "{\n";
+  file << "  \"frames\": " << frame_ms_.size() << ",\n";
+  file << "  \"delta_time\": " << delta_time_ << ",\n";
+  write_summary(file, "frame_time_ms", frame_ms_);
+  write_summary(file, "work_time_ms", work_ms_);
+  file << "  \"per_frame\": [";
+  for (std::size_t i = 0; i < frame_ms_.size(); i++) {
+    if (i > 0) file << ", ";
+    file << "[" << frame_ms_[i] << ", " << work_ms_[i] << "]";
+  }
+  file << "]\n}\n";
+}
+
+}  // namespace ImApp
@@ -0,0 +1,144 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#ifndef IMAPP_INPUT_RECORDING_H
+#define IMAPP_INPUT_RECORDING_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "imgui/imgui_internal.h"
+
+namespace ImApp {
+
+/**
+ * @brief Records the input events which the platform backend queues in
+ * ImGui, so that a session can later be replayed by an InputPlayer. Events
+ * are stored exactly as they appear in the ImGui input queue, together with
+ * the index and time of the frame in which they were queued.
+ */
+class InputRecorder {
+ public:
+  /**
+   * @brief Creates the recording file, and writes its header. An
+   * std::runtime_error is thrown if the file can't be opened.
+   * @param fname Path to the recording file.
+   * @param ctx ImGui context whose input is recorded.
+   * @param display_size Size of the main viewport.
+   */
+  InputRecorder(const std::filesystem::path& fname, const ImGuiContext& ctx,
+                ImVec2 display_size);
+
+  /**
+   * @brief Writes all events which have been queued since the last call.
+   * This must be called once per frame, just before ImGui::NewFrame.
+   * @param ctx ImGui context whose input is recorded.
+   * @param time Time since the start of the recording, in seconds.
+   */
+  void record(const ImGuiContext& ctx, double time);
+
+ private:
+  std::ofstream file_;
+  std::uint32_t frame_;
+  ImU32 next_event_;
+};
+
+/**
+ * @brief Replays a recording made by an InputRecorder. Any input which the
+ * platform backend queues during the playback is discarded, so that ImGui
+ * only sees the recorded events. Frame timings may be collected and written
+ * to a JSON file once the playback has finished.
+ */
+class InputPlayer {
+ public:
+  /**
+   * @brief Opens a recording file, and validates its header. An
+   * std::runtime_error is thrown if the file can't be opened, or was recorded
+   * with a different version of ImGui.
+   * @param fname Path to the recording file.
+   * @param ctx ImGui context into which the events are injected.
+   * @param delta_time Fixed time step used for every frame, in seconds.
+   */
+  InputPlayer(const std::filesystem::path& fname, const ImGuiContext& ctx,
+              double delta_time);
+
+  /**
+   * @brief Returns the size of the main viewport during the recording.
+   */
+  ImVec2 display_size() const { return display_size_; }
+
+  /**
+   * @brief Returns the fixed time step of the playback, in seconds.
+   */
+  double delta_time() const { return delta_time_; }
+
+  /**
+   * @brief Replaces the queued input with the events of the next recorded
+   * frame, and sets the fixed time step. This must be called once per frame,
+   * just before ImGui::NewFrame. An std::runtime_error is thrown if a frame
+   * claims more events than are left in the file.
+   * @param ctx ImGui context into which the events are injected.
+   * @return False once all recorded frames have been played.
+   */
+  bool play(ImGuiContext& ctx);
+
+  /**
+   * @brief Stores the timing of the frame which was just played.
+   * @param frame_ms Time since the previous frame, in milliseconds.
+   * @param work_ms Time spent working on the frame, in milliseconds.
+   */
+  void add_timing(double frame_ms, double work_ms);
+
+  /**
+   * @brief Writes the collected frame timings, along with their statistics,
+   * to a JSON file.
+   * @param fname Path to the timing file.
+   */
+  void write_timings(const std::filesystem::path& fname) const;
+
+ private:
+  std::ifstream file_;
+  std::uint64_t size_;
+  ImVec2 display_size_;
+  double delta_time_;
+  ImU32 next_event_;
+  std::vector<ImGuiInputEvent> events_;
+  std::vector<double> frame_ms_;
+  std::vector<double> work_ms_;
+
+  std::uint64_t remaining();
+};
+
+}  // namespace ImApp
+#endif
@@ -0,0 +1,434 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+
+#include <ImApp/job_system.hpp>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace ImApp {
+
+// Index of the queue owned by the current thread, and the pool which owns
+// the thread. Threads which are not workers use the shared submission queue.
+static thread_local const JobSystem* tl_pool = nullptr;
+static thread_local std::size_t tl_queue = 0;
+
+JobSystem::JobSystem(std::size_t n_workers)
+    : workers_(),
+      queues_(),
+      queued_(0),
+      in_flight_(0),
+      stop_(false),
+      sleep_mutex_(),
+      sleep_cv_(),
+      done_mutex_(),
+      done_cv_(),
+      main_queue_(),
+      main_wakeup_(),
+      main_thread_(std::this_thread::get_id()) {
+  if (n_workers == 0) n_workers = default_worker_count();
+
+  for (std::size_t i = 0; i < n_workers + 1; i++) {
+    queues_.push_back(std::make_unique<WorkQueue>());
+  }
+
+  workers_.reserve(n_workers);
+  for (std::size_t i = 0; i < n_workers; i++) {
+    workers_.emplace_back(&JobSystem::worker_loop, this, i);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  sleep_cv_.notify_all();
+
+  // Workers drain all remaining jobs before exiting.
+  for (auto& worker : workers_) worker.join();
+}
+
+std::size_t JobSystem::default_worker_count() {
+  const std::size_t n_hw = std::thread::hardware_concurrency();
+  if (n_hw <= 2) return 1;
+  return n_hw - 1;
+}
+
+JobHandle JobSystem::submit(std::function<void()> job) {
+  auto state = std::make_shared<detail::JobState>(1);
+  this->push({std::move(job), state, state.get()});
+  return JobHandle(std::move(state));
+}
+
+void JobSystem::push(Job job) {
+  // Workers push onto the back of their own queue, while all other threads
+  // share the final queue.
+  const std::size_t q = (tl_pool == this) ? tl_queue : workers_.size();
+
+  in_flight_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+    queues_[q]->jobs.push_back(std::move(job));
+  }
+  queued_.fetch_add(1, std::memory_order_release);
+
+  // Taking the lock ensures that a worker which is about to sleep will see the
+  // new job, or will receive the notification.
+  { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+  sleep_cv_.notify_one();
+}
+
+bool JobSystem::try_pop(Job& job) {
+  if (queued_.load(std::memory_order_acquire) == 0) return false;
+
+  const std::size_t n_queues = queues_.size();
+  const std::size_t own = (tl_pool == this) ? tl_queue : workers_.size();
+
+  // Take the newest job from our own queue first, as it is most likely to
+  // still be in the cache.
+  {
+    WorkQueue& wq = *queues_[own];
+    std::lock_guard<std::mutex> lock(wq.mutex);
+    if (wq.jobs.empty() == false) {
+      job = std::move(wq.jobs.back());
+      wq.jobs.pop_back();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  // Steal the oldest job from another queue.
+  for (std::size_t i = 1; i < n_queues; i++) {
+    WorkQueue& wq = *queues_[(own + i) % n_queues];
+    std::unique_lock<std::mutex> lock(wq.mutex, std::try_to_lock);
+    if (lock.owns_lock() && wq.jobs.empty() == false) {
+      job = std::move(wq.jobs.front());
+      wq.jobs.pop_front();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool JobSystem::try_pop_group(const detail::JobState* group, Job& job) {
+  if (queued_.load(std::memory_order_acquire) == 0) return false;
+
+  // Jobs of a group may have been pushed by any thread, so we look through
+  // every queue, oldest job first.
+  for (auto& q : queues_) {
+    WorkQueue& wq = *q;
+    std::lock_guard<std::mutex> lock(wq.mutex);
+    auto it = std::find_if(wq.jobs.begin(), wq.jobs.end(),
+                           [group](const Job& j) { return j.group == group; });
+    if (it != wq.jobs.end()) {
+      job = std::move(*it);
+      wq.jobs.erase(it);
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool JobSystem::run_one() {
+  Job job;
+  if (this->try_pop(job) == false) return false;
+  this->execute(job);
+  return true;
+}
+
+bool JobSystem::run_one_of(const detail::JobState* group) {
+  Job job;
+  if (this->try_pop_group(group, job) == false) return false;
+  this->execute(job);
+  return true;
+}
+
+void JobSystem::execute(Job& job) {
+  try {
+    job.fn();
+  } catch (...) {
+    if (job.state) {
+      std::lock_guard<std::mutex> lock(job.state->mutex);
+      if (!job.state->error) job.state->error = std::current_exception();
+    }
+  }
+
+  if (job.state) this->finish(*job.state);
+
+  if (in_flight_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    { std::lock_guard<std::mutex> lock(done_mutex_); }
+    done_cv_.notify_all();
+  }
+}
+
+void JobSystem::finish(detail::JobState& state) {
+  if (state.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+  std::vector<std::function<void()>> continuations;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.finished = true;
+    continuations.swap(state.continuations);
+  }
+  for (auto& fn : continuations) this->run_on_main(std::move(fn));
+
+  { std::lock_guard<std::mutex> lock(done_mutex_); }
+  done_cv_.notify_all();
+}
+
+void JobSystem::worker_loop(std::size_t index) {
+  tl_pool = this;
+  tl_queue = index;
+
+  while (true) {
+    if (this->run_one()) continue;
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleep_cv_.wait(lock, [this] {
+      return stop_ || queued_.load(std::memory_order_acquire) > 0;
+    });
+    if (stop_ && queued_.load(std::memory_order_acquire) == 0) return;
+  }
+}
+
+void JobSystem::wait(const JobHandle& handle) {
+  // wait_for needs a finite timeout, so we wait in slices.
+  while (this->wait_for(handle, 1000.) == false) continue;
+}
+
+bool JobSystem::wait_for(const JobHandle& handle, double timeout_ms) {
+  // Workers may run any job. Other threads, and in particular the main
+  // thread, could otherwise pick up a long unrelated job, and stall for its
+  // whole duration.
+  const bool worker = tl_pool == this;
+  const bool main = std::this_thread::get_id() == main_thread_;
+  const detail::JobState* group = handle.state_.get();
+  const auto deadline =
+      std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double, std::milli>(timeout_ms));
+
+  while (handle.done() == false) {
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    if (worker ? this->run_one() : this->run_one_of(group)) continue;
+    if (main && this->drain_main(0.) > 0) continue;
+
+    // Nothing left for us to help with, so we sleep until some work
+    // finishes. The timeout lets us pick up jobs queued in the meantime.
+    std::unique_lock<std::mutex> lock(done_mutex_);
+    done_cv_.wait_until(
+        lock,
+        std::min(deadline, std::chrono::steady_clock::now() +
+                               std::chrono::microseconds(200)),
+        [&handle] { return handle.done(); });
+  }
+
+  if (handle.state_) {
+    std::lock_guard<std::mutex> lock(handle.state_->mutex);
+    if (handle.state_->error) std::rethrow_exception(handle.state_->error);
+  }
+  return true;
+}
+
+void JobSystem::wait_idle() {
+  while (in_flight_.load(std::memory_order_acquire) > 0) {
+    if (this->run_one()) continue;
+
+    std::unique_lock<std::mutex> lock(done_mutex_);
+    done_cv_.wait_for(lock, std::chrono::microseconds(200), [this] {
+      return in_flight_.load(std::memory_order_acquire) == 0;
+    });
+  }
+}
+
+void JobSystem::parallel_for(
+    std::size_t begin, std::size_t end,
+    const std::function<void(std::size_t, std::size_t)>& body,
+    std::size_t grain) {
+  if (end <= begin) return;
+  const std::size_t n = end - begin;
+
+  // By default, we aim for a few chunks per thread, to balance the load
+  // without paying too much overhead per chunk.
+  if (grain == 0) grain = std::max<std::size_t>(1, n / (4 * (size() + 1)));
+
+  if (n <= grain || workers_.empty()) {
+    body(begin, end);
+    return;
+  }
+
+  const std::size_t n_chunks = (n + grain - 1) / grain;
+  auto state = std::make_shared<detail::JobState>(n_chunks);
+  for (std::size_t c = 0; c < n_chunks; c++) {
+    const std::size_t b = begin + c * grain;
+    const std::size_t e = std::min(end, b + grain);
+    this->push({[&body, b, e] { body(b, e); }, state, state.get()});
+  }
+
+  // Body is captured by reference, so we must not return until all chunks
+  // have been executed.
+  this->wait(JobHandle(std::move(state)));
+}
+
+void JobSystem::run_on_main(std::function<void()> fn) {
+  main_queue_.push(std::move(fn));
+  if (main_wakeup_) main_wakeup_();
+}
+
+void JobSystem::continue_on_main(const JobHandle& handle,
+                                 std::function<void()> fn) {
+  if (handle.state_) {
+    std::lock_guard<std::mutex> lock(handle.state_->mutex);
+    if (handle.state_->finished == false) {
+      handle.state_->continuations.push_back(std::move(fn));
+      return;
+    }
+  }
+
+  this->run_on_main(std::move(fn));
+}
+
+std::size_t JobSystem::drain_main(double budget_ms) {
+  using Clock = std::chrono::steady_clock;
+  const auto deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double, std::milli>(budget_ms));
+
+  std::size_t n_run = 0;
+  std::function<void()> fn;
+  while (main_queue_.pop(fn)) {
+    fn();
+    fn = nullptr;
+    n_run++;
+
+    if (Clock::now() >= deadline) break;
+  }
+
+  return n_run;
+}
+
+TaskGraph::Node TaskGraph::add(std::function<void()> fn) {
+  tasks_.push_back(std::move(fn));
+  successors_.emplace_back();
+  return tasks_.size() - 1;
+}
+
+void TaskGraph::precede(Node before, Node after) {
+  if (before >= tasks_.size() || after >= tasks_.size()) {
+    throw std::out_of_range("ImApp::TaskGraph::precede: Unknown node.");
+  }
+
+  successors_[before].push_back(after);
+}
+
+// Copy of a TaskGraph which is kept alive until all of its tasks finish.
+struct TaskGraph::Run {
+  std::vector<std::function<void()>> tasks;
+  std::vector<std::vector<Node>> successors;
+  std::unique_ptr<std::atomic<std::size_t>[]> remaining;
+  std::shared_ptr<detail::JobState> state;
+};
+
+void TaskGraph::schedule(JobSystem& jobs, const std::shared_ptr<Run>& run,
+                         Node node) {
+  // Each node runs its task, then releases any successor which has no
+  // remaining predecessors.
+  jobs.push({[&jobs, run, node] {
+               try {
+                 run->tasks[node]();
+               } catch (...) {
+                 std::lock_guard<std::mutex> lock(run->state->mutex);
+                 if (!run->state->error) {
+                   run->state->error = std::current_exception();
+                 }
+               }
+
+               for (const auto s : run->successors[node]) {
+                 if (run->remaining[s].fetch_sub(1) == 1) {
+                   schedule(jobs, run, s);
+                 }
+               }
+
+               jobs.finish(*run->state);
+             },
+             nullptr, run->state.get()});
+}
+
+JobHandle TaskGraph::run(JobSystem& jobs) const {
+  const std::size_t n = tasks_.size();
+  auto state = std::make_shared<detail::JobState>(n);
+  if (n == 0) {
+    state->finished = true;
+    return JobHandle(std::move(state));
+  }
+
+  std::vector<std::size_t> n_preds(n, 0);
+  for (const auto& succs : successors_) {
+    for (const auto s : succs) n_preds[s]++;
+  }
+
+  auto run = std::make_shared<Run>();
+  run->tasks = tasks_;
+  run->successors = successors_;
+  run->remaining = std::make_unique<std::atomic<std::size_t>[]>(n);
+  for (std::size_t i = 0; i < n; i++) run->remaining[i] = n_preds[i];
+  run->state = state;
+
+  // Make sure that every node is reachable, as any cycle would otherwise
+  // leave the graph running forever.
+  std::vector<Node> order;
+  order.reserve(n);
+  for (std::size_t i = 0; i < n; i++) {
+    if (n_preds[i] == 0) order.push_back(i);
+  }
+  const std::size_t n_roots = order.size();
+  for (std::size_t i = 0; i < order.size(); i++) {
+    for (const auto s : successors_[order[i]]) {
+      if (--n_preds[s] == 0) order.push_back(s);
+    }
+  }
+  if (order.size() != n) {
+    throw std::runtime_error("ImApp::TaskGraph::run: Graph contains a cycle.");
+  }
+
+  for (std::size_t i = 0; i < n_roots; i++) schedule(jobs, run, order[i]);
+
+  return JobHandle(std::move(state));
+}
+
+}  // namespace ImApp
@@ -0,0 +1,202 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <ImApp/pixel_allocator.hpp>
+#include <cstdint>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ImApp {
+
+namespace {
+class AlignedAllocator : public PixelAllocator {
+ public:
+  void* allocate(std::size_t bytes) override {
+    return ::operator new(bytes, std::align_val_t(pixel_alignment));
+  }
+
+  void deallocate(void* ptr, std::size_t bytes) noexcept override {
+    ::operator delete(ptr, bytes, std::align_val_t(pixel_alignment));
+  }
+};
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+// Size of a transparent huge page on x86-64 and most ARM64 kernels.
+constexpr std::size_t huge_page_size = 2 << 20;
+#endif
+}  // namespace
+
+std::shared_ptr<PixelAllocator> default_pixel_allocator() {
+  static std::shared_ptr<PixelAllocator> allocator =
+      std::make_shared<AlignedAllocator>();
+  return allocator;
+}
+
+PoolAllocator::PoolAllocator(std::size_t max_cached_bytes,
+                             std::shared_ptr<PixelAllocator> upstream)
+    : upstream_(upstream ? std::move(upstream) : default_pixel_allocator()),
+      max_cached_bytes_(max_cached_bytes),
+      cached_bytes_(0),
+      hits_(0),
+      misses_(0),
+      cache_(),
+      mutex_() {}
+
+PoolAllocator::~PoolAllocator() { this->release(); }
+
+void* PoolAllocator::allocate(std::size_t bytes) {
+  {
+    std::scoped_lock lock(mutex_);
+    auto it = cache_.find(bytes);
+    if (it != cache_.end()) {
+      void* ptr = it->second;
+      cache_.erase(it);
+      cached_bytes_ -= bytes;
+      hits_++;
+      return ptr;
+    }
+    misses_++;
+  }
+
+  return upstream_->allocate(bytes);
+}
+
+void PoolAllocator::deallocate(void* ptr, std::size_t bytes) noexcept {
+  {
+    std::scoped_lock lock(mutex_);
+    if (cached_bytes_ + bytes <= max_cached_bytes_) {
+      try {
+        cache_.emplace(bytes, ptr);
+        cached_bytes_ += bytes;
+        return;
+      } catch (...) {
+        // Without room for the entry, the buffer is released instead.
+      }
+    }
+  }
+
+  upstream_->deallocate(ptr, bytes);
+}
+
+void PoolAllocator::release() {
+  std::multimap<std::size_t, void*> cache;
+  {
+    std::scoped_lock lock(mutex_);
+    cache.swap(cache_);
+    cached_bytes_ = 0;
+  }
+
+  for (const auto& [bytes, ptr] : cache) upstream_->deallocate(ptr, bytes);
+}
+
+std::size_t PoolAllocator::cached_bytes() const {
+  std::scoped_lock lock(mutex_);
+  return cached_bytes_;
+}
+
+std::size_t PoolAllocator::hits() const {
+  std::scoped_lock lock(mutex_);
+  return hits_;
+}
+
+std::size_t PoolAllocator::misses() const {
+  std::scoped_lock lock(mutex_);
+  return misses_;
+}
+
+#if defined(_WIN32)
+void* MappedAllocator::allocate(std::size_t bytes) {
+  // Large pages require the SeLockMemoryPrivilege, which applications rarely
+  // hold, so huge_pages_ is ignored here.
+  void* ptr =
+      VirtualAlloc(nullptr, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void MappedAllocator::deallocate(void* ptr, std::size_t) noexcept {
+  VirtualFree(ptr, 0, MEM_RELEASE);
+}
+#elif defined(__unix__) || defined(__APPLE__)
+void* MappedAllocator::allocate(std::size_t bytes) {
+  // Huge pages can only back the parts of a mapping which are aligned to a
+  // huge page, so we map extra memory and trim it to an aligned start.
+  const bool align = huge_pages_ && bytes >= huge_page_size;
+  const std::size_t length = align ? bytes + huge_page_size : bytes;
+
+  void* map = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) throw std::bad_alloc();
+  if (align == false) return map;
+
+  const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t mapped_bytes = (bytes + page - 1) / page * page;
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(map);
+  const std::uintptr_t start =
+      (begin + huge_page_size - 1) & ~std::uintptr_t(huge_page_size - 1);
+  const std::uintptr_t end = begin + length;
+  if (start > begin) munmap(map, start - begin);
+  if (end > start + mapped_bytes) {
+    munmap(reinterpret_cast<void*>(start + mapped_bytes),
+           end - (start + mapped_bytes));
+  }
+
+  void* ptr = reinterpret_cast<void*>(start);
+#if defined(MADV_HUGEPAGE)
+  madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+  return ptr;
+}
+
+void MappedAllocator::deallocate(void* ptr, std::size_t bytes) noexcept {
+  munmap(ptr, bytes);
+}
+#else
+void* MappedAllocator::allocate(std::size_t bytes) {
+  return default_pixel_allocator()->allocate(bytes);
+}
+
+void MappedAllocator::deallocate(void* ptr, std::size_t bytes) noexcept {
+  default_pixel_allocator()->deallocate(ptr, bytes);
+}
+#endif
+
+}  // namespace ImApp
@@ -0,0 +1,407 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <ImApp/resample.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAPP_RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ImApp {
+
+namespace {
+// All four channels of a pixel, held in one SIMD register where available.
+// Every pixel type is widened to four floats, so the filters are written
+// once for all of them.
+#if defined(IMAPP_RESAMPLE_SSE2)
+struct Vec4 {
+  __m128 v;
+
+  static Vec4 zero() { return {_mm_setzero_ps()}; }
+  static Vec4 load(const float* p) { return {_mm_loadu_ps(p)}; }
+  void store(float* p) const { _mm_storeu_ps(p, v); }
+  void add(Vec4 x, float w) {
+    v = _mm_add_ps(v, _mm_mul_ps(x.v, _mm_set1_ps(w)));
+  }
+  void add(Vec4 x) { v = _mm_add_ps(v, x.v); }
+};
+#else
+struct Vec4 {
+  float v[4];
+
+  static Vec4 zero() { return {{0.f, 0.f, 0.f, 0.f}}; }
+  static Vec4 load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+  void store(float* p) const {
+    for (int c = 0; c < 4; c++) p[c] = v[c];
+  }
+  void add(Vec4 x, float w) {
+    for (int c = 0; c < 4; c++) v[c] += x.v[c] * w;
+  }
+  void add(Vec4 x) {
+    for (int c = 0; c < 4; c++) v[c] += x.v[c];
+  }
+};
+#endif
+
+// Widens a row of pixels to four floats per pixel. Colors with alpha are
+// premultiplied, so that transparent pixels carry no weight.
+template <typename P>
+void load_row(const P* in, std::uint32_t n, float* out) {
+  if constexpr (std::is_same_v<P, Pixel>) {
+    // The most common case, without the divisions of to_rgba
+    constexpr float unit = 1.f / 255.f;
+    for (std::uint32_t x = 0; x < n; x++, out += 4) {
+      const float a = in[x].a() * unit;
+      out[0] = in[x].r() * unit * a;
+      out[1] = in[x].g() * unit * a;
+      out[2] = in[x].b() * unit * a;
+      out[3] = a;
+    }
+    return;
+  }
+
+  for (std::uint32_t x = 0; x < n; x++, out += 4) {
+    std::array<float, 4> c = PixelTraits<P>::to_rgba(in[x]);
+    if constexpr (PixelTraits<P>::channels == 4) {
+      c[0] *= c[3];
+      c[1] *= c[3];
+      c[2] *= c[3];
+    }
+    std::copy(c.begin(), c.end(), out);
+  }
+}
+
+template <typename P>
+void store_row(const float* in, std::uint32_t n, P* out) {
+  for (std::uint32_t x = 0; x < n; x++, in += 4) {
+    std::array<float, 4> c = {in[0], in[1], in[2], in[3]};
+    if constexpr (PixelTraits<P>::channels == 4) {
+      const float inv = c[3] > 0.f ? 1.f / c[3] : 0.f;
+      c[0] *= inv;
+      c[1] *= inv;
+      c[2] *= inv;
+    }
+    out[x] = PixelTraits<P>::from_rgba(c);
+  }
+}
+
+// The source pixels which contribute to each output pixel along one axis,
+// with taps weights stored for every output pixel.
+struct Contributions {
+  std::vector<std::uint32_t> first;
+  std::vector<std::uint32_t> count;
+  std::vector<float> weights;
+  std::size_t taps = 0;
+
+  const float* weights_of(std::size_t i) const {
+    return weights.data() + i * taps;
+  }
+};
+
+constexpr double pi = 3.14159265358979323846;
+
+double sinc(double x) {
+  if (x == 0.) return 1.;
+  x *= pi;
+  return std::sin(x) / x;
+}
+
+double kernel(ResampleFilter filter, double x) {
+  switch (filter) {
+    case ResampleFilter::Box:
+      return (x >= -0.5 && x < 0.5) ? 1. : 0.;
+    case ResampleFilter::Bilinear:
+      return std::max(0., 1. - std::abs(x));
+    case ResampleFilter::Lanczos:
+      return std::abs(x) < 3. ? sinc(x) * sinc(x / 3.) : 0.;
+    default:
+      return 0.;
+  }
+}
+
+double radius(ResampleFilter filter) {
+  switch (filter) {
+    case ResampleFilter::Box:
+      return 0.5;
+    case ResampleFilter::Bilinear:
+      return 1.;
+    case ResampleFilter::Lanczos:
+      return 3.;
+    default:
+      return 1.;
+  }
+}
+
+Contributions contributions(std::uint32_t src_n, std::uint32_t dst_n,
+                            ResampleFilter filter) {
+  // Coordinates are in source pixels, where pixel j covers [j, j+1). When
+  // shrinking, the filter is widened to cover the footprint of the output.
+  const double scale = static_cast<double>(src_n) / dst_n;
+  const double widen = std::max(1., scale);
+  const double support = filter == ResampleFilter::Area
+                             ? std::max(1., scale)
+                             : radius(filter) * widen;
+
+  std::vector<std::vector<double>> all(dst_n);
+  Contributions c;
+  c.first.resize(dst_n);
+  c.count.resize(dst_n);
+  for (std::uint32_t i = 0; i < dst_n; i++) {
+    const double center = (i + 0.5) * scale;
+    const auto lo = static_cast<std::int64_t>(std::floor(center - support));
+    const auto hi = static_cast<std::int64_t>(std::ceil(center + support));
+    const std::int64_t begin = std::max<std::int64_t>(lo, 0);
+    const std::int64_t end = std::min<std::int64_t>(hi, src_n);
+
+    std::vector<double>& w = all[i];
+    double total = 0.;
+    for (std::int64_t j = begin; j < end; j++) {
+      double wj;
+      if (filter == ResampleFilter::Area) {
+        const double a = i * scale, b = (i + 1) * scale;
+        wj = std::max(0., std::min<double>(j + 1, b) - std::max<double>(j, a));
+      } else {
+        wj = kernel(filter, (j + 0.5 - center) / widen);
+      }
+      w.push_back(wj);
+      total += wj;
+    }
+
+    // Drop the taps without weight at either end
+    std::size_t skip = 0;
+    while (skip < w.size() && w[skip] == 0.) skip++;
+    while (w.size() > skip && w.back() == 0.) w.pop_back();
+    w.erase(w.begin(), w.begin() + static_cast<std::ptrdiff_t>(skip));
+
+    if (w.empty() || total == 0.) {
+      // Can only happen for a box at a pixel edge, so we take the nearest
+      const auto nearest = std::min<std::int64_t>(
+          static_cast<std::int64_t>(center), src_n - 1);
+      c.first[i] = static_cast<std::uint32_t>(nearest);
+      w.assign(1, 1.);
+      total = 1.;
+    } else {
+      c.first[i] = static_cast<std::uint32_t>(begin) +
+                   static_cast<std::uint32_t>(skip);
+    }
+
+    for (double& wj : w) wj /= total;
+    c.count[i] = static_cast<std::uint32_t>(w.size());
+    c.taps = std::max(c.taps, w.size());
+  }
+
+  c.weights.assign(static_cast<std::size_t>(dst_n) * c.taps, 0.f);
+  for (std::uint32_t i = 0; i < dst_n; i++) {
+    std::transform(all[i].begin(), all[i].end(),
+                   c.weights.begin() + static_cast<std::ptrdiff_t>(i * c.taps),
+                   [](double w) { return static_cast<float>(w); });
+  }
+
+  return c;
+}
+
+// Runs body over [0,n) in chunks, on the workers of jobs if there are any.
+void for_rows(JobSystem* jobs, std::size_t n, std::size_t grain,
+              const std::function<void(std::size_t, std::size_t)>& body) {
+  if (jobs && n > grain) {
+    jobs->parallel_for(0, n, body, grain);
+  } else {
+    body(0, n);
+  }
+}
+
+// Output rows are filtered in blocks, so that the rows filtered along x,
+// which the block reads from, stay small and in cache.
+constexpr std::size_t block_rows = 16;
+}  // namespace
+
+template <typename P>
+BasicImage<P> resample(BasicImageView<const P> src, std::uint32_t height,
+                       std::uint32_t width, ResampleFilter filter,
+                       JobSystem* jobs) {
+  ImageOptions options;
+  options.initialize = false;
+  BasicImage<P> dst(height, width, options);
+  if (height == 0 || width == 0) return dst;
+  if (src.empty()) {
+    throw std::invalid_argument(
+        "ImApp::resample: Can't resample an empty image to a non-empty size.");
+  }
+
+  const Contributions cx = contributions(src.width(), width, filter);
+  const Contributions cy = contributions(src.height(), height, filter);
+
+  auto body = [&](std::size_t row_begin, std::size_t row_end) {
+    // Local copies, as the compiler can't tell that the rows being written
+    // never alias the tables.
+    const std::uint32_t* x_first = cx.first.data();
+    const std::uint32_t* x_count = cx.count.data();
+    const float* x_weights = cx.weights.data();
+    std::vector<float> line(static_cast<std::size_t>(src.width()) * 4);
+    std::vector<float> filtered;
+    std::vector<float> out(static_cast<std::size_t>(width) * 4);
+
+    for (std::size_t b = row_begin; b < row_end; b += block_rows) {
+      const std::size_t e = std::min(b + block_rows, row_end);
+
+      // The source rows which are needed by this block of output rows
+      std::uint32_t y0 = cy.first[b], y1 = 0;
+      for (std::size_t y = b; y < e; y++) {
+        y0 = std::min(y0, cy.first[y]);
+        y1 = std::max(y1, cy.first[y] + cy.count[y]);
+      }
+
+      // Filter along x
+      filtered.resize(static_cast<std::size_t>(y1 - y0) * width * 4);
+      for (std::uint32_t sy = y0; sy < y1; sy++) {
+        load_row<P>(src.row(sy), src.width(), line.data());
+        float* row = filtered.data() +
+                     static_cast<std::size_t>(sy - y0) * width * 4;
+        for (std::uint32_t x = 0; x < width; x++) {
+          const float* w = x_weights + x * cx.taps;
+          const float* in = line.data() + std::size_t{x_first[x]} * 4;
+          const std::uint32_t n = x_count[x];
+          Vec4 acc = Vec4::zero();
+          for (std::uint32_t k = 0; k < n; k++, in += 4)
+            acc.add(Vec4::load(in), w[k]);
+          acc.store(row + static_cast<std::size_t>(x) * 4);
+        }
+      }
+
+      // Filter along y, accumulating whole rows at a time
+      for (std::size_t y = b; y < e; y++) {
+        const float* w = cy.weights_of(y);
+        std::fill(out.begin(), out.end(), 0.f);
+        for (std::uint32_t k = 0; k < cy.count[y]; k++) {
+          const float* in = filtered.data() +
+                            static_cast<std::size_t>(cy.first[y] + k - y0) *
+                                width * 4;
+          for (std::size_t i = 0; i < out.size(); i += 4) {
+            Vec4 acc = Vec4::load(out.data() + i);
+            acc.add(Vec4::load(in + i), w[k]);
+            acc.store(out.data() + i);
+          }
+        }
+        store_row<P>(out.data(), width, &dst(static_cast<std::uint32_t>(y), 0));
+      }
+    }
+  };
+
+  for_rows(jobs, height, block_rows, body);
+  return dst;
+}
+
+template <typename P>
+BasicImage<P> downscale(BasicImageView<const P> src, std::uint32_t factor,
+                        JobSystem* jobs) {
+  if (factor == 0) {
+    throw std::invalid_argument("ImApp::downscale: factor must be > 0.");
+  }
+
+  const std::uint32_t height = std::max(src.height() / factor, 1u);
+  const std::uint32_t width = std::max(src.width() / factor, 1u);
+  ImageOptions options;
+  options.initialize = false;
+  BasicImage<P> dst(height, width, options);
+  if (src.empty()) return BasicImage<P>(height, width);
+
+  // The column of the output pixel for every source column, where leftover
+  // columns belong to the last output column.
+  std::vector<std::uint32_t> column(src.width());
+  std::vector<float> inv_count_x(width, 0.f);
+  for (std::uint32_t x = 0; x < src.width(); x++) {
+    column[x] = std::min(x / factor, width - 1);
+    inv_count_x[column[x]] += 1.f;
+  }
+  for (float& n : inv_count_x) n = 1.f / n;
+
+  auto body = [&](std::size_t row_begin, std::size_t row_end) {
+    std::vector<float> line(static_cast<std::size_t>(src.width()) * 4);
+    std::vector<float> sum(static_cast<std::size_t>(width) * 4);
+
+    for (std::size_t y = row_begin; y < row_end; y++) {
+      const std::uint32_t sy0 = static_cast<std::uint32_t>(y) * factor;
+      const std::uint32_t sy1 =
+          y + 1 == height ? src.height() : sy0 + factor;
+
+      std::fill(sum.begin(), sum.end(), 0.f);
+      for (std::uint32_t sy = sy0; sy < sy1; sy++) {
+        load_row<P>(src.row(sy), src.width(), line.data());
+        const float* in = line.data();
+        for (std::uint32_t x = 0; x < src.width(); x++, in += 4) {
+          float* s = sum.data() + static_cast<std::size_t>(column[x]) * 4;
+          Vec4 acc = Vec4::load(s);
+          acc.add(Vec4::load(in));
+          acc.store(s);
+        }
+      }
+
+      const float inv_rows = 1.f / static_cast<float>(sy1 - sy0);
+      for (std::uint32_t x = 0; x < width; x++) {
+        float* s = sum.data() + static_cast<std::size_t>(x) * 4;
+        Vec4 avg = Vec4::zero();
+        avg.add(Vec4::load(s), inv_rows * inv_count_x[x]);
+        avg.store(s);
+      }
+      store_row<P>(sum.data(), width, &dst(static_cast<std::uint32_t>(y), 0));
+    }
+  };
+
+  for_rows(jobs, height, 8, body);
+  return dst;
+}
+
+#define IMAPP_INSTANTIATE_RESAMPLE(P)                                        \
+  template BasicImage<P> resample(BasicImageView<const P>, std::uint32_t,    \
+                                  std::uint32_t, ResampleFilter,             \
+                                  JobSystem*);                               \
+  template BasicImage<P> downscale(BasicImageView<const P>, std::uint32_t,   \
+                                   JobSystem*);
+
+IMAPP_INSTANTIATE_RESAMPLE(PixelR8)
+IMAPP_INSTANTIATE_RESAMPLE(PixelR16)
+IMAPP_INSTANTIATE_RESAMPLE(PixelR32F)
+IMAPP_INSTANTIATE_RESAMPLE(PixelRG8)
+IMAPP_INSTANTIATE_RESAMPLE(PixelRGB8)
+IMAPP_INSTANTIATE_RESAMPLE(Pixel)
+IMAPP_INSTANTIATE_RESAMPLE(PixelRGBA16F)
+
+#undef IMAPP_INSTANTIATE_RESAMPLE
+
+}  // namespace ImApp
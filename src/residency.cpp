@@ -0,0 +1,228 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <GLFW/glfw3.h>
+
+#include <ImApp/residency.hpp>
+#include <ImApp/texture_pool.hpp>
+
+// Memory queries from GL_NVX_gpu_memory_info and GL_ATI_meminfo, which are
+// not in the OpenGL 1.1 headers.
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+namespace ImApp {
+
+namespace detail {
+void move_tracked_texture(Texture& texture) noexcept {
+  ResidencyManager& manager = ResidencyManager::global();
+  std::lock_guard<std::mutex> lock(manager.mutex_);
+  auto it = manager.entries_.find(texture.id());
+  if (it != manager.entries_.end()) it->second->owner = &texture;
+}
+
+void untrack_texture(Texture& texture) noexcept {
+  ResidencyManager::global().untrack(texture);
+}
+}  // namespace detail
+
+ResidencyManager::ResidencyManager()
+    : mutex_(),
+      lru_(),
+      entries_(),
+      budget_(0),
+      resident_(0),
+      evictions_(0),
+      frame_(0) {}
+
+ResidencyManager::~ResidencyManager() {
+  // Textures which outlive the manager must not try to untrack themselves.
+  for (Entry& entry : lru_) entry.owner->tracked_ = false;
+}
+
+ResidencyManager& ResidencyManager::global() {
+  static ResidencyManager manager;
+  return manager;
+}
+
+void ResidencyManager::set_budget(std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = bytes;
+}
+
+std::size_t ResidencyManager::budget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+std::size_t ResidencyManager::resident_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return resident_;
+}
+
+std::size_t ResidencyManager::texture_count() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::uint64_t ResidencyManager::evictions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return evictions_;
+}
+
+void ResidencyManager::track(Texture& texture, std::size_t bytes) {
+  if (!texture) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(texture.id());
+  if (it != entries_.end()) {
+    Entry& entry = *it->second;
+    resident_ = resident_ - entry.bytes + bytes;
+    entry.bytes = bytes;
+    entry.owner = &texture;
+    this->touch_locked(entry.id);
+  } else {
+    lru_.push_front({texture.id(), bytes, frame_, &texture});
+    entries_.emplace(texture.id(), lru_.begin());
+    resident_ += bytes;
+  }
+  texture.tracked_ = true;
+}
+
+void ResidencyManager::untrack(Texture& texture) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(texture.id());
+  if (it != entries_.end() && it->second->owner == &texture) {
+    resident_ -= it->second->bytes;
+    lru_.erase(it->second);
+    entries_.erase(it);
+  }
+  texture.tracked_ = false;
+}
+
+void ResidencyManager::touch(ImTextureID id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  this->touch_locked(
+      static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(id)));
+}
+
+void ResidencyManager::touch_locked(std::uint32_t id) {
+  auto it = entries_.find(id);
+  if (it == entries_.end() || it->second->last_used == frame_) return;
+
+  it->second->last_used = frame_;
+  lru_.splice(lru_.begin(), lru_, it->second);
+}
+
+void ResidencyManager::mark_used(const ImDrawData& draw_data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.empty()) return;
+
+  // Consecutive commands usually share a texture, so they are looked up once.
+  ImTextureID last = nullptr;
+  for (int l = 0; l < draw_data.CmdListsCount; l++) {
+    for (const ImDrawCmd& cmd : draw_data.CmdLists[l]->CmdBuffer) {
+      if (cmd.UserCallback != nullptr || cmd.TextureId == last) continue;
+      last = cmd.TextureId;
+      this->touch_locked(static_cast<std::uint32_t>(
+          reinterpret_cast<std::uintptr_t>(cmd.TextureId)));
+    }
+  }
+}
+
+std::size_t ResidencyManager::end_frame() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t evicted = 0;
+  if (budget_ > 0) {
+    // Unused textures in the pool count against the budget as well, and are
+    // deleted before any texture which may still be drawn.
+    TexturePool& pool = TexturePool::global();
+    if (resident_ + pool.bytes() > budget_) {
+      evicted += pool.trim(budget_ > resident_ ? budget_ - resident_ : 0);
+    }
+    if (resident_ > budget_) evicted += this->trim_locked(budget_);
+  }
+  frame_++;
+  return evicted;
+}
+
+std::size_t ResidencyManager::trim(std::size_t target) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return this->trim_locked(target);
+}
+
+std::size_t ResidencyManager::trim_locked(std::size_t target) {
+  std::size_t evicted = 0;
+  while (resident_ > target && !lru_.empty() &&
+         lru_.back().last_used != frame_) {
+    Entry& entry = lru_.back();
+
+    // The owner sees an empty texture, and uploads its pixels again the next
+    // time they are drawn.
+    Texture& texture = *entry.owner;
+    glDeleteTextures(1, &texture.id_);
+    texture.id_ = 0;
+    texture.height_ = 0;
+    texture.width_ = 0;
+    texture.tracked_ = false;
+
+    resident_ -= entry.bytes;
+    evicted += entry.bytes;
+    evictions_++;
+    entries_.erase(entry.id);
+    lru_.pop_back();
+  }
+  return evicted;
+}
+
+std::optional<std::size_t> ResidencyManager::available_vram() {
+  // Both extensions report kilobytes.
+  if (glfwExtensionSupported("GL_NVX_gpu_memory_info") == GLFW_TRUE) {
+    GLint kb = 0;
+    glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &kb);
+    return static_cast<std::size_t>(kb) * 1024;
+  }
+
+  if (glfwExtensionSupported("GL_ATI_meminfo") == GLFW_TRUE) {
+    GLint info[4] = {0, 0, 0, 0};
+    glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, info);
+    return static_cast<std::size_t>(info[0]) * 1024;
+  }
+
+  return std::nullopt;
+}
+
+}  // namespace ImApp
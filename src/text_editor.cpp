@@ -0,0 +1,812 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <ImApp/text_editor.hpp>
+
+#include "imgui/imgui_internal.h"
+
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace ImApp {
+
+namespace {
+bool is_word(char c) {
+  const unsigned char u = static_cast<unsigned char>(c);
+  return (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') ||
+         (u >= 'A' && u <= 'Z') || u == '_' || u >= 0x80;
+}
+
+float text_width(const std::string& text, std::size_t count) {
+  const char* begin = text.data();
+  return ImGui::CalcTextSize(begin, begin + std::min(count, text.size())).x;
+}
+}  // namespace
+
+//==============================================================================
+// TextBuffer
+
+void TextBuffer::Buffer::index(std::size_t from) {
+  const char* data = text.data();
+  const char* end = data + text.size();
+  const char* p = data + from;
+  while (p < end) {
+    const void* nl = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    if (nl == nullptr) break;
+    p = static_cast<const char*>(nl);
+    newlines.push_back(static_cast<std::size_t>(p - data));
+    p++;
+  }
+}
+
+void TextBuffer::Buffer::append(std::string_view str) {
+  const std::size_t from = text.size();
+  text.append(str);
+  index(from);
+}
+
+std::size_t TextBuffer::Buffer::count_newlines(std::size_t begin,
+                                               std::size_t end) const {
+  const auto first = std::lower_bound(newlines.begin(), newlines.end(), begin);
+  const auto last = std::lower_bound(first, newlines.end(), end);
+  return static_cast<std::size_t>(last - first);
+}
+
+TextBuffer::TextBuffer(std::string text)
+    : original_(), added_(), nodes_(), free_(), root_(0), seed_(0x9E3779B9) {
+  nodes_.push_back(Node{0, 0, 0, 0, 0, 0, 0, 0, false});
+  original_.text = std::move(text);
+  original_.index(0);
+  if (original_.text.empty() == false)
+    root_ = make_node(false, 0, original_.text.size());
+}
+
+TextBuffer TextBuffer::from_file(const std::filesystem::path& fname) {
+  std::ifstream file(fname, std::ios::binary | std::ios::ate);
+  if (!file) {
+    std::string mssg = "ImApp::TextBuffer::from_file: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+  file.seekg(0);
+  file.read(text.data(), static_cast<std::streamsize>(text.size()));
+  if (!file) {
+    std::string mssg = "ImApp::TextBuffer::from_file: Could not read file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+  return TextBuffer(std::move(text));
+}
+
+void TextBuffer::save(const std::filesystem::path& fname) const {
+  std::ofstream file(fname, std::ios::binary);
+  if (!file) {
+    std::string mssg = "ImApp::TextBuffer::save: Could not open file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+
+  // In order traversal, writing each piece straight from its buffer.
+  std::vector<std::uint32_t> stack;
+  std::uint32_t n = root_;
+  while (n != 0 || stack.empty() == false) {
+    while (n != 0) {
+      stack.push_back(n);
+      n = nodes_[n].left;
+    }
+    n = stack.back();
+    stack.pop_back();
+    const Node& node = nodes_[n];
+    file.write(buffer(node).text.data() + node.start,
+               static_cast<std::streamsize>(node.length));
+    n = node.right;
+  }
+
+  if (!file) {
+    std::string mssg = "ImApp::TextBuffer::save: Could not write file \"";
+    mssg += fname.string() + "\".";
+    throw std::runtime_error(mssg);
+  }
+}
+
+std::size_t TextBuffer::line_start(std::size_t line) const {
+  if (line == 0) return 0;
+  if (line >= line_count()) return size();
+
+  // Find the newline which ends the previous line.
+  std::size_t k = line;
+  std::size_t offset = 0;
+  std::uint32_t n = root_;
+  while (n != 0) {
+    const Node& node = nodes_[n];
+    const Node& left = nodes_[node.left];
+    if (k <= left.sub_newlines) {
+      n = node.left;
+      continue;
+    }
+    k -= left.sub_newlines;
+    offset += left.sub_length;
+    if (k <= node.newlines) {
+      const auto& newlines = buffer(node).newlines;
+      const auto first =
+          std::lower_bound(newlines.begin(), newlines.end(), node.start);
+      return offset + *(first + static_cast<std::ptrdiff_t>(k - 1)) -
+             node.start + 1;
+    }
+    k -= node.newlines;
+    offset += node.length;
+    n = node.right;
+  }
+  return size();
+}
+
+std::size_t TextBuffer::line_end(std::size_t line) const {
+  if (line + 1 < line_count()) return line_start(line + 1) - 1;
+  return size();
+}
+
+std::size_t TextBuffer::line_of(std::size_t offset) const {
+  std::size_t pos = std::min(offset, size());
+  std::size_t line = 0;
+  std::uint32_t n = root_;
+  while (n != 0) {
+    const Node& node = nodes_[n];
+    const Node& left = nodes_[node.left];
+    if (pos < left.sub_length) {
+      n = node.left;
+      continue;
+    }
+    line += left.sub_newlines;
+    pos -= left.sub_length;
+    if (pos < node.length)
+      return line +
+             buffer(node).count_newlines(node.start, node.start + pos);
+    line += node.newlines;
+    pos -= node.length;
+    n = node.right;
+  }
+  return line;
+}
+
+char TextBuffer::at(std::size_t offset) const {
+  std::uint32_t n = root_;
+  while (n != 0) {
+    const Node& node = nodes_[n];
+    const std::size_t left = nodes_[node.left].sub_length;
+    if (offset < left) {
+      n = node.left;
+    } else if (offset < left + node.length) {
+      return buffer(node).text[node.start + offset - left];
+    } else {
+      offset -= left + node.length;
+      n = node.right;
+    }
+  }
+  throw std::out_of_range("ImApp::TextBuffer::at: Offset is out of range.");
+}
+
+std::string TextBuffer::substr(std::size_t offset, std::size_t count) const {
+  std::string out;
+  const std::size_t begin = std::min(offset, size());
+  const std::size_t end = begin + std::min(count, size() - begin);
+  out.reserve(end - begin);
+  append_range(root_, 0, begin, end, out);
+  return out;
+}
+
+void TextBuffer::insert(std::size_t offset, std::string_view text) {
+  if (offset > size())
+    throw std::out_of_range(
+        "ImApp::TextBuffer::insert: Offset is past the end of the text.");
+  if (text.empty()) return;
+
+  const std::size_t start = added_.text.size();
+  const std::size_t old_newlines = added_.newlines.size();
+  added_.append(text);
+  const std::size_t newlines = added_.newlines.size() - old_newlines;
+
+  std::uint32_t a, b;
+  split(root_, offset, a, b);
+
+  // Text typed right after the previous insertion extends its piece, instead
+  // of adding a piece per keystroke. The last piece of a is at the end of
+  // its right spine, so only that spine has to be updated.
+  std::uint32_t last = a;
+  while (last != 0 && nodes_[last].right != 0) last = nodes_[last].right;
+  if (last != 0 && nodes_[last].added &&
+      nodes_[last].start + nodes_[last].length == start) {
+    for (std::uint32_t n = a; n != 0; n = nodes_[n].right) {
+      nodes_[n].sub_length += text.size();
+      nodes_[n].sub_newlines += newlines;
+    }
+    nodes_[last].length += text.size();
+    nodes_[last].newlines += newlines;
+  } else {
+    a = merge(a, make_node(true, start, text.size()));
+  }
+  root_ = merge(a, b);
+}
+
+void TextBuffer::erase(std::size_t offset, std::size_t count) {
+  if (offset > size())
+    throw std::out_of_range(
+        "ImApp::TextBuffer::erase: Offset is past the end of the text.");
+  count = std::min(count, size() - offset);
+  if (count == 0) return;
+
+  std::uint32_t a, b, removed;
+  split(root_, offset, a, b);
+  split(b, count, removed, b);
+  free_nodes(removed);
+  root_ = merge(a, b);
+}
+
+std::uint32_t TextBuffer::make_node(bool added, std::size_t start,
+                                    std::size_t length) {
+  // Xorshift, as the priorities only need to look random.
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+
+  const Buffer& buf = added ? added_ : original_;
+  const std::size_t newlines = buf.count_newlines(start, start + length);
+  const Node node{start, length, newlines, length, newlines,
+                  0,     0,      seed_,    added};
+
+  if (free_.empty() == false) {
+    const std::uint32_t n = free_.back();
+    free_.pop_back();
+    nodes_[n] = node;
+    return n;
+  }
+  nodes_.push_back(node);
+  return static_cast<std::uint32_t>(nodes_.size() - 1);
+}
+
+void TextBuffer::free_nodes(std::uint32_t n) {
+  if (n == 0) return;
+  free_nodes(nodes_[n].left);
+  free_nodes(nodes_[n].right);
+  free_.push_back(n);
+}
+
+void TextBuffer::update(std::uint32_t n) {
+  Node& node = nodes_[n];
+  const Node& left = nodes_[node.left];
+  const Node& right = nodes_[node.right];
+  node.sub_length = left.sub_length + node.length + right.sub_length;
+  node.sub_newlines = left.sub_newlines + node.newlines + right.sub_newlines;
+}
+
+std::uint32_t TextBuffer::merge(std::uint32_t a, std::uint32_t b) {
+  if (a == 0) return b;
+  if (b == 0) return a;
+  if (nodes_[a].priority > nodes_[b].priority) {
+    const std::uint32_t right = merge(nodes_[a].right, b);
+    nodes_[a].right = right;
+    update(a);
+    return a;
+  }
+  const std::uint32_t left = merge(a, nodes_[b].left);
+  nodes_[b].left = left;
+  update(b);
+  return b;
+}
+
+void TextBuffer::split(std::uint32_t n, std::size_t pos, std::uint32_t& a,
+                       std::uint32_t& b) {
+  if (n == 0) {
+    a = b = 0;
+    return;
+  }
+
+  // Nodes may be added while splitting, so no references are held into
+  // nodes_ across the recursive calls.
+  const std::size_t left = nodes_[nodes_[n].left].sub_length;
+  const std::size_t length = nodes_[n].length;
+  if (pos <= left) {
+    std::uint32_t l;
+    split(nodes_[n].left, pos, a, l);
+    nodes_[n].left = l;
+    update(n);
+    b = n;
+  } else if (pos >= left + length) {
+    std::uint32_t r;
+    split(nodes_[n].right, pos - left - length, r, b);
+    nodes_[n].right = r;
+    update(n);
+    a = n;
+  } else {
+    // The split falls inside of this piece, which is cut in two.
+    const std::size_t k = pos - left;
+    const std::uint32_t tail =
+        make_node(nodes_[n].added, nodes_[n].start + k, length - k);
+    Node& node = nodes_[n];
+    node.length = k;
+    node.newlines = buffer(node).count_newlines(node.start, node.start + k);
+    const std::uint32_t right = node.right;
+    node.right = 0;
+    update(n);
+    a = n;
+    b = merge(tail, right);
+  }
+}
+
+void TextBuffer::append_range(std::uint32_t n, std::size_t base,
+                              std::size_t begin, std::size_t end,
+                              std::string& out) const {
+  if (n == 0) return;
+  const Node& node = nodes_[n];
+  const std::size_t start = base + nodes_[node.left].sub_length;
+  const std::size_t stop = start + node.length;
+  if (begin < start) append_range(node.left, base, begin, end, out);
+  if (begin < stop && end > start) {
+    const std::size_t b = std::max(begin, start);
+    const std::size_t e = std::min(end, stop);
+    out.append(buffer(node).text, node.start + b - start, e - b);
+  }
+  if (end > stop) append_range(node.right, stop, begin, end, out);
+}
+
+//==============================================================================
+// TextEditor
+
+TextEditor::TextEditor(TextBuffer buffer)
+    : buffer_(std::move(buffer)),
+      cursor_(0),
+      anchor_(0),
+      preferred_x_(-1.f),
+      content_width_(0.f),
+      read_only_(false),
+      modified_(false),
+      changed_(false),
+      selecting_(false),
+      scroll_to_cursor_(false),
+      undo_(),
+      redo_() {}
+
+void TextEditor::open(const std::filesystem::path& fname) {
+  buffer_ = TextBuffer::from_file(fname);
+  reset();
+}
+
+void TextEditor::save(const std::filesystem::path& fname) {
+  buffer_.save(fname);
+  modified_ = false;
+}
+
+void TextEditor::set_text(std::string text) {
+  buffer_ = TextBuffer(std::move(text));
+  reset();
+}
+
+void TextEditor::reset() {
+  cursor_ = anchor_ = 0;
+  preferred_x_ = -1.f;
+  content_width_ = 0.f;
+  modified_ = false;
+  selecting_ = false;
+  scroll_to_cursor_ = true;
+  undo_.clear();
+  redo_.clear();
+}
+
+void TextEditor::set_cursor(std::size_t offset) {
+  move_to(std::min(offset, buffer_.size()), false);
+  preferred_x_ = -1.f;
+}
+
+void TextEditor::select(std::size_t begin, std::size_t end) {
+  anchor_ = std::min(begin, buffer_.size());
+  move_to(std::min(end, buffer_.size()), true);
+  preferred_x_ = -1.f;
+}
+
+std::string TextEditor::selected_text() const {
+  return buffer_.substr(selection_begin(), selection_end() - selection_begin());
+}
+
+void TextEditor::insert(std::string_view text) {
+  replace(selection_begin(), selection_end() - selection_begin(), text, false);
+}
+
+bool TextEditor::undo() {
+  if (undo_.empty()) return false;
+  Edit edit = std::move(undo_.back());
+  undo_.pop_back();
+  buffer_.erase(edit.offset, edit.inserted.size());
+  buffer_.insert(edit.offset, edit.removed);
+  move_to(edit.offset + edit.removed.size(), false);
+  edit.typing = false;
+  redo_.push_back(std::move(edit));
+  if (undo_.empty() == false) undo_.back().typing = false;
+  preferred_x_ = -1.f;
+  modified_ = changed_ = true;
+  return true;
+}
+
+bool TextEditor::redo() {
+  if (redo_.empty()) return false;
+  Edit edit = std::move(redo_.back());
+  redo_.pop_back();
+  buffer_.erase(edit.offset, edit.removed.size());
+  buffer_.insert(edit.offset, edit.inserted);
+  move_to(edit.offset + edit.inserted.size(), false);
+  undo_.push_back(std::move(edit));
+  preferred_x_ = -1.f;
+  modified_ = changed_ = true;
+  return true;
+}
+
+void TextEditor::replace(std::size_t offset, std::size_t count,
+                         std::string_view text, bool typing) {
+  if (count == 0 && text.empty()) return;
+
+  // Consecutive keystrokes are undone together.
+  if (typing && count == 0 && undo_.empty() == false && undo_.back().typing &&
+      undo_.back().offset + undo_.back().inserted.size() == offset) {
+    undo_.back().inserted += text;
+  } else {
+    undo_.push_back(
+        Edit{offset, buffer_.substr(offset, count), std::string(text), typing});
+  }
+  redo_.clear();
+
+  buffer_.erase(offset, count);
+  buffer_.insert(offset, text);
+  move_to(offset + text.size(), false);
+  preferred_x_ = -1.f;
+  modified_ = changed_ = true;
+}
+
+void TextEditor::move_to(std::size_t offset, bool extend) {
+  cursor_ = offset;
+  if (extend == false) anchor_ = offset;
+  scroll_to_cursor_ = true;
+}
+
+std::size_t TextEditor::next_char(std::size_t offset) const {
+  const std::size_t size = buffer_.size();
+  if (offset >= size) return size;
+  offset++;
+  while (offset < size && (buffer_.at(offset) & 0xC0) == 0x80) offset++;
+  return offset;
+}
+
+std::size_t TextEditor::prev_char(std::size_t offset) const {
+  if (offset == 0) return 0;
+  offset--;
+  while (offset > 0 && (buffer_.at(offset) & 0xC0) == 0x80) offset--;
+  return offset;
+}
+
+std::size_t TextEditor::next_word(std::size_t offset) const {
+  const std::size_t size = buffer_.size();
+  while (offset < size && is_word(buffer_.at(offset)) == false) offset++;
+  while (offset < size && is_word(buffer_.at(offset))) offset++;
+  return offset;
+}
+
+std::size_t TextEditor::prev_word(std::size_t offset) const {
+  while (offset > 0 && is_word(buffer_.at(offset - 1)) == false) offset--;
+  while (offset > 0 && is_word(buffer_.at(offset - 1))) offset--;
+  return offset;
+}
+
+std::string TextEditor::line_text(std::size_t line) const {
+  const std::size_t start = buffer_.line_start(line);
+  const std::size_t length = buffer_.line_end(line) - start;
+  std::string text = buffer_.substr(start, std::min(length, max_line_display));
+  if (text.size() == length && text.empty() == false && text.back() == '\r')
+    text.pop_back();
+  return text;
+}
+
+float TextEditor::x_of(std::size_t offset) const {
+  const std::size_t line = buffer_.line_of(offset);
+  return text_width(line_text(line), offset - buffer_.line_start(line));
+}
+
+std::size_t TextEditor::offset_at(std::size_t line, float x) const {
+  const std::string text = line_text(line);
+  ImFont* font = ImGui::GetFont();
+  const float scale = ImGui::GetFontSize() / font->FontSize;
+
+  const char* p = text.data();
+  const char* end = p + text.size();
+  float pos = 0.f;
+  while (p < end) {
+    unsigned int c;
+    const int len = ImTextCharFromUtf8(&c, p, end);
+    const float advance = font->GetCharAdvance(static_cast<ImWchar>(c)) * scale;
+    if (x < pos + 0.5f * advance) break;
+    pos += advance;
+    p += len > 0 ? len : 1;
+  }
+  return buffer_.line_start(line) + static_cast<std::size_t>(p - text.data());
+}
+
+void TextEditor::handle_keyboard(float page_lines) {
+  ImGuiIO& io = ImGui::GetIO();
+  const bool shift = io.KeyShift;
+  const bool ctrl = io.KeyCtrl;
+  const bool editable = read_only_ == false;
+  const bool has_selection = cursor_ != anchor_;
+  const std::size_t sel_begin = selection_begin();
+  const std::size_t sel_count = selection_end() - sel_begin;
+
+  // Moving up and down keeps the horizontal position of the cursor, even
+  // across shorter lines.
+  std::ptrdiff_t lines = 0;
+  if (ImGui::IsKeyPressed(ImGuiKey_UpArrow)) lines = -1;
+  if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) lines = 1;
+  if (ImGui::IsKeyPressed(ImGuiKey_PageUp))
+    lines = -static_cast<std::ptrdiff_t>(page_lines);
+  if (ImGui::IsKeyPressed(ImGuiKey_PageDown))
+    lines = static_cast<std::ptrdiff_t>(page_lines);
+  if (lines != 0) {
+    if (preferred_x_ < 0.f) preferred_x_ = x_of(cursor_);
+    const std::ptrdiff_t last =
+        static_cast<std::ptrdiff_t>(buffer_.line_count()) - 1;
+    const std::ptrdiff_t line = std::clamp(
+        static_cast<std::ptrdiff_t>(buffer_.line_of(cursor_)) + lines,
+        std::ptrdiff_t(0), last);
+    move_to(offset_at(static_cast<std::size_t>(line), preferred_x_), shift);
+    return;
+  }
+
+  if (ImGui::IsKeyPressed(ImGuiKey_LeftArrow)) {
+    if (has_selection && shift == false)
+      move_to(sel_begin, false);
+    else
+      move_to(ctrl ? prev_word(cursor_) : prev_char(cursor_), shift);
+  } else if (ImGui::IsKeyPressed(ImGuiKey_RightArrow)) {
+    if (has_selection && shift == false)
+      move_to(sel_begin + sel_count, false);
+    else
+      move_to(ctrl ? next_word(cursor_) : next_char(cursor_), shift);
+  } else if (ImGui::IsKeyPressed(ImGuiKey_Home)) {
+    move_to(ctrl ? 0 : buffer_.line_start(buffer_.line_of(cursor_)), shift);
+  } else if (ImGui::IsKeyPressed(ImGuiKey_End)) {
+    move_to(ctrl ? buffer_.size() : buffer_.line_end(buffer_.line_of(cursor_)),
+            shift);
+  } else if (ctrl && ImGui::IsKeyPressed(ImGuiKey_A)) {
+    anchor_ = 0;
+    move_to(buffer_.size(), true);
+  } else if (ctrl && (ImGui::IsKeyPressed(ImGuiKey_C) ||
+                      ImGui::IsKeyPressed(ImGuiKey_X))) {
+    if (has_selection) {
+      ImGui::SetClipboardText(selected_text().c_str());
+      if (editable && ImGui::IsKeyPressed(ImGuiKey_X))
+        replace(sel_begin, sel_count, std::string_view(), false);
+    }
+  } else if (ctrl && editable && ImGui::IsKeyPressed(ImGuiKey_V)) {
+    const char* clipboard = ImGui::GetClipboardText();
+    if (clipboard != nullptr) replace(sel_begin, sel_count, clipboard, false);
+  } else if (ctrl && editable && ImGui::IsKeyPressed(ImGuiKey_Z)) {
+    if (shift)
+      redo();
+    else
+      undo();
+  } else if (ctrl && editable && ImGui::IsKeyPressed(ImGuiKey_Y)) {
+    redo();
+  } else if (editable && ImGui::IsKeyPressed(ImGuiKey_Backspace)) {
+    if (has_selection) {
+      replace(sel_begin, sel_count, std::string_view(), false);
+    } else if (cursor_ > 0) {
+      const std::size_t from = ctrl ? prev_word(cursor_) : prev_char(cursor_);
+      replace(from, cursor_ - from, std::string_view(), false);
+    }
+  } else if (editable && ImGui::IsKeyPressed(ImGuiKey_Delete)) {
+    if (has_selection) {
+      replace(sel_begin, sel_count, std::string_view(), false);
+    } else if (cursor_ < buffer_.size()) {
+      const std::size_t to = ctrl ? next_word(cursor_) : next_char(cursor_);
+      replace(cursor_, to - cursor_, std::string_view(), false);
+    }
+  } else if (editable && (ImGui::IsKeyPressed(ImGuiKey_Enter) ||
+                          ImGui::IsKeyPressed(ImGuiKey_KeypadEnter))) {
+    replace(sel_begin, sel_count, "\n", false);
+  } else if (editable && ImGui::IsKeyPressed(ImGuiKey_Tab)) {
+    replace(sel_begin, sel_count, "\t", true);
+  } else {
+    // Keys which don't move up or down keep preferred_x_ below.
+    if (editable && (ctrl == false || io.KeyAlt) &&
+        io.InputQueueCharacters.Size > 0) {
+      std::string typed;
+      for (ImWchar c : io.InputQueueCharacters) {
+        if (c < 0x20 || c == 0x7F) continue;
+        char utf8[5];
+        typed += ImTextCharToUtf8(utf8, c);
+      }
+      io.InputQueueCharacters.resize(0);
+      replace(sel_begin, sel_count, typed, true);
+    }
+    return;
+  }
+  preferred_x_ = -1.f;
+}
+
+bool TextEditor::draw(const char* str_id, const ImVec2& size) {
+  changed_ = false;
+
+  ImGui::PushStyleColor(ImGuiCol_ChildBg,
+                        ImGui::GetStyleColorVec4(ImGuiCol_FrameBg));
+  const bool visible = ImGui::BeginChild(
+      str_id, size, ImGuiChildFlags_Border,
+      ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoNavInputs);
+  ImGui::PopStyleColor();
+  if (visible == false) {
+    ImGui::EndChild();
+    return changed_;
+  }
+
+  const ImGuiStyle& style = ImGui::GetStyle();
+  ImGuiWindow* window = ImGui::GetCurrentWindow();
+  const ImRect inner = window->InnerRect;
+  const float line_height = ImGui::GetTextLineHeight();
+  const bool focused = ImGui::IsWindowFocused();
+  if (focused) {
+    handle_keyboard(std::max(1.f, std::floor(inner.GetHeight() / line_height)));
+    ImGui::SetNextFrameWantCaptureKeyboard(true);
+  }
+
+  // The gutter holds line numbers, right aligned.
+  const std::size_t line_count = buffer_.line_count();
+  char number[24];
+  char* number_end = std::to_chars(number, number + 24, line_count).ptr;
+  const float gutter =
+      ImGui::CalcTextSize(number, number_end).x + 2.f * style.ItemSpacing.x;
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const float text_x = origin.x + gutter;
+  const int clipped_lines = static_cast<int>(
+      std::min(line_count, static_cast<std::size_t>(INT_MAX)));
+
+  // Mouse selection
+  const ImVec2 mouse = ImGui::GetMousePos();
+  auto offset_at_mouse = [&]() {
+    const float y = (mouse.y - origin.y) / line_height;
+    const std::size_t line = static_cast<std::size_t>(
+        std::clamp(y, 0.f, static_cast<float>(clipped_lines - 1)));
+    return offset_at(line, mouse.x - text_x);
+  };
+  if (ImGui::IsWindowHovered() && inner.Contains(mouse) &&
+      ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+    const std::size_t offset = offset_at_mouse();
+    if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+      std::size_t begin = offset, end = offset;
+      while (begin > 0 && is_word(buffer_.at(begin - 1))) begin--;
+      while (end < buffer_.size() && is_word(buffer_.at(end))) end++;
+      anchor_ = begin;
+      move_to(end, true);
+    } else {
+      move_to(offset, ImGui::GetIO().KeyShift);
+      selecting_ = true;
+    }
+    preferred_x_ = -1.f;
+  } else if (selecting_) {
+    if (ImGui::IsMouseDown(ImGuiMouseButton_Left))
+      move_to(offset_at_mouse(), true);
+    else
+      selecting_ = false;
+  }
+
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  const ImU32 text_col = ImGui::GetColorU32(ImGuiCol_Text);
+  const ImU32 number_col = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+  const ImU32 select_col = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+  const float space_width = ImGui::CalcTextSize(" ").x;
+  const std::size_t sel_begin = selection_begin();
+  const std::size_t sel_end = selection_end();
+  const std::size_t cursor_line = buffer_.line_of(cursor_);
+
+  ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing,
+                      ImVec2(style.ItemSpacing.x, 0.f));
+  ImGuiListClipper clipper;
+  clipper.Begin(clipped_lines, line_height);
+  while (clipper.Step()) {
+    for (int l = clipper.DisplayStart; l < clipper.DisplayEnd; l++) {
+      const std::size_t line = static_cast<std::size_t>(l);
+      const ImVec2 pos = ImGui::GetCursorScreenPos();
+      const std::size_t start = buffer_.line_start(line);
+      const std::size_t end = buffer_.line_end(line);
+      const std::string text = line_text(line);
+
+      if (sel_begin != sel_end && sel_begin <= end && sel_end > start) {
+        const float x0 =
+            sel_begin > start ? text_width(text, sel_begin - start) : 0.f;
+        const float x1 = sel_end <= end ? text_width(text, sel_end - start)
+                                        : text_width(text, text.size()) +
+                                              space_width;
+        draw_list->AddRectFilled(ImVec2(text_x + x0, pos.y),
+                                 ImVec2(text_x + x1, pos.y + line_height),
+                                 select_col);
+      }
+
+      number_end = std::to_chars(number, number + 24, line + 1).ptr;
+      const float number_width = ImGui::CalcTextSize(number, number_end).x;
+      draw_list->AddText(
+          ImVec2(text_x - style.ItemSpacing.x - number_width, pos.y),
+          number_col, number, number_end);
+      draw_list->AddText(ImVec2(text_x, pos.y), text_col, text.data(),
+                         text.data() + text.size());
+
+      if (focused && line == cursor_line) {
+        const float x = text_x + text_width(text, cursor_ - start);
+        draw_list->AddLine(ImVec2(x, pos.y), ImVec2(x, pos.y + line_height),
+                           text_col);
+
+        // Places the IME candidate window at the cursor.
+        ImGuiContext& g = *GImGui;
+        g.PlatformImeData.WantVisible = true;
+        g.PlatformImeData.InputPos = ImVec2(x, pos.y);
+        g.PlatformImeData.InputLineHeight = line_height;
+        g.PlatformImeViewport = window->Viewport->ID;
+      }
+
+      content_width_ =
+          std::max(content_width_,
+                   gutter + text_width(text, text.size()) + space_width);
+      ImGui::Dummy(ImVec2(content_width_, line_height));
+    }
+  }
+  clipper.End();
+  ImGui::PopStyleVar();
+
+  // Scrolls just enough for the cursor to be visible.
+  if (scroll_to_cursor_) {
+    scroll_to_cursor_ = false;
+    const float y = origin.y + static_cast<float>(cursor_line) * line_height;
+    if (y < inner.Min.y)
+      ImGui::SetScrollY(ImGui::GetScrollY() - (inner.Min.y - y));
+    else if (y + line_height > inner.Max.y)
+      ImGui::SetScrollY(ImGui::GetScrollY() + (y + line_height - inner.Max.y));
+
+    const float x = text_x + x_of(cursor_);
+    if (x < inner.Min.x + gutter)
+      ImGui::SetScrollX(ImGui::GetScrollX() - (inner.Min.x + gutter - x));
+    else if (x + space_width > inner.Max.x)
+      ImGui::SetScrollX(ImGui::GetScrollX() + (x + space_width - inner.Max.x));
+  }
+
+  ImGui::EndChild();
+  return changed_;
+}
+
+}  // namespace ImApp
@@ -0,0 +1,298 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <GLFW/glfw3.h>
+
+#include <ImApp/texture_pool.hpp>
+#include <cstdio>
+
+// The GL headers on some platforms only go up to OpenGL 1.1, so we define the
+// newer formats and parameters ourselves.
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_R16
+#define GL_R16 0x822A
+#endif
+#ifndef GL_RG8
+#define GL_RG8 0x822B
+#endif
+#ifndef GL_R32F
+#define GL_R32F 0x822E
+#endif
+#ifndef GL_RGBA16F
+#define GL_RGBA16F 0x881A
+#endif
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_RGBA
+#define GL_TEXTURE_SWIZZLE_RGBA 0x8E46
+#endif
+
+#if defined(_WIN32) && !defined(_WIN64)
+#define IMAPP_GL_APIENTRY __stdcall
+#else
+#define IMAPP_GL_APIENTRY
+#endif
+
+namespace ImApp {
+
+namespace {
+using TexStorage2D = void(IMAPP_GL_APIENTRY*)(GLenum, GLsizei, GLenum,
+                                              GLsizei, GLsizei);
+
+// Immutable storage needs OpenGL 4.2, or ARB_texture_storage.
+TexStorage2D tex_storage_2d() {
+  static const TexStorage2D function = []() -> TexStorage2D {
+    int major = 0, minor = 0;
+    const char* version =
+        reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    const bool core = version &&
+                      std::sscanf(version, "%d.%d", &major, &minor) == 2 &&
+                      (major > 4 || (major == 4 && minor >= 2));
+    if (!core && glfwExtensionSupported("GL_ARB_texture_storage") != GLFW_TRUE)
+      return nullptr;
+
+    return reinterpret_cast<TexStorage2D>(
+        glfwGetProcAddress("glTexStorage2D"));
+  }();
+  return function;
+}
+
+// The format and type which glTexImage2D needs to allocate storage for an
+// internal format, even though no pixels are given.
+void pixel_format(GLint internal_format, GLenum& format, GLenum& type) {
+  switch (internal_format) {
+    case GL_R8:
+      format = GL_RED;
+      type = GL_UNSIGNED_BYTE;
+      break;
+    case GL_R16:
+      format = GL_RED;
+      type = GL_UNSIGNED_SHORT;
+      break;
+    case GL_R32F:
+      format = GL_RED;
+      type = GL_FLOAT;
+      break;
+    case GL_RG8:
+      format = GL_RG;
+      type = GL_UNSIGNED_BYTE;
+      break;
+    case GL_RGB8:
+      format = GL_RGB;
+      type = GL_UNSIGNED_BYTE;
+      break;
+    case GL_RGBA16F:
+      format = GL_RGBA;
+      type = GL_HALF_FLOAT;
+      break;
+    default:
+      format = GL_RGBA;
+      type = GL_UNSIGNED_BYTE;
+      break;
+  }
+}
+}  // namespace
+
+TexturePool::TexturePool(std::size_t capacity)
+    : mutex_(),
+      free_(),
+      by_key_(),
+      capacity_(capacity),
+      bytes_(0),
+      hits_(0),
+      misses_(0) {}
+
+// The OpenGL context may already be gone when the global pool is destroyed,
+// so the App clears the pool instead, and the textures are not deleted here.
+TexturePool::~TexturePool() = default;
+
+TexturePool& TexturePool::global() {
+  static TexturePool pool;
+  return pool;
+}
+
+Texture TexturePool::acquire(std::uint32_t height, std::uint32_t width,
+                             std::int32_t internal_format) {
+  const Key key{height, width, internal_format};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_key_.find(key);
+    if (it != by_key_.end()) {
+      // The most recently given back texture is the most likely to still be
+      // in the caches of the driver.
+      auto entry = it->second.back();
+      it->second.pop_back();
+      if (it->second.empty()) by_key_.erase(it);
+
+      const std::uint32_t id = entry->id;
+      bytes_ -= entry->bytes;
+      free_.erase(entry);
+      hits_++;
+
+      glBindTexture(GL_TEXTURE_2D, id);
+      return Texture(id, height, width);
+    }
+    misses_++;
+  }
+
+  // Texture::generate leaves the new texture bound
+  Texture texture = Texture::generate();
+  GLenum format, type;
+  pixel_format(internal_format, format, type);
+
+  // Display single channel textures in gray
+  if (format == GL_RED) {
+    const GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+  }
+
+  if (TexStorage2D storage = tex_storage_2d()) {
+    storage(GL_TEXTURE_2D, 1, static_cast<GLenum>(internal_format),
+            static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format,
+                 static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0,
+                 format, type, nullptr);
+  }
+  texture.height_ = height;
+  texture.width_ = width;
+  return texture;
+}
+
+void TexturePool::recycle(Texture texture, std::int32_t internal_format) {
+  if (!texture) return;
+
+  const Key key{texture.height(), texture.width(), internal_format};
+  const std::size_t size =
+      texture_bytes(key.height, key.width, key.internal_format);
+
+  // Releasing the texture stops the ResidencyManager from tracking it. This
+  // is done first, as the manager may trim the pool while holding its lock.
+  const std::uint32_t id = texture.release();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (size > capacity_) {
+    glDeleteTextures(1, &id);
+    return;
+  }
+
+  free_.push_front({key, id, size});
+  by_key_[key].push_back(free_.begin());
+  bytes_ += size;
+  this->trim_locked(capacity_);
+}
+
+void TexturePool::set_capacity(std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = bytes;
+  this->trim_locked(capacity_);
+}
+
+std::size_t TexturePool::capacity() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return capacity_;
+}
+
+std::size_t TexturePool::trim(std::size_t target) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return this->trim_locked(target);
+}
+
+std::size_t TexturePool::trim_locked(std::size_t target) {
+  std::size_t deleted = 0;
+  while (bytes_ > target && !free_.empty()) {
+    const Entry& entry = free_.back();
+
+    // The oldest texture of a key is the first one in its list.
+    auto it = by_key_.find(entry.key);
+    it->second.erase(it->second.begin());
+    if (it->second.empty()) by_key_.erase(it);
+
+    glDeleteTextures(1, &entry.id);
+    bytes_ -= entry.bytes;
+    deleted += entry.bytes;
+    free_.pop_back();
+  }
+  return deleted;
+}
+
+std::size_t TexturePool::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+std::size_t TexturePool::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_.size();
+}
+
+std::uint64_t TexturePool::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+std::uint64_t TexturePool::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+std::size_t TexturePool::texture_bytes(std::uint32_t height,
+                                       std::uint32_t width,
+                                       std::int32_t internal_format) {
+  std::size_t texel = 4;  // Drivers pad RGB textures to RGBA
+  switch (internal_format) {
+    case GL_R8:
+      texel = 1;
+      break;
+    case GL_R16:
+    case GL_RG8:
+      texel = 2;
+      break;
+    case GL_RGBA16F:
+      texel = 8;
+      break;
+    default:
+      break;
+  }
+  return static_cast<std::size_t>(height) * width * texel;
+}
+
+}  // namespace ImApp
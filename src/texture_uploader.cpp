@@ -0,0 +1,411 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <GLFW/glfw3.h>
+
+#include <ImApp/texture_uploader.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// The GL headers on some platforms only go up to OpenGL 1.1, so we define the
+// constants for pixel buffer objects and fences ourselves.
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_RGBA
+#define GL_TEXTURE_SWIZZLE_RGBA 0x8E46
+#endif
+
+#if defined(_WIN32) && !defined(_WIN64)
+#define IMAPP_GL_APIENTRY __stdcall
+#else
+#define IMAPP_GL_APIENTRY
+#endif
+
+namespace ImApp {
+
+// Fences are passed around as void*, so that we don't depend on the headers
+// declaring GLsync.
+struct TextureUploader::GLFunctions {
+  void(IMAPP_GL_APIENTRY* GenBuffers)(GLsizei, GLuint*) = nullptr;
+  void(IMAPP_GL_APIENTRY* DeleteBuffers)(GLsizei, const GLuint*) = nullptr;
+  void(IMAPP_GL_APIENTRY* BindBuffer)(GLenum, GLuint) = nullptr;
+  void(IMAPP_GL_APIENTRY* BufferData)(GLenum, std::ptrdiff_t, const void*,
+                                      GLenum) = nullptr;
+  void*(IMAPP_GL_APIENTRY* MapBufferRange)(GLenum, std::ptrdiff_t,
+                                           std::ptrdiff_t,
+                                           GLbitfield) = nullptr;
+  GLboolean(IMAPP_GL_APIENTRY* UnmapBuffer)(GLenum) = nullptr;
+  void*(IMAPP_GL_APIENTRY* FenceSync)(GLenum, GLbitfield) = nullptr;
+  GLenum(IMAPP_GL_APIENTRY* ClientWaitSync)(void*, GLbitfield,
+                                            std::uint64_t) = nullptr;
+  void(IMAPP_GL_APIENTRY* DeleteSync)(void*) = nullptr;
+
+  bool buffers() const {
+    return GenBuffers && DeleteBuffers && BindBuffer && BufferData &&
+           MapBufferRange && UnmapBuffer;
+  }
+
+  bool fences() const { return FenceSync && ClientWaitSync && DeleteSync; }
+
+  // Loads the functions for the current context. Pixel buffers with ranged
+  // mapping need OpenGL 3.0, and fences need 3.2 or ARB_sync.
+  void load(int major, bool sync) {
+    if (major >= 3) {
+      load(GenBuffers, "glGenBuffers");
+      load(DeleteBuffers, "glDeleteBuffers");
+      load(BindBuffer, "glBindBuffer");
+      load(BufferData, "glBufferData");
+      load(MapBufferRange, "glMapBufferRange");
+      load(UnmapBuffer, "glUnmapBuffer");
+    }
+
+    if (sync) {
+      load(FenceSync, "glFenceSync");
+      load(ClientWaitSync, "glClientWaitSync");
+      load(DeleteSync, "glDeleteSync");
+    }
+  }
+
+  template <typename F>
+  static void load(F& function, const char* name) {
+    function = reinterpret_cast<F>(glfwGetProcAddress(name));
+  }
+};
+
+TextureUploader::TextureUploader(GLFWwindow* main_window,
+                                 std::size_t frame_budget)
+    : context_(nullptr),
+      gl_(std::make_unique<GLFunctions>()),
+      pbo_(0),
+      scratch_(),
+      mutex_(),
+      cv_(),
+      queue_(),
+      current_(std::nullopt),
+      finished_(),
+      frame_budget_(frame_budget),
+      credit_(frame_budget),
+      outstanding_(0),
+      stop_(false),
+      thread_() {
+  // Decided once here, as uploads may be described on any thread.
+  detail::texture_swizzle_supported();
+
+#if !defined(__EMSCRIPTEN__) && !defined(IMGUI_IMPL_OPENGL_ES2)
+  // The hidden window uses the same context hints as the main window. GLFW
+  // restores the current context after creating it.
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  context_ = glfwCreateWindow(1, 1, "ImApp Uploader", nullptr, main_window);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+#else
+  (void)main_window;
+#endif
+
+  if (context_) {
+    // Window attributes may only be read on the main thread, so what the
+    // context supports is decided here, and handed to the upload thread. The
+    // contexts are shared, so the main context has the same extensions.
+    const int major = glfwGetWindowAttrib(context_, GLFW_CONTEXT_VERSION_MAJOR);
+    const int minor = glfwGetWindowAttrib(context_, GLFW_CONTEXT_VERSION_MINOR);
+    const bool sync = major > 3 || (major == 3 && minor >= 2) ||
+                      glfwExtensionSupported("GL_ARB_sync") == GLFW_TRUE;
+    thread_ = std::thread([this, major, sync] { this->run(major, sync); });
+  }
+}
+
+TextureUploader::~TextureUploader() {
+  {
+    std::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+
+  if (thread_.joinable()) {
+    thread_.join();
+  } else {
+    // Uploads happened on this thread, with the main context current
+    current_.reset();
+  }
+  finished_.clear();
+
+  if (context_) glfwDestroyWindow(context_);
+}
+
+std::size_t TextureUploader::frame_budget() const {
+  std::scoped_lock lock(mutex_);
+  return frame_budget_;
+}
+
+void TextureUploader::set_frame_budget(std::size_t bytes) {
+  std::scoped_lock lock(mutex_);
+  frame_budget_ = bytes;
+}
+
+void TextureUploader::enqueue(detail::UploadSource source,
+                              Callback on_ready) {
+  outstanding_.fetch_add(1, std::memory_order_acq_rel);
+
+  {
+    std::scoped_lock lock(mutex_);
+    if (source.height == 0 || source.width == 0) {
+      // Nothing to upload, so the empty texture is finished right away
+      finished_.push_back({Texture(), std::move(on_ready), nullptr});
+    } else {
+      queue_.push_back({std::move(source), std::move(on_ready), Texture(), 0});
+    }
+  }
+  cv_.notify_one();
+}
+
+void TextureUploader::begin_frame() {
+  std::vector<Finished> done;
+  {
+    std::scoped_lock lock(mutex_);
+    credit_ = frame_budget_;
+    done.swap(finished_);
+  }
+  cv_.notify_one();
+
+  if (context_ == nullptr) {
+    // Without a shared context, the bands are uploaded here. The texture is
+    // used by the same context, so it is ready without a fence.
+    std::size_t rows = 0;
+    while (this->next_band(rows)) {
+      this->upload_rows(*current_, rows);
+      if (current_->next_row == current_->source.height) {
+        done.push_back({std::move(current_->texture),
+                        std::move(current_->on_ready), nullptr});
+        current_.reset();
+      }
+    }
+  }
+
+  for (auto& f : done) {
+    outstanding_.fetch_sub(1, std::memory_order_acq_rel);
+    if (f.on_ready) f.on_ready(std::move(f.texture));
+  }
+}
+
+bool TextureUploader::next_band(std::size_t& rows) {
+  std::scoped_lock lock(mutex_);
+  if (stop_ || credit_ == 0) return false;
+
+  if (!current_) {
+    if (queue_.empty()) return false;
+    current_.emplace(std::move(queue_.front()));
+    queue_.pop_front();
+  }
+
+  // A row which is larger than the whole budget is uploaded on its own, in
+  // a frame where nothing else has been uploaded yet.
+  const detail::UploadSource& src = current_->source;
+  const std::size_t remaining = src.height - current_->next_row;
+  rows = std::min(credit_ / src.row_bytes, remaining);
+  if (rows == 0) {
+    if (credit_ < frame_budget_) {
+      credit_ = 0;
+      return false;
+    }
+    rows = 1;
+  }
+  credit_ -= std::min(credit_, rows * src.row_bytes);
+  return true;
+}
+
+void TextureUploader::upload_rows(Request& request, std::size_t rows) {
+  const detail::UploadSource& src = request.source;
+
+  if (!request.texture) {
+    // Texture::generate leaves the new texture bound
+    request.texture = Texture::generate();
+    if (src.gray) {
+      const GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+      glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, src.internal_format,
+                 static_cast<GLsizei>(src.width),
+                 static_cast<GLsizei>(src.height), 0, src.format, src.type,
+                 nullptr);
+    request.texture.height_ = src.height;
+    request.texture.width_ = src.width;
+  } else {
+    glBindTexture(GL_TEXTURE_2D, request.texture.id());
+  }
+
+  const std::size_t first_row = request.next_row;
+  const unsigned char* first = src.pixels + first_row * src.stride_bytes;
+  const std::size_t bytes = rows * src.row_bytes;
+  auto pack_rows = [&src, first, rows](unsigned char* dst) {
+    for (std::size_t r = 0; r < rows; r++) {
+      std::memcpy(dst + r * src.row_bytes, first + r * src.stride_bytes,
+                  src.row_bytes);
+    }
+  };
+
+  // The rows are copied into a pixel buffer, so the driver can transfer them
+  // while we continue. Re-specifying the buffer orphans the previous band.
+  const void* pixels = nullptr;
+  bool mapped = false;
+  if (pbo_) {
+    const auto size = static_cast<std::ptrdiff_t>(bytes);
+    gl_->BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+    gl_->BufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void* dst = gl_->MapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (dst) {
+      pack_rows(static_cast<unsigned char*>(dst));
+      mapped = gl_->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    }
+    if (mapped == false) gl_->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  if (mapped == false) {
+    if (src.stride_bytes == src.row_bytes) {
+      pixels = first;
+    } else {
+      scratch_.resize(bytes);
+      pack_rows(scratch_.data());
+      pixels = scratch_.data();
+    }
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(request.next_row),
+                  static_cast<GLsizei>(src.width), static_cast<GLsizei>(rows),
+                  src.format, src.type, pixels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (mapped) gl_->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  request.next_row += static_cast<std::uint32_t>(rows);
+}
+
+void TextureUploader::retire(std::vector<Finished>& in_flight) {
+  std::vector<Finished> ready;
+  for (auto it = in_flight.begin(); it != in_flight.end();) {
+    if (it->fence) {
+      const GLenum status = gl_->ClientWaitSync(it->fence, 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        ++it;
+        continue;
+      }
+      gl_->DeleteSync(it->fence);
+      it->fence = nullptr;
+    }
+    ready.push_back(std::move(*it));
+    it = in_flight.erase(it);
+  }
+
+  if (ready.empty()) return;
+  {
+    std::scoped_lock lock(mutex_);
+    for (auto& f : ready) finished_.push_back(std::move(f));
+  }
+  glfwPostEmptyEvent();
+}
+
+void TextureUploader::run(int gl_major, bool gl_sync) {
+  glfwMakeContextCurrent(context_);
+  gl_->load(gl_major, gl_sync);
+  if (gl_->buffers()) gl_->GenBuffers(1, &pbo_);
+
+  std::vector<Finished> in_flight;
+  while (true) {
+    std::size_t rows = 0;
+    if (this->next_band(rows)) {
+      this->upload_rows(*current_, rows);
+      if (current_->next_row == current_->source.height) {
+        // The fence tells us when the GPU has the whole texture. Without
+        // fences, we wait for the GPU here instead, which only blocks this
+        // thread.
+        void* fence = nullptr;
+        if (gl_->fences()) {
+          fence = gl_->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+          glFlush();
+        } else {
+          glFinish();
+        }
+        in_flight.push_back({std::move(current_->texture),
+                             std::move(current_->on_ready), fence});
+        current_.reset();
+      }
+    }
+
+    this->retire(in_flight);
+
+    std::unique_lock lock(mutex_);
+    auto ready = [this] {
+      return stop_ || (credit_ > 0 && (current_ || !queue_.empty()));
+    };
+    if (stop_) break;
+    if (in_flight.empty()) {
+      cv_.wait(lock, ready);
+    } else {
+      cv_.wait_for(lock, std::chrono::milliseconds(1), ready);
+    }
+    if (stop_) break;
+  }
+
+  // Undelivered textures are deleted while this context is still current
+  for (auto& f : in_flight) {
+    if (f.fence) gl_->DeleteSync(f.fence);
+  }
+  in_flight.clear();
+  current_.reset();
+  if (pbo_) gl_->DeleteBuffers(1, &pbo_);
+  glfwMakeContextCurrent(nullptr);
+}
+
+}  // namespace ImApp
@@ -0,0 +1,322 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2022, Hunter Belanger
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * */
+#include <ImApp/tree_view.hpp>
+
+#include "imgui/imgui_internal.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ImApp {
+
+TreeView::TreeView(Loader loader, JobSystem* jobs, std::uint64_t root)
+    : loader_(std::move(loader)),
+      jobs_(jobs),
+      root_id_(root),
+      nodes_(),
+      rows_(),
+      root_state_(State::Unloaded),
+      selected_(npos),
+      loading_(0),
+      generation_(0),
+      self_(std::make_shared<TreeView*>(this)) {
+  load(npos);
+}
+
+TreeView::~TreeView() = default;
+
+const TreeItem& TreeView::item(std::size_t row) const {
+  return nodes_[rows_[row]].item;
+}
+
+std::uint32_t TreeView::depth(std::size_t row) const {
+  return nodes_[rows_[row]].depth;
+}
+
+bool TreeView::is_open(std::size_t row) const {
+  return nodes_[rows_[row]].open;
+}
+
+void TreeView::expand(std::size_t row) {
+  const std::uint32_t n = rows_[row];
+  Node& node = nodes_[n];
+  if (node.open || node.item.has_children == false) return;
+  node.open = true;
+
+  if (node.state != State::Loaded) {
+    load(n);
+    return;
+  }
+
+  std::vector<std::uint32_t> children;
+  append_open_children(n, children);
+  rows_.insert(rows_.begin() + static_cast<std::ptrdiff_t>(row) + 1,
+               children.begin(), children.end());
+}
+
+void TreeView::collapse(std::size_t row) {
+  Node& node = nodes_[rows_[row]];
+  if (node.open == false) return;
+  node.open = false;
+
+  // The descendants of a node are the rows after it which are deeper.
+  std::size_t end = row + 1;
+  while (end < rows_.size() && nodes_[rows_[end]].depth > node.depth) ++end;
+  rows_.erase(rows_.begin() + static_cast<std::ptrdiff_t>(row) + 1,
+              rows_.begin() + static_cast<std::ptrdiff_t>(end));
+}
+
+std::optional<std::size_t> TreeView::selected_row() const {
+  return row_of(selected_);
+}
+
+const TreeItem* TreeView::selected() const {
+  if (selected_ == npos) return nullptr;
+  return &nodes_[selected_].item;
+}
+
+void TreeView::refresh() {
+  ++generation_;
+  nodes_.clear();
+  rows_.clear();
+  root_state_ = State::Unloaded;
+  selected_ = npos;
+  loading_ = 0;
+  load(npos);
+}
+
+void TreeView::load(std::uint32_t n) {
+  State& state = n == npos ? root_state_ : nodes_[n].state;
+  if (state == State::Loading || state == State::Loaded) return;
+  state = State::Loading;
+  ++loading_;
+
+  const std::uint64_t id = n == npos ? root_id_ : nodes_[n].item.id;
+
+  if (jobs_ == nullptr) {
+    std::optional<std::vector<TreeItem>> children;
+    try {
+      children = loader_(id);
+    } catch (...) {
+    }
+    finish_load(n, std::move(children));
+    return;
+  }
+
+  // The job gets its own copy of the loader, as the tree may be destroyed
+  // before the job runs.
+  std::weak_ptr<TreeView*> self = self_;
+  const std::uint64_t generation = generation_;
+  JobSystem* jobs = jobs_;
+  jobs_->submit([loader = loader_, id, n, generation, self, jobs] {
+    std::optional<std::vector<TreeItem>> children;
+    try {
+      children = loader(id);
+    } catch (...) {
+    }
+
+    jobs->run_on_main([self, n, generation,
+                       children = std::move(children)]() mutable {
+      auto tree = self.lock();
+      if (!tree || (*tree)->generation_ != generation) return;
+      (*tree)->finish_load(n, std::move(children));
+    });
+  });
+}
+
+void TreeView::finish_load(std::uint32_t n,
+                           std::optional<std::vector<TreeItem>> children) {
+  --loading_;
+  State& state = n == npos ? root_state_ : nodes_[n].state;
+  if (!children) {
+    state = State::Failed;
+    return;
+  }
+  state = State::Loaded;
+
+  const std::uint32_t first = static_cast<std::uint32_t>(nodes_.size());
+  const std::uint32_t count = static_cast<std::uint32_t>(children->size());
+  const std::uint32_t depth = n == npos ? 0 : nodes_[n].depth + 1;
+  nodes_.reserve(nodes_.size() + count);
+  for (TreeItem& child : *children) {
+    const State child_state =
+        child.has_children ? State::Unloaded : State::Loaded;
+    nodes_.push_back(
+        Node{std::move(child), n, npos, 0, depth, child_state, false});
+  }
+
+  if (n == npos) {
+    rows_.resize(count);
+    for (std::uint32_t i = 0; i < count; i++) rows_[i] = first + i;
+    return;
+  }
+
+  Node& node = nodes_[n];
+  node.first_child = first;
+  node.child_count = count;
+  if (count == 0) node.item.has_children = false;
+
+  // Only a node which is still open, and whose ancestors are all open, has
+  // rows to insert its children after.
+  if (node.open == false) return;
+  const auto row = row_of(n);
+  if (!row) return;
+  std::vector<std::uint32_t> rows(count);
+  for (std::uint32_t i = 0; i < count; i++) rows[i] = first + i;
+  rows_.insert(rows_.begin() + static_cast<std::ptrdiff_t>(*row) + 1,
+               rows.begin(), rows.end());
+}
+
+void TreeView::append_open_children(std::uint32_t n,
+                                    std::vector<std::uint32_t>& out) const {
+  const Node& node = nodes_[n];
+  for (std::uint32_t c = 0; c < node.child_count; c++) {
+    const std::uint32_t child = node.first_child + c;
+    out.push_back(child);
+    if (nodes_[child].open && nodes_[child].state == State::Loaded)
+      append_open_children(child, out);
+  }
+}
+
+std::optional<std::size_t> TreeView::row_of(std::uint32_t n) const {
+  if (n == npos) return std::nullopt;
+  const auto it = std::find(rows_.begin(), rows_.end(), n);
+  if (it == rows_.end()) return std::nullopt;
+  return static_cast<std::size_t>(it - rows_.begin());
+}
+
+bool TreeView::draw(const char* str_id, const ImVec2& size) {
+  bool changed = false;
+  if (ImGui::BeginChild(str_id, size) == false) {
+    ImGui::EndChild();
+    return changed;
+  }
+
+  if (rows_.empty()) {
+    if (root_state_ == State::Loading)
+      ImGui::TextDisabled("Loading...");
+    else if (root_state_ == State::Failed)
+      ImGui::TextDisabled("Failed to load");
+    ImGui::EndChild();
+    return changed;
+  }
+
+  const ImGuiStyle& style = ImGui::GetStyle();
+  const float font_size = ImGui::GetFontSize();
+  const float indent = ImGui::GetTreeNodeToLabelSpacing();
+  const ImU32 text_col = ImGui::GetColorU32(ImGuiCol_Text);
+  const ImU32 disabled_col = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+  // Rows are toggled once the clipper is done, as that changes rows_.
+  std::size_t toggle = rows_.size();
+
+  ImGuiListClipper clipper;
+  clipper.Begin(static_cast<int>(rows_.size()),
+                ImGui::GetTextLineHeightWithSpacing());
+  while (clipper.Step()) {
+    for (int r = clipper.DisplayStart; r < clipper.DisplayEnd; r++) {
+      const std::size_t row = static_cast<std::size_t>(r);
+      const std::uint32_t n = rows_[row];
+      const Node& node = nodes_[n];
+
+      ImGui::PushID(static_cast<int>(n));
+      const ImVec2 pos = ImGui::GetCursorScreenPos();
+      const float x = pos.x + static_cast<float>(node.depth) * indent;
+      if (ImGui::Selectable("##row", n == selected_,
+                            ImGuiSelectableFlags_AllowDoubleClick)) {
+        const float mouse_x = ImGui::GetMousePos().x;
+        const bool on_arrow = mouse_x >= x && mouse_x < x + indent;
+        if (node.item.has_children &&
+            (on_arrow || ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))) {
+          toggle = row;
+        } else if (n != selected_) {
+          selected_ = n;
+          changed = true;
+        }
+      }
+
+      if (node.item.has_children)
+        ImGui::RenderArrow(
+            draw_list,
+            ImVec2(x + style.FramePadding.x, pos.y + font_size * 0.15f),
+            text_col, node.open ? ImGuiDir_Down : ImGuiDir_Right, 0.70f);
+
+      const char* label = node.item.label.data();
+      const char* label_end = label + node.item.label.size();
+      draw_list->AddText(ImVec2(x + indent, pos.y), text_col, label,
+                         label_end);
+
+      if (node.open && node.state != State::Loaded) {
+        const char* hint =
+            node.state == State::Failed ? " (failed)" : " (loading...)";
+        const float w = ImGui::CalcTextSize(label, label_end).x;
+        draw_list->AddText(ImVec2(x + indent + w, pos.y), disabled_col, hint);
+      }
+      ImGui::PopID();
+    }
+  }
+  clipper.End();
+
+  // The arrow keys open and close the selected node, and left on a closed
+  // node moves the selection to its parent.
+  if (selected_ != npos && toggle == rows_.size() &&
+      ImGui::IsWindowFocused()) {
+    const bool left = ImGui::IsKeyPressed(ImGuiKey_LeftArrow);
+    const bool right = ImGui::IsKeyPressed(ImGuiKey_RightArrow);
+    if (left || right) {
+      const auto row = row_of(selected_);
+      const Node& node = nodes_[selected_];
+      if (row && right && node.open == false) {
+        expand(*row);
+      } else if (row && left && node.open) {
+        collapse(*row);
+      } else if (left && node.parent != npos) {
+        selected_ = node.parent;
+        changed = true;
+      }
+    }
+  }
+
+  if (toggle < rows_.size()) {
+    if (nodes_[rows_[toggle]].open)
+      collapse(toggle);
+    else
+      expand(toggle);
+  }
+
+  ImGui::EndChild();
+  return changed;
+}
+
+}  // namespace ImApp